@@ -44,6 +44,7 @@ int main(int argc, char *argv[]) {
 "definitions as for histogram.\n",
 		{OPT_HELP, OPT_VERBOSE, OPT_VERSION,
 			OPT_FILE_IN, OPT_FILE_OUT,
+			OPT_FORMAT,
 			OPT_MODE, OPT_CHANNELS, OPT_ORDER, 
 			OPT_QUEUE_SIZE,
 			OPT_TIME, OPT_PULSE,
@@ -57,7 +57,17 @@ index_offsets_t *index_offsets_alloc(unsigned int const length) {
 
 void index_offsets_init(index_offsets_t *index_offsets, 
 		unsigned int const limit) {
+	index_offsets_init_pruned(index_offsets, 0, limit);
+}
+
+void index_offsets_init_pruned(index_offsets_t *index_offsets,
+		unsigned int const lower, unsigned int const limit) {
+/* Only yield the offsets whose last member lies in [lower, limit]. Every 
+ * other member lies between the first and the last, so any tuple reaching 
+ * past the limit is never generated, rather than generated and rejected.
+ */
 	int i;
+	index_offsets->lower = lower;
 	index_offsets->limit = limit;
 
 	combination_init(index_offsets->current_index_offsets);
@@ -70,44 +80,43 @@ void index_offsets_init(index_offsets_t *index_offsets,
 
 int index_offsets_next(index_offsets_t *index_offsets) {
 	int i;
-	unsigned int leading_digit;
-	combination_t *current = index_offsets->current_index_offsets;
+	int const last = index_offsets->length - 1;
+	unsigned int *values = index_offsets->current_index_offsets->values;
 
 	if ( index_offsets->yielded ) {
-		leading_digit = current->values[1];
-
-		for ( i = current->length - 1; i > 0; i-- ) { 
-			current->values[i]++;
-			if ( current->values[i] <= index_offsets->limit ) {
-				/* No overflow */
-				i = 0;
-			} else {
-				current->values[i] = 0;
+		/* Find the rightmost offset which can still be incremented while
+		 * leaving room for those after it, and restart those after it 
+		 * just above it. The first offset is always 0.
+		 */
+		for ( i = last; i > 0; i-- ) {
+			if ( values[i] + (last - i) < index_offsets->limit ) {
+				break;
 			}
 		}
-	
-		if ( current->values[1] == 0 ) {
-			current->values[1] = leading_digit+1;
-		}
-	
-		for ( i = 1; i < current->length; i++ ) {
-			if ( current->values[i] == 0 ) {
-				current->values[i] = current->values[i-1] + 1;
-			} else {
-				/* nothing, because we already incremented. */
-				;
-			}
 
-			if ( current->values[i] > index_offsets->limit ) {
-				return(PC_COMBINATION_OVERFLOW);
-			}
+		if ( i == 0 ) {
+			return(PC_COMBINATION_OVERFLOW);
 		}
 
-		return(PC_SUCCESS);
+		values[i]++;
+		for ( i = i + 1; i <= last; i++ ) {
+			values[i] = values[i-1] + 1;
+		}
 	} else {
 		index_offsets->yielded = 1;
-		return(PC_SUCCESS);
 	}
+
+	if ( last > 0 ) {
+		if ( values[last] < index_offsets->lower ) {
+			values[last] = index_offsets->lower;
+		}
+
+		if ( values[last] > index_offsets->limit ) {
+			return(PC_COMBINATION_OVERFLOW);
+		}
+	}
+
+	return(PC_SUCCESS);
 }
 
 void index_offsets_free(index_offsets_t **index_offsets) {
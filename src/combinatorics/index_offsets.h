@@ -37,6 +37,7 @@
 
 typedef struct {
 	unsigned int length;
+	unsigned int lower;
 	unsigned int limit;
 	int yielded;
 
@@ -46,6 +47,8 @@ typedef struct {
 index_offsets_t *index_offsets_alloc(unsigned int const length);
 void index_offsets_init(index_offsets_t *index_offsets, 
 		unsigned int const limit);
+void index_offsets_init_pruned(index_offsets_t *index_offsets,
+		unsigned int const lower, unsigned int const limit);
 int index_offsets_next(index_offsets_t *index_offsets);
 void index_offsets_free(index_offsets_t **index_offsets);
 
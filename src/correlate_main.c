@@ -62,6 +62,7 @@ int main(int argc, char *argv[]) {
 "successive photons (valid for all numbers of channels).\n",
 		{OPT_VERBOSE, OPT_HELP, OPT_VERSION,
 			OPT_FILE_IN, OPT_FILE_OUT,
+			OPT_FORMAT, OPT_READ_AHEAD,
 			OPT_MODE, OPT_ORDER,
 			OPT_PRINT_EVERY, OPT_POSITIVE_ONLY, OPT_START_STOP,
 			OPT_WAITING_TIME,
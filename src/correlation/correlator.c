@@ -56,6 +56,7 @@ correlator_t *correlator_alloc(int const mode, unsigned int const order,
 
 	correlator->mode = mode;
 	correlator->order = order;
+	correlator->symmetric = false;
 
 	if ( correlator->mode == MODE_T2 ) {
 		correlator->correlate = t2_correlate;
@@ -93,6 +94,19 @@ correlator_t *correlator_alloc(int const mode, unsigned int const order,
 	correlator->min_pulse_distance = min_pulse_distance;
 	correlator->max_pulse_distance = max_pulse_distance;
 
+	/* Photons arrive in order of time (t2) or pulse (t3), so distances along
+	 * that dimension grow steadily through the queue. 
+	 */
+	if ( correlator->mode == MODE_T2 ) {
+		correlator->window_dim = t2_window_dimension;
+		correlator->min_window_distance = min_time_distance;
+		correlator->max_window_distance = max_time_distance;
+	} else {
+		correlator->window_dim = t3_window_dimension;
+		correlator->min_window_distance = min_pulse_distance;
+		correlator->max_window_distance = max_pulse_distance;
+	}
+
 	return(correlator);
 }
 
@@ -173,10 +187,38 @@ int correlator_next(correlator_t *correlator) {
 	return(EOF);
 }
 
+static size_t correlator_block_search(correlator_t const *correlator,
+		long long const distance) {
+/* Find the first photon in the queue at least the given distance from the 
+ * front, along the dimension in which the photons are ordered.
+ */
+	size_t lower = 1;
+	size_t upper = photon_queue_size(correlator->queue);
+	size_t middle;
+	photon_t *photon;
+	long long const front = correlator->window_dim(correlator->left);
+
+	while ( lower < upper ) {
+		middle = lower + (upper - lower)/2;
+		photon_queue_index(correlator->queue, &photon, middle);
+
+		if ( correlator->window_dim(photon) - front < distance ) {
+			lower = middle + 1;
+		} else {
+			upper = middle;
+		}
+	}
+
+	return(lower);
+}
+
 int correlator_next_block(correlator_t *correlator) {
 /* Check that there are enough photons, and that they are far enough apart 
  * to be considered a block (flusihng means they always are)
  * */
+	size_t lower;
+	size_t limit;
+
 	if ( correlator->yielded ) {
 		photon_queue_pop(correlator->queue, NULL);
 		correlator->yielded = false;
@@ -197,8 +239,26 @@ int correlator_next_block(correlator_t *correlator) {
 			correlator->under_max_distance(correlator) ) {
 		return(EOF);
 	} else {
-		index_offsets_init(correlator->index_offsets, 
-				photon_queue_size(correlator->queue)-1);
+		/* Tuples whose last photon is too close to or too far from the 
+		 * front would only be rejected, so leave them out of the 
+		 * enumeration entirely. When flushing every tuple is yielded.
+		 */
+		lower = 0;
+		limit = photon_queue_size(correlator->queue) - 1;
+
+		if ( ! correlator->flushing ) {
+			if ( correlator->min_window_distance > 0 ) {
+				lower = correlator_block_search(correlator,
+						correlator->min_window_distance);
+			}
+
+			if ( correlator->max_window_distance > 0 ) {
+				limit = correlator_block_search(correlator,
+						correlator->max_window_distance) - 1;
+			}
+		}
+
+		index_offsets_init_pruned(correlator->index_offsets, lower, limit);
 		correlator->in_permutations = false;
 		correlator->yielded = true;
 		correlator->in_block = true;
@@ -212,6 +272,12 @@ int correlator_next_from_block(correlator_t *correlator) {
 		if ( correlator->in_permutations ) {
 			if ( permutation_next(correlator->permutation) == PC_SUCCESS ) {
 				correlator_build_correlation(correlator);
+
+				/* The identity comes first, and stands in for the rest. */
+				if ( correlator->symmetric ) {
+					correlator->in_permutations = false;
+				}
+
 				return(PC_SUCCESS);
 			} else {
 				correlator->in_permutations = false;
@@ -284,3 +350,10 @@ int correlator_build_correlation(correlator_t *correlator) {
 void correlator_flush(correlator_t *correlator) {
 	correlator->flushing = true;
 }
+
+void correlator_set_symmetric(correlator_t *correlator, int const symmetric) {
+/* Yield each tuple only in its original order, for a histogram which 
+ * rebuilds the other permutations itself.
+ */
+	correlator->symmetric = symmetric;
+}
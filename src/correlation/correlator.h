@@ -47,6 +47,7 @@ typedef struct _correlator_t {
 	int in_block;
 	int in_permutations;
 	int yielded;
+	int symmetric;
 
 	photon_t *left;
 	photon_t *right;
@@ -56,6 +57,10 @@ typedef struct _correlator_t {
 	long long min_time_distance;
 	long long max_time_distance;
 
+	photon_window_dimension_t window_dim;
+	long long min_window_distance;
+	long long max_window_distance;
+
 	photon_queue_t *queue;
 
 	index_offsets_t *index_offsets;
@@ -86,5 +91,6 @@ int correlator_next_from_block(correlator_t *correlator);
 int correlator_valid_distance(correlator_t *correlator);
 int correlator_build_correlation(correlator_t *correlator);
 void correlator_flush(correlator_t *correlator);
+void correlator_set_symmetric(correlator_t *correlator, int const symmetric);
 
 #endif
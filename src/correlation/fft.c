@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "fft.h"
+#include "../error.h"
+
+/*
+ * A real signal of length n is transformed as the complex signal of length
+ * n/2 formed from its even and odd samples, by an iterative radix-2 
+ * transform, and the two halves are then separated using the symmetry of 
+ * the transform of a real signal. The inverse undoes these steps in 
+ * reverse.
+ *
+ * The twiddle factors are those of the length n transform, 
+ * exp(-2 pi i k/n); the half-length complex transform uses every other one.
+ */
+fft_t *fft_alloc(size_t const n) {
+	size_t i;
+	size_t j;
+	size_t bit;
+	size_t const half = n/2;
+	fft_t *fft = NULL;
+
+	if ( n < 4 || (n & (n - 1)) != 0 ) {
+		error("The length of a transform must be a power of two of at "
+				"least 4, not %zu.\n", n);
+		return(fft);
+	}
+
+	fft = (fft_t *)malloc(sizeof(fft_t));
+
+	if ( fft == NULL ) {
+		return(fft);
+	}
+
+	fft->n = n;
+	fft->cosines = (double *)malloc(sizeof(double)*half);
+	fft->sines = (double *)malloc(sizeof(double)*half);
+	fft->reversed = (size_t *)malloc(sizeof(size_t)*half);
+	fft->work = (double *)malloc(sizeof(double)*n);
+
+	if ( fft->cosines == NULL || fft->sines == NULL || 
+			fft->reversed == NULL || fft->work == NULL ) {
+		fft_free(&fft);
+		return(fft);
+	}
+
+	for ( i = 0; i < half; i++ ) {
+		fft->cosines[i] = cos(2*M_PI*i/n);
+		fft->sines[i] = -sin(2*M_PI*i/n);
+	}
+
+	for ( i = 0, j = 0; i < half; i++ ) {
+		fft->reversed[i] = j;
+
+		for ( bit = half >> 1; bit > 0 && (j & bit); bit >>= 1 ) {
+			j ^= bit;
+		}
+		j |= bit;
+	}
+
+	return(fft);
+}
+
+void fft_free(fft_t **fft) {
+	if ( *fft != NULL ) {
+		free((*fft)->cosines);
+		free((*fft)->sines);
+		free((*fft)->reversed);
+		free((*fft)->work);
+		free(*fft);
+		*fft = NULL;
+	}
+}
+
+static void fft_complex(fft_t const *fft, double *z) {
+/* In-place forward transform of the n/2 complex values in z, which have
+ * already been put in bit-reversed order. */
+	size_t i, j, k;
+	size_t length;
+	size_t stride;
+	size_t const half = fft->n/2;
+	double wr, wi;
+	double ar, ai;
+	double br, bi;
+	double tr, ti;
+
+	for ( length = 2, stride = half; length <= half; 
+			length *= 2, stride /= 2 ) {
+		for ( i = 0; i < half; i += length ) {
+			for ( j = 0; j < length/2; j++ ) {
+				wr = fft->cosines[j*stride];
+				wi = fft->sines[j*stride];
+
+				k = i + j;
+				ar = z[2*k];
+				ai = z[2*k+1];
+				br = z[2*(k + length/2)];
+				bi = z[2*(k + length/2)+1];
+
+				tr = br*wr - bi*wi;
+				ti = br*wi + bi*wr;
+
+				z[2*k] = ar + tr;
+				z[2*k+1] = ai + ti;
+				z[2*(k + length/2)] = ar - tr;
+				z[2*(k + length/2)+1] = ai - ti;
+			}
+		}
+	}
+}
+
+void fft_forward(fft_t *fft, double const *signal, double *transform) {
+	size_t k;
+	size_t const half = fft->n/2;
+	double * const z = fft->work;
+	double er, ei;
+	double or, oi;
+	double wr, wi;
+
+	for ( k = 0; k < half; k++ ) {
+		z[2*fft->reversed[k]] = signal[2*k];
+		z[2*fft->reversed[k]+1] = signal[2*k+1];
+	}
+
+	fft_complex(fft, z);
+
+	/* The transforms of the even and odd samples are
+	 *   E = (Z[k] + Z*[h-k])/2 and O = -i(Z[k] - Z*[h-k])/2,
+	 * and the full transform is E + W^k O. */
+	transform[0] = z[0] + z[1];
+	transform[1] = 0;
+	transform[2*half] = z[0] - z[1];
+	transform[2*half+1] = 0;
+
+	for ( k = 1; k < half; k++ ) {
+		er = (z[2*k] + z[2*(half-k)])/2;
+		ei = (z[2*k+1] - z[2*(half-k)+1])/2;
+		or = (z[2*k+1] + z[2*(half-k)+1])/2;
+		oi = -(z[2*k] - z[2*(half-k)])/2;
+
+		wr = fft->cosines[k];
+		wi = fft->sines[k];
+
+		transform[2*k] = er + wr*or - wi*oi;
+		transform[2*k+1] = ei + wr*oi + wi*or;
+	}
+}
+
+void fft_inverse(fft_t *fft, double const *transform, double *signal) {
+	size_t k;
+	size_t const half = fft->n/2;
+	double * const z = fft->work;
+	double er, ei;
+	double dr, di;
+	double or, oi;
+	double wr, wi;
+
+	/* Undo the separation, with E = (X[k] + X*[h-k])/2 and 
+	 * O = (X[k] - X*[h-k])/(2 W^k), then transform the conjugate of 
+	 * E + iO forward, which gives the conjugate of the inverse. */
+	for ( k = 0; k < half; k++ ) {
+		er = (transform[2*k] + transform[2*(half-k)])/2;
+		ei = (transform[2*k+1] - transform[2*(half-k)+1])/2;
+		dr = (transform[2*k] - transform[2*(half-k)])/2;
+		di = (transform[2*k+1] + transform[2*(half-k)+1])/2;
+
+		wr = fft->cosines[k];
+		wi = -fft->sines[k];
+
+		or = dr*wr - di*wi;
+		oi = dr*wi + di*wr;
+
+		z[2*fft->reversed[k]] = er - oi;
+		z[2*fft->reversed[k]+1] = -(ei + or);
+	}
+
+	fft_complex(fft, z);
+
+	for ( k = 0; k < half; k++ ) {
+		signal[2*k] = z[2*k]/half;
+		signal[2*k+1] = -z[2*k+1]/half;
+	}
+}
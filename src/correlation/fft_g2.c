@@ -0,0 +1,323 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "fft_g2.h"
+#include "../error.h"
+
+/*
+ * Correlating binned intensities directly costs one product per lag for 
+ * every bin, which for long lags on bright signals is far more than the 
+ * photons themselves. Here the histogram bins are the intensity bins, and 
+ * the correlation of each channel pair over a block of bins is found for 
+ * all lags at once as the inverse transform of the product of the 
+ * transforms of the first channel over the block and of the second over 
+ * the bins within range of it. The block is shorter than the transform by 
+ * the number of lags, so the circular correlation does not wrap, and the 
+ * blocks tile the signal, so their sums add up to the full correlation with
+ * memory bounded by the transform length.
+ *
+ * The counts are sums of products of photon counts, and so are integers up
+ * to rounding. As for the photon histograms, a photon is not paired with 
+ * itself, so the number of photons is taken from the zero-lag bin of each 
+ * autocorrelation.
+ */
+static double **fft_g2_arrays_alloc(unsigned int const channels, 
+		size_t const length) {
+	unsigned int c;
+	double **arrays;
+
+	arrays = (double **)calloc(channels, sizeof(double *));
+
+	if ( arrays == NULL ) {
+		return(arrays);
+	}
+
+	for ( c = 0; c < channels; c++ ) {
+		arrays[c] = (double *)calloc(length, sizeof(double));
+
+		if ( arrays[c] == NULL ) {
+			return(arrays);
+		}
+	}
+
+	return(arrays);
+}
+
+static int fft_g2_arrays_valid(double **arrays, unsigned int const channels) {
+	unsigned int c;
+
+	if ( arrays == NULL ) {
+		return(false);
+	}
+
+	for ( c = 0; c < channels; c++ ) {
+		if ( arrays[c] == NULL ) {
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+static void fft_g2_arrays_free(double ***arrays, unsigned int const channels) {
+	unsigned int c;
+
+	if ( *arrays != NULL ) {
+		for ( c = 0; c < channels; c++ ) {
+			free((*arrays)[c]);
+		}
+		free(*arrays);
+		*arrays = NULL;
+	}
+}
+
+fft_g2_t *fft_g2_alloc(unsigned int const channels, limits_t const *limits) {
+	long long span;
+	long long lower;
+	long long upper;
+	fft_g2_t *g2 = NULL;
+
+	span = (long long)(limits->upper - limits->lower);
+	if ( limits->bins == 0 || span <= 0 || 
+			(double)span != limits->upper - limits->lower ||
+			span % (long long)limits->bins != 0 ) {
+		error("The time limits must span a whole number of picoseconds "
+				"per bin.\n");
+		return(g2);
+	}
+
+	lower = (long long)limits->lower;
+	if ( (double)lower != limits->lower || 
+			lower % (span/(long long)limits->bins) != 0 ) {
+		error("The lower time limit must be a whole number of bins.\n");
+		return(g2);
+	}
+
+	g2 = (fft_g2_t *)malloc(sizeof(fft_g2_t));
+
+	if ( g2 == NULL ) {
+		return(g2);
+	}
+
+	g2->channels = channels;
+	g2->bins = limits->bins;
+	g2->bin_width = span/(long long)limits->bins;
+	g2->lower = lower/g2->bin_width;
+	upper = g2->lower + (long long)g2->bins;
+
+	/* A transform four times the number of lags spends most of each one
+	 * on the block itself. */
+	g2->length = 1024;
+	while ( g2->length < 4*g2->bins ) {
+		g2->length *= 2;
+	}
+	g2->block = g2->length - g2->bins + 1;
+
+	/* The trace starts at the earliest bin needed, whether of the block or 
+	 * of the range after it. */
+	g2->block_offset = g2->lower < 0 ? -g2->lower : 0;
+	g2->window_offset = g2->block_offset + g2->lower;
+	g2->span = g2->window_offset + g2->length;
+	if ( g2->span < g2->block_offset + g2->block ) {
+		g2->span = g2->block_offset + g2->block;
+	}
+
+	debug("FFT g2: lags %lld to %lld of %lld, transforms of %zu for "
+			"blocks of %zu.\n", g2->lower, upper, g2->bin_width,
+			g2->length, g2->block);
+
+	g2->fft = fft_alloc(g2->length);
+	g2->trace = fft_g2_arrays_alloc(channels, g2->span);
+	g2->block_transforms = fft_g2_arrays_alloc(channels, g2->length + 2);
+	g2->window_transforms = fft_g2_arrays_alloc(channels, g2->length + 2);
+	g2->block_counts = (unsigned long long *)malloc(
+			sizeof(unsigned long long)*channels);
+	g2->window_nonzero = (int *)malloc(sizeof(int)*channels);
+	g2->signal = (double *)malloc(sizeof(double)*g2->length);
+	g2->product = (double *)malloc(sizeof(double)*(g2->length + 2));
+
+	if ( g2->fft == NULL || 
+			! fft_g2_arrays_valid(g2->trace, channels) ||
+			! fft_g2_arrays_valid(g2->block_transforms, channels) ||
+			! fft_g2_arrays_valid(g2->window_transforms, channels) ||
+			g2->block_counts == NULL || g2->window_nonzero == NULL ||
+			g2->signal == NULL || g2->product == NULL ) {
+		fft_g2_free(&g2);
+		return(g2);
+	}
+
+	fft_g2_init(g2);
+
+	return(g2);
+}
+
+void fft_g2_init(fft_g2_t *g2) {
+	unsigned int c;
+
+	for ( c = 0; c < g2->channels; c++ ) {
+		memset(g2->trace[c], 0, sizeof(double)*g2->span);
+	}
+
+	g2->start = 0;
+	g2->seen = 0;
+}
+
+void fft_g2_free(fft_g2_t **g2) {
+	if ( *g2 != NULL ) {
+		fft_free(&((*g2)->fft));
+		fft_g2_arrays_free(&((*g2)->trace), (*g2)->channels);
+		fft_g2_arrays_free(&((*g2)->block_transforms), (*g2)->channels);
+		fft_g2_arrays_free(&((*g2)->window_transforms), (*g2)->channels);
+		free((*g2)->block_counts);
+		free((*g2)->window_nonzero);
+		free((*g2)->signal);
+		free((*g2)->product);
+		free(*g2);
+		*g2 = NULL;
+	}
+}
+
+static void fft_g2_block(fft_g2_t *g2, histogram_gn_t *hist) {
+/* Add the correlations of the current block, and move on to the next. */
+	unsigned int c, c0, c1;
+	size_t i;
+	size_t const length = g2->length;
+	double const *block;
+	double const *window;
+	double *transform;
+	double re, im;
+	long long value;
+	int histogram_index;
+
+	for ( c = 0; c < g2->channels; c++ ) {
+		block = &(g2->trace[c][g2->block_offset]);
+		window = &(g2->trace[c][g2->window_offset]);
+
+		g2->block_counts[c] = 0;
+		for ( i = 0; i < g2->block; i++ ) {
+			g2->block_counts[c] += (unsigned long long)block[i];
+		}
+
+		g2->window_nonzero[c] = false;
+		for ( i = 0; i < length && ! g2->window_nonzero[c]; i++ ) {
+			g2->window_nonzero[c] = window[i] != 0;
+		}
+
+		if ( g2->block_counts[c] > 0 ) {
+			memcpy(g2->signal, block, sizeof(double)*g2->block);
+			memset(&(g2->signal[g2->block]), 0, 
+					sizeof(double)*(length - g2->block));
+			fft_forward(g2->fft, g2->signal, g2->block_transforms[c]);
+		}
+
+		if ( g2->window_nonzero[c] ) {
+			fft_forward(g2->fft, window, g2->window_transforms[c]);
+		}
+	}
+
+	for ( c0 = 0; c0 < g2->channels; c0++ ) {
+		if ( g2->block_counts[c0] == 0 ) {
+			continue;
+		}
+
+		for ( c1 = 0; c1 < g2->channels; c1++ ) {
+			histogram_index = hist->histogram_map[c0*g2->channels + c1];
+
+			if ( histogram_index < 0 || ! g2->window_nonzero[c1] ) {
+				continue;
+			}
+
+			/* The correlation is the inverse of conj(B) W. */
+			transform = g2->block_transforms[c0];
+			for ( i = 0; i <= length/2; i++ ) {
+				re = g2->window_transforms[c1][2*i];
+				im = g2->window_transforms[c1][2*i+1];
+				g2->product[2*i] = transform[2*i]*re + transform[2*i+1]*im;
+				g2->product[2*i+1] = transform[2*i]*im - 
+						transform[2*i+1]*re;
+			}
+
+			fft_inverse(g2->fft, g2->product, g2->signal);
+
+			for ( i = 0; i < g2->bins; i++ ) {
+				value = llround(g2->signal[i]);
+
+				if ( c0 == c1 && g2->lower + (long long)i == 0 ) {
+					value -= (long long)g2->block_counts[c0];
+				}
+
+				if ( value > 0 ) {
+					hist->counts[histogram_index][i] += value;
+				}
+			}
+		}
+	}
+
+	for ( c = 0; c < g2->channels; c++ ) {
+		memmove(g2->trace[c], &(g2->trace[c][g2->block]),
+				sizeof(double)*(g2->span - g2->block));
+		memset(&(g2->trace[c][g2->span - g2->block]), 0,
+				sizeof(double)*g2->block);
+	}
+
+	g2->start += g2->block;
+}
+
+int fft_g2_push(fft_g2_t *g2, histogram_gn_t *hist, counts_t const *counts) {
+	unsigned int c;
+	size_t const index = g2->seen - g2->start + g2->block_offset;
+
+	for ( c = 0; c < g2->channels; c++ ) {
+		g2->trace[c][index] = (double)counts->counts[c];
+	}
+
+	g2->seen++;
+
+	if ( index + 1 == g2->span ) {
+		fft_g2_block(g2, hist);
+	}
+
+	return(PC_SUCCESS);
+}
+
+int fft_g2_flush(fft_g2_t *g2, histogram_gn_t *hist) {
+	while ( g2->start < g2->seen ) {
+		fft_g2_block(g2, hist);
+	}
+
+	fft_g2_init(g2);
+
+	return(PC_SUCCESS);
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CORRELATION_FFT_G2_H_
+#define CORRELATION_FFT_G2_H_
+
+#include "fft.h"
+#include "../limits.h"
+#include "../statistics/counts.h"
+#include "../histogram/histogram_gn.h"
+
+/*
+ * g2 of binned intensities at every lag of a linear histogram at once, 
+ * computed by Fourier transform over blocks of bins. The trace holds the 
+ * bins of the current block and all bins within range of it.
+ */
+typedef struct {
+	unsigned int channels;
+
+	long long bin_width;
+	long long lower;
+	size_t bins;
+
+	size_t length;
+	size_t block;
+	size_t block_offset;
+	size_t window_offset;
+	size_t span;
+
+	long long start;
+	long long seen;
+
+	fft_t *fft;
+	double **trace;
+	double **block_transforms;
+	double **window_transforms;
+	unsigned long long *block_counts;
+	int *window_nonzero;
+	double *signal;
+	double *product;
+} fft_g2_t;
+
+fft_g2_t *fft_g2_alloc(unsigned int const channels, limits_t const *limits);
+void fft_g2_init(fft_g2_t *g2);
+void fft_g2_free(fft_g2_t **g2);
+
+int fft_g2_push(fft_g2_t *g2, histogram_gn_t *hist, counts_t const *counts);
+int fft_g2_flush(fft_g2_t *g2, histogram_gn_t *hist);
+
+#endif
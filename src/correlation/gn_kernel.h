@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * A histogramming kernel for one (mode, order) pair, included once per pair
+ * by photon_gn.c with the following defined:
+ *   GN_KERNEL_NAME: the name of the function to define.
+ *   GN_KERNEL_MODE: MODE_T2 or MODE_T3.
+ *   GN_KERNEL_ORDER: 2 or 3.
+ *   GN_KERNEL_PERMUTATIONS: a table of all permutations of the order.
+ *   GN_KERNEL_SYMMETRIC: 1 for a second-order kernel feeding a symmetric
+ *     histogram, with only the identity in the table, 0 otherwise.
+ *
+ * The kernel handles the block the correlator has just set up: every tuple
+ * starting at the front of the queue and ending within the pruned limits,
+ * in every permutation, exactly as correlator_next would yield them. Since 
+ * the order and mode are fixed here, the loops over photons, permutations
+ * and dimensions have constant bounds and the whole path from photons to 
+ * histogram bin is inlined, in place of the correlation, values vector and 
+ * function pointers of the general path. The bins are found as in 
+ * edges_index_linear, so the counts are identical, but values outside the
+ * histogram are skipped silently rather than reported one by one.
+ *
+ * In the symmetric kernel, each pair is counted once in its original order,
+ * and the bin its mirror image would have is handed to the histogram along
+ * with it.
+ */
+
+static void GN_KERNEL_NAME(photon_gn_t *gn) {
+	correlator_t const *correlator = gn->correlator;
+	histogram_gn_t *hist = gn->histogram;
+	photon_block_t const *block = gn->block;
+	unsigned int const channels = hist->channels;
+	size_t const n_permutations = sizeof(GN_KERNEL_PERMUTATIONS)/
+			sizeof(GN_KERNEL_PERMUTATIONS[0]);
+	size_t const first = correlator->index_offsets->lower > 
+			GN_KERNEL_ORDER - 1 ?
+			correlator->index_offsets->lower : GN_KERNEL_ORDER - 1;
+	size_t const limit = correlator->index_offsets->limit;
+	limits_t const *time_limits = &(gn->time_limits);
+	double const time_span = time_limits->upper - time_limits->lower;
+	double const time_bins = time_limits->bins;
+	long long const time_n_bins = time_limits->bins;
+#if GN_KERNEL_MODE == MODE_T3
+	limits_t const *pulse_limits = &(gn->pulse_limits);
+	double const pulse_span = pulse_limits->upper - pulse_limits->lower;
+	double const pulse_bins = pulse_limits->bins;
+	long long const pulse_n_bins = pulse_limits->bins;
+	long long distance;
+#endif
+	size_t tuple[GN_KERNEL_ORDER];
+	size_t last;
+	size_t p;
+	unsigned int k;
+	unsigned int const *permutation;
+	size_t photon;
+	size_t origin;
+	int histogram_index;
+	long long bin_index;
+	int index;
+	int valid;
+#if GN_KERNEL_SYMMETRIC
+	long long mirror_index;
+	int mirror_valid;
+#endif
+
+	tuple[0] = 0;
+
+	for ( last = first; last <= limit; last++ ) {
+		tuple[GN_KERNEL_ORDER-1] = last;
+
+		/* Only the first and last photons set the distance of the tuple. */
+		if ( ! correlator->flushing ) {
+			valid = ( correlator->min_time_distance == 0 || 
+						llabs(block->time[last] - block->time[0])
+							>= correlator->min_time_distance ) &&
+					( correlator->max_time_distance == 0 ||
+						llabs(block->time[last] - block->time[0])
+							< correlator->max_time_distance );
+#if GN_KERNEL_MODE == MODE_T3
+			distance = llabs(block->pulse[last] - block->pulse[0]);
+			valid = valid && 
+					( correlator->min_pulse_distance == 0 ||
+						distance >= correlator->min_pulse_distance ) &&
+					( correlator->max_pulse_distance == 0 ||
+						distance < correlator->max_pulse_distance );
+#endif
+
+			if ( ! valid ) {
+				continue;
+			}
+		}
+
+#if GN_KERNEL_ORDER == 3
+		for ( tuple[1] = 1; tuple[1] < last; tuple[1]++ ) {
+#endif
+		for ( p = 0; p < n_permutations; p++ ) {
+			permutation = GN_KERNEL_PERMUTATIONS[p];
+			origin = tuple[permutation[0]];
+
+			histogram_index = block->channel[origin];
+
+			for ( k = 1; k < GN_KERNEL_ORDER; k++ ) {
+				histogram_index = histogram_index*channels + 
+						block->channel[tuple[permutation[k]]];
+			}
+
+			/* Only some tuples of channels may have been selected. */
+			histogram_index = hist->histogram_map[histogram_index];
+
+			if ( histogram_index < 0 ) {
+				continue;
+			}
+
+			bin_index = 0;
+			valid = 1;
+#if GN_KERNEL_SYMMETRIC
+			mirror_index = 0;
+			mirror_valid = 1;
+#endif
+
+			for ( k = 1; k < GN_KERNEL_ORDER; k++ ) {
+				photon = tuple[permutation[k]];
+
+#if GN_KERNEL_MODE == MODE_T3
+				index = (int)floor(
+						(block->pulse[photon] - block->pulse[origin] - 
+							pulse_limits->lower)/pulse_span*pulse_bins);
+				valid = valid && index >= 0;
+				bin_index = bin_index*pulse_n_bins + index;
+
+#if GN_KERNEL_SYMMETRIC
+				index = (int)floor(
+						(block->pulse[origin] - block->pulse[photon] - 
+							pulse_limits->lower)/pulse_span*pulse_bins);
+				mirror_valid = mirror_valid && index >= 0;
+				mirror_index = mirror_index*pulse_n_bins + index;
+#endif
+#endif
+
+				index = (int)floor(
+						(block->time[photon] - block->time[origin] - 
+							time_limits->lower)/time_span*time_bins);
+				valid = valid && index >= 0;
+				bin_index = bin_index*time_n_bins + index;
+
+#if GN_KERNEL_SYMMETRIC
+				index = (int)floor(
+						(block->time[origin] - block->time[photon] - 
+							time_limits->lower)/time_span*time_bins);
+				mirror_valid = mirror_valid && index >= 0;
+				mirror_index = mirror_index*time_n_bins + index;
+#endif
+			}
+
+#if GN_KERNEL_SYMMETRIC
+			if ( valid && mirror_valid && 
+					bin_index < (long long)hist->n_bins && 
+					mirror_index == (long long)hist->n_bins - 1 - bin_index ) {
+				hist->counts[histogram_index][bin_index]++;
+				continue;
+			}
+
+			histogram_gn_increment_symmetric(hist, histogram_index,
+					valid ? bin_index : -1, 
+					mirror_valid ? mirror_index : -1);
+#else
+			if ( valid && bin_index < (long long)hist->n_bins ) {
+				hist->counts[histogram_index][bin_index]++;
+			}
+#endif
+		}
+#if GN_KERNEL_ORDER == 3
+		}
+#endif
+	}
+}
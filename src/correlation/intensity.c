@@ -36,14 +36,77 @@
 #include "../modes.h"
 #include "../error.h"
 #include "multi_tau.h"
+#include "multi_tau_pool.h"
 
 int intensity_correlate_g2_log(FILE *stream_in, FILE *stream_out, 
 		pc_options_t const *options) {
 	int result = PC_SUCCESS;
-	multi_tau_g2cn_t *mt;
+	multi_tau_pool_t *pool = NULL;
+	multi_tau_g2c1_t *mt1 = NULL;
 	intensity_photon_t *intensity;
 
-	mt = multi_tau_g2cn_alloc(options->binning, options->registers, 
+	if ( options->channels == 1 ) {
+		mt1 = multi_tau_g2c1_alloc(options->binning, options->registers, 
+				options->depth, 1);
+	} else {
+		pool = multi_tau_pool_alloc(options->threads, 
+				options->binning, options->registers, 
+				options->depth, options->channels, 1);
+	}
+	intensity = intensity_photon_alloc(options->channels, MODE_T2);
+
+	if ( (pool == NULL && mt1 == NULL) || intensity == NULL ) {
+		error("Could not allocate correlator or intensity stream.\n");
+		result = PC_ERROR_MEM;
+	}
+
+	if ( result == PC_SUCCESS && pool != NULL ) {
+		result = multi_tau_pool_start(pool);
+	}
+
+	if ( result == PC_SUCCESS ) {
+		intensity_photon_init_stream(intensity, stream_in);
+		intensity_photon_skip_empty(intensity, true);
+
+		if ( mt1 != NULL ) {
+			multi_tau_g2c1_init(mt1);
+
+			while ( intensity_photon_next(intensity) == PC_SUCCESS ) {
+				multi_tau_g2c1_push_empty(mt1, intensity->empty);
+				multi_tau_g2c1_push(mt1, intensity->counts);
+			}
+		} else {
+			multi_tau_pool_init(pool);
+
+			while ( intensity_photon_next(intensity) == PC_SUCCESS ) {
+				multi_tau_pool_push(pool, intensity->counts, 
+						intensity->empty);
+			}
+		}
+	}
+
+	if ( result == PC_SUCCESS ) {
+		if ( mt1 != NULL ) {
+			multi_tau_g2c1_fprintf(stream_out, mt1);
+		} else {
+			multi_tau_pool_fprintf(stream_out, pool);
+		}
+	}
+
+	multi_tau_pool_free(&pool);
+	multi_tau_g2c1_free(&mt1);
+	intensity_photon_free(&intensity);
+
+	return(PC_SUCCESS);
+}
+
+int intensity_correlate_g3_log(FILE *stream_in, FILE *stream_out, 
+		pc_options_t const *options) {
+	int result = PC_SUCCESS;
+	multi_tau_g3cn_t *mt;
+	intensity_photon_t *intensity;
+
+	mt = multi_tau_g3cn_alloc(options->binning, options->registers, 
 			options->depth, options->channels, 1);
 	intensity = intensity_photon_alloc(options->channels, MODE_T2);
 
@@ -54,18 +117,20 @@ int intensity_correlate_g2_log(FILE *stream_in, FILE *stream_out,
 
 	if ( result == PC_SUCCESS ) {
 		intensity_photon_init_stream(intensity, stream_in);
-		multi_tau_g2cn_init(mt);
+		intensity_photon_skip_empty(intensity, true);
+		multi_tau_g3cn_init(mt);
 
 		while ( intensity_photon_next(intensity) == PC_SUCCESS ) {
-			multi_tau_g2cn_push(mt, intensity->counts);
+			multi_tau_g3cn_push_empty(mt, intensity->empty);
+			multi_tau_g3cn_push(mt, intensity->counts);
 		}
 	}
 
 	if ( result == PC_SUCCESS ) {
-		multi_tau_g2cn_fprintf(stream_out, mt);
+		multi_tau_g3cn_fprintf(stream_out, mt);
 	}
 
-	multi_tau_g2cn_free(&mt);
+	multi_tau_g3cn_free(&mt);
 	intensity_photon_free(&intensity);
 
 	return(PC_SUCCESS);
@@ -75,6 +140,8 @@ int intensity_correlate_dispatch(FILE *stream_in, FILE *stream_out,
 		pc_options_t const *options) {
 	if ( options->order == 2 ) { //&& options->time_scale == SCALE_LOG ) {
 		return(intensity_correlate_g2_log(stream_in, stream_out, options));
+	} else if ( options->order == 3 ) {
+		return(intensity_correlate_g3_log(stream_in, stream_out, options));
 	} else {
 		error("Correlation mode not supported: order %u and scale %d\n",
 				options->order, options->time_scale);
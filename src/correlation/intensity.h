@@ -37,6 +37,8 @@
 
 int intensity_correlate_g2_log(FILE *stream_in, FILE *stream_out,
 		pc_options_t const *options);
+int intensity_correlate_g3_log(FILE *stream_in, FILE *stream_out,
+		pc_options_t const *options);
 int intensity_correlate_dispatch(FILE *stream_in, FILE *stream_out,
 		pc_options_t const *options);
 
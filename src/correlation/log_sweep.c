@@ -0,0 +1,398 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "log_sweep.h"
+#include "../error.h"
+
+/*
+ * For g2 on a logarithmic time axis the bins far from zero are very wide,
+ * and walking through every pair within the maximum distance, as the 
+ * linear sweep does, costs far more than the bins themselves. Instead, as
+ * in the time-tag correlators of Wahl et al. and Laurence et al., each 
+ * channel pair keeps an index into the photons of its second channel for 
+ * every bin edge. The edges of a photon only ever lie later than those of 
+ * the photons before it, so each index just moves forward to the first 
+ * photon past its edge, and the number of pairs in a bin is the difference
+ * of the indices at its edges. The work per photon is then proportional to 
+ * the number of bins, however many photons lie within the maximum distance.
+ *
+ * The bins of the histogram need not be found by any particular formula: 
+ * the edges are found once, as the smallest distance which the histogram 
+ * places in each bin, so the counts match those of the general correlator
+ * exactly. A photon is counted once all photons within the maximum distance 
+ * after it have arrived, or when the stream is flushed.
+ *
+ * Pairs of simultaneous photons, which appear in both orderings, are 
+ * counted as the second of them arrives, as in the linear sweep.
+ */
+static long long log_sweep_threshold(edges_t const *edges, int const bin,
+		long long lower, long long upper) {
+/* The smallest distance from lower to upper in the given bin or above, or 
+ * upper if there is none. The bins never decrease with distance. */
+	long long middle;
+
+	while ( lower < upper ) {
+		middle = lower + (upper - lower)/2;
+
+		if ( edges->get_index(edges, middle) >= bin ) {
+			upper = middle;
+		} else {
+			lower = middle + 1;
+		}
+	}
+
+	return(lower);
+}
+
+log_sweep_t *log_sweep_alloc(unsigned int const channels, 
+		size_t const queue_size, edges_t const *edges,
+		long long const min_time_distance, long long const max_time_distance) {
+	unsigned int c;
+	size_t k;
+	int zero_bin;
+	long long lower;
+	long long upper;
+	log_sweep_t *sweep = NULL;
+
+	sweep = (log_sweep_t *)malloc(sizeof(log_sweep_t));
+
+	if ( sweep == NULL ) {
+		return(sweep);
+	}
+
+	sweep->channels = channels;
+	sweep->min_time_distance = min_time_distance;
+	sweep->max_time_distance = max_time_distance;
+	sweep->n_bins = edges->n_bins;
+
+	sweep->thresholds = (long long *)malloc(sizeof(long long)*
+			(sweep->n_bins + 1));
+	sweep->time = (long long **)calloc(channels, sizeof(long long *));
+	sweep->capacity = (size_t *)malloc(sizeof(size_t)*channels);
+	sweep->size = (size_t *)malloc(sizeof(size_t)*channels);
+	sweep->base = (unsigned long long *)malloc(
+			sizeof(unsigned long long)*channels);
+	sweep->next = (unsigned long long *)malloc(
+			sizeof(unsigned long long)*channels);
+	sweep->sources = (unsigned long long *)malloc(
+			sizeof(unsigned long long)*channels);
+	sweep->pointers = (unsigned long long *)malloc(
+			sizeof(unsigned long long)*channels*channels*(sweep->n_bins + 1));
+
+	if ( sweep->thresholds == NULL || sweep->time == NULL || 
+			sweep->capacity == NULL || sweep->size == NULL || 
+			sweep->base == NULL || sweep->next == NULL || 
+			sweep->sources == NULL || sweep->pointers == NULL ) {
+		log_sweep_free(&sweep);
+		return(sweep);
+	}
+
+	for ( c = 0; c < channels; c++ ) {
+		sweep->capacity[c] = queue_size/channels + 1;
+		sweep->time[c] = (long long *)malloc(sizeof(long long)*
+				sweep->capacity[c]);
+
+		if ( sweep->time[c] == NULL ) {
+			log_sweep_free(&sweep);
+			return(sweep);
+		}
+	}
+
+	lower = min_time_distance > 1 ? min_time_distance : 1;
+	upper = max_time_distance > lower ? max_time_distance : lower;
+
+	for ( k = 0; k <= sweep->n_bins; k++ ) {
+		sweep->thresholds[k] = log_sweep_threshold(edges, k, lower, upper);
+	}
+
+	zero_bin = edges->get_index(edges, 0);
+	if ( min_time_distance == 0 && max_time_distance > 0 &&
+			zero_bin >= 0 && zero_bin < sweep->n_bins ) {
+		sweep->zero_bin = zero_bin;
+	} else {
+		sweep->zero_bin = -1;
+	}
+
+	log_sweep_init(sweep);
+
+	return(sweep);
+}
+
+void log_sweep_init(log_sweep_t *sweep) {
+	unsigned int c;
+
+	for ( c = 0; c < sweep->channels; c++ ) {
+		sweep->size[c] = 0;
+		sweep->base[c] = 0;
+		sweep->next[c] = 0;
+		sweep->sources[c] = 0;
+	}
+
+	memset(sweep->pointers, 0, sizeof(unsigned long long)*
+			sweep->channels*sweep->channels*(sweep->n_bins + 1));
+
+	sweep->latest = 0;
+	front_limit_init(&(sweep->limit));
+}
+
+void log_sweep_set_limit(log_sweep_t *sweep, unsigned long long const limit) {
+/* Only count pairs whose earlier photon is among the first limit pushed. */
+	front_limit_set(&(sweep->limit), limit);
+}
+
+void log_sweep_free(log_sweep_t **sweep) {
+	unsigned int c;
+
+	if ( *sweep != NULL ) {
+		for ( c = 0; (*sweep)->time != NULL && c < (*sweep)->channels; c++ ) {
+			free((*sweep)->time[c]);
+		}
+
+		free((*sweep)->time);
+		free((*sweep)->thresholds);
+		free((*sweep)->capacity);
+		free((*sweep)->size);
+		free((*sweep)->base);
+		free((*sweep)->next);
+		free((*sweep)->sources);
+		free((*sweep)->pointers);
+		free(*sweep);
+		*sweep = NULL;
+	}
+}
+
+static void log_sweep_source(log_sweep_t *sweep, histogram_gn_t *hist,
+		unsigned int const c0, long long const time) {
+/* Count the pairs of one photon with all later photons within range. */
+	unsigned int c1;
+	size_t k;
+	size_t const n_bins = sweep->n_bins;
+	long long const *thresholds = sweep->thresholds;
+	long long const *times;
+	unsigned long long *pointers;
+	unsigned long long *counts;
+	unsigned long long base;
+	unsigned long long end;
+	unsigned long long pointer;
+	long long edge;
+	int histogram_index;
+
+	for ( c1 = 0; c1 < sweep->channels; c1++ ) {
+		histogram_index = hist->histogram_map[c0*sweep->channels + c1];
+
+		if ( histogram_index < 0 ) {
+			continue;
+		}
+
+		counts = hist->counts[histogram_index];
+		pointers = &(sweep->pointers[(c0*sweep->channels + c1)*(n_bins + 1)]);
+		times = sweep->time[c1];
+		base = sweep->base[c1];
+		end = base + sweep->size[c1];
+
+		/* Photons dropped from the front are before every edge to come. */
+		pointer = base;
+
+		for ( k = 0; k <= n_bins; k++ ) {
+			if ( pointers[k] > pointer ) {
+				pointer = pointers[k];
+			}
+
+			edge = time + thresholds[k];
+			while ( pointer < end && times[pointer - base] < edge ) {
+				pointer++;
+			}
+
+			pointers[k] = pointer;
+
+			if ( k > 0 ) {
+				counts[k-1] += pointers[k] - pointers[k-1];
+			}
+		}
+	}
+}
+
+static void log_sweep_count(log_sweep_t *sweep, histogram_gn_t *hist, 
+		int const all, long long const before) {
+/* Count every photon whose range ends at or before the given time. */
+	unsigned int c;
+	long long time;
+	long long const range = sweep->thresholds[sweep->n_bins];
+
+	for ( c = 0; c < sweep->channels; c++ ) {
+		while ( sweep->next[c] < sweep->sources[c] ) {
+			time = sweep->time[c][sweep->next[c] - sweep->base[c]];
+
+			if ( ! all && time + range > before ) {
+				break;
+			}
+
+			log_sweep_source(sweep, hist, c, time);
+			sweep->next[c]++;
+		}
+	}
+}
+
+static int log_sweep_make_room(log_sweep_t *sweep, unsigned int const channel) {
+/* Drop the photons of the channel which no photon still to be counted can
+ * reach, or make the channel larger if that would not free enough room. */
+	unsigned int c;
+	size_t lower;
+	size_t upper;
+	size_t middle;
+	long long oldest = sweep->latest;
+	long long *time;
+	long long const *times;
+
+	for ( c = 0; c < sweep->channels; c++ ) {
+		if ( sweep->next[c] < sweep->sources[c] ) {
+			times = sweep->time[c];
+			if ( times[sweep->next[c] - sweep->base[c]] < oldest ) {
+				oldest = times[sweep->next[c] - sweep->base[c]];
+			}
+		}
+	}
+
+	times = sweep->time[channel];
+	lower = 0;
+	upper = sweep->size[channel];
+
+	while ( lower < upper ) {
+		middle = lower + (upper - lower)/2;
+
+		if ( times[middle] < oldest ) {
+			lower = middle + 1;
+		} else {
+			upper = middle;
+		}
+	}
+
+	if ( lower >= sweep->capacity[channel]/2 ) {
+		memmove(sweep->time[channel], &(sweep->time[channel][lower]),
+				sizeof(long long)*(sweep->size[channel] - lower));
+		sweep->size[channel] -= lower;
+		sweep->base[channel] += lower;
+		return(PC_SUCCESS);
+	}
+
+	warn("Queue needs to be expanded. It may be worthwhile to "
+			"perform this at the start of the calculation instead by "
+			"passing --queue-size.\n");
+
+	time = (long long *)realloc(sweep->time[channel], 
+			sizeof(long long)*sweep->capacity[channel]*2);
+
+	if ( time == NULL ) {
+		error("Could not resize the queue after an overflow.\n");
+		return(PC_ERROR_MEM);
+	}
+
+	sweep->time[channel] = time;
+	sweep->capacity[channel] *= 2;
+
+	return(PC_SUCCESS);
+}
+
+int log_sweep_push(log_sweep_t *sweep, histogram_gn_t *hist, 
+		photon_t const *photon) {
+	unsigned int c;
+	size_t i;
+	int histogram_index;
+	long long const time = photon->t2.time;
+	unsigned int const channel = photon->t2.channel;
+	int const * const map = hist->histogram_map;
+	int result;
+
+	if ( channel >= sweep->channels || ! hist->channel_selected[channel] ) {
+		front_limit_push(&(sweep->limit), false);
+
+		/* Photons on unselected channels are simply left out. */
+		if ( channel < sweep->channels ) {
+			return(PC_SUCCESS);
+		}
+
+		error("Invalid histogram index requested for channel %u "
+				"(limit %u). Check that you have specified the correct "
+				"number of channels.\n", 
+				channel, sweep->channels);
+
+		return(PC_ERROR_INDEX);
+	}
+
+	log_sweep_count(sweep, hist, false, time);
+
+	if ( sweep->zero_bin >= 0 ) {
+		for ( c = 0; c < sweep->channels; c++ ) {
+			for ( i = sweep->size[c]; i > 0 && 
+					sweep->time[c][i-1] == time; i-- ) {
+				if ( sweep->base[c] + i - 1 >= sweep->sources[c] ) {
+					continue;
+				}
+
+				histogram_index = map[c*sweep->channels + channel];
+				if ( histogram_index >= 0 ) {
+					hist->counts[histogram_index][sweep->zero_bin]++;
+				}
+
+				histogram_index = map[channel*sweep->channels + c];
+				if ( histogram_index >= 0 ) {
+					hist->counts[histogram_index][sweep->zero_bin]++;
+				}
+			}
+		}
+	}
+
+	sweep->latest = time;
+
+	if ( sweep->size[channel] == sweep->capacity[channel] ) {
+		result = log_sweep_make_room(sweep, channel);
+
+		if ( result != PC_SUCCESS ) {
+			return(result);
+		}
+	}
+
+	sweep->time[channel][sweep->size[channel]++] = time;
+
+	if ( front_limit_push(&(sweep->limit), true) ) {
+		sweep->sources[channel] = sweep->base[channel] + sweep->size[channel];
+	}
+
+	return(PC_SUCCESS);
+}
+
+int log_sweep_flush(log_sweep_t *sweep, histogram_gn_t *hist) {
+	log_sweep_count(sweep, hist, true, 0);
+	return(PC_SUCCESS);
+}
@@ -38,15 +38,58 @@
 #include "../combinatorics/combinations.h"
 #include "../error.h"
 
-/* as a naive method, we want to keep the signal as a fixed n x m x p array.
- * However, since we are doing a lot of rotation of bins, it is worthwhile
- * to use pointers to array and shuffle those pointers. This saves the cost
- * of memmoves for each step (hopefully...).
+/* The registers of each level form a ring, so a push only moves the index 
+ * of the newest register rather than shifting the signal. All of the arrays
+ * are contiguous and aligned, so that for a given lag the products of one 
+ * channel with all others run along a row of g2 and the signal, which the 
+ * compiler can vectorize.
  */
+#define MULTI_TAU_ALIGNMENT 64
+
+/* On x86-64 with GCC, the row update is also built for AVX2 and the version
+ * for the running processor is chosen when the program loads. */
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__) && \
+		defined(__linux__)
+#define MULTI_TAU_TARGETS __attribute__((target_clones("avx2", "default")))
+#else
+#define MULTI_TAU_TARGETS
+#endif
+
+MULTI_TAU_TARGETS
+static void multi_tau_row_add(double * restrict row, 
+		double const * restrict past, double const value, 
+		size_t const channels) {
+/* row += value*past, unrolled so that each group of four maps onto vector
+ * registers. */
+	size_t c;
+
+	for ( c = 0; c + 4 <= channels; c += 4 ) {
+		row[c] += value*past[c];
+		row[c+1] += value*past[c+1];
+		row[c+2] += value*past[c+2];
+		row[c+3] += value*past[c+3];
+	}
+
+	for ( ; c < channels; c++ ) {
+		row[c] += value*past[c];
+	}
+}
+
+static double *multi_tau_doubles_alloc(size_t const n) {
+	void *values = NULL;
+
+	if ( posix_memalign(&values, MULTI_TAU_ALIGNMENT, 
+				sizeof(double)*(n > 0 ? n : 1)) != 0 ) {
+		return(NULL);
+	}
+
+	return((double *)values);
+}
+
 multi_tau_g2cn_t *multi_tau_g2cn_alloc(unsigned int const binning,
 		unsigned int const registers, unsigned int const depth,
 		unsigned int const channels, unsigned long long const bin_width) {
-	int i, j, c0;
+	int i, j;
 	int result = PC_SUCCESS;
 	multi_tau_g2cn_t *mt = NULL;
 
@@ -65,7 +108,7 @@ multi_tau_g2cn_t *multi_tau_g2cn_alloc(unsigned int const binning,
 	}
 
 	if ( result == PC_SUCCESS ) {
-		mt = (multi_tau_g2cn_t *)malloc(sizeof(multi_tau_g2cn_t));
+		mt = (multi_tau_g2cn_t *)calloc(1, sizeof(multi_tau_g2cn_t));
 
 		if ( mt == NULL ) {
 			result = PC_ERROR_MEM;
@@ -79,307 +122,879 @@ multi_tau_g2cn_t *multi_tau_g2cn_alloc(unsigned int const binning,
 		mt->channels = channels;
 
 		mt->bin_width = bin_width;
-	
-		mt->intensity = (double *)malloc(sizeof(double)*mt->channels);
-		mt->pushes = (unsigned long long *)malloc(sizeof(unsigned long long)
-				*mt->depth);
 
-		if ( mt->intensity == NULL || mt->pushes == NULL ) {
-			error("Could not allocate intensity or pushes.\n");
+		mt->row_first = 0;
+		mt->row_last = channels;
+	
+		mt->intensity = multi_tau_doubles_alloc(channels);
+		mt->signal = multi_tau_doubles_alloc(
+				(size_t)depth*registers*channels);
+		mt->newest = (unsigned int *)malloc(sizeof(unsigned int)*depth);
+		mt->accumulated = multi_tau_doubles_alloc((size_t)depth*channels);
+		mt->pushes = (unsigned long long *)malloc(
+				sizeof(unsigned long long)*depth);
+		mt->averages = multi_tau_doubles_alloc((size_t)depth*channels);
+		mt->g2 = multi_tau_doubles_alloc(
+				(size_t)depth*registers*channels*channels);
+		mt->tau = (unsigned long long *)malloc(
+				sizeof(unsigned long long)*depth*registers);
+
+		if ( mt->intensity == NULL || mt->signal == NULL || 
+				mt->newest == NULL || mt->accumulated == NULL ||
+				mt->pushes == NULL || mt->averages == NULL ||
+				mt->g2 == NULL || mt->tau == NULL ) {
+			error("Could not allocate the multi-tau registers.\n");
 			result = PC_ERROR_MEM;
 		}
 	}
 
 	if ( result == PC_SUCCESS ) {
-		mt->signal = (double ***)malloc(sizeof(double **)*mt->depth);
-		if ( mt->signal == NULL ) {
-			result = PC_ERROR_MEM;
-		} 
+		for ( i = 0; i < mt->depth; i++ ) {
+			for ( j = 0; j < mt->registers; j++ ) {
+				mt->tau[i*mt->registers + j] = j*powull(mt->binning, i);
+			}
+		}
+	}
+
+	if ( result != PC_SUCCESS ) {
+		multi_tau_g2cn_free(&mt);
+		mt = NULL;
+	} 
+	
+	return(mt);
+}
+
+void multi_tau_g2cn_init(multi_tau_g2cn_t *mt) {
+	size_t const channels = mt->channels;
+	size_t const depth = mt->depth;
+	size_t const registers = mt->registers;
+
+	mt->n_seen = 0;
+
+	memset(mt->intensity, 0, sizeof(double)*channels);
+	memset(mt->signal, 0, sizeof(double)*depth*registers*channels);
+	memset(mt->newest, 0, sizeof(unsigned int)*depth);
+	memset(mt->accumulated, 0, sizeof(double)*depth*channels);
+	memset(mt->pushes, 0, sizeof(unsigned long long)*depth);
+	memset(mt->averages, 0, sizeof(double)*depth*channels);
+	memset(mt->g2, 0, sizeof(double)*depth*registers*channels*channels);
+}
+
+void multi_tau_g2cn_free(multi_tau_g2cn_t **mt) {
+	if ( *mt != NULL ) {
+		free((*mt)->intensity);
+		free((*mt)->signal);
+		free((*mt)->newest);
+		free((*mt)->accumulated);
+		free((*mt)->pushes);
+		free((*mt)->averages);
+		free((*mt)->g2);
+		free((*mt)->tau);
+		free(*mt);
+		*mt = NULL;
+	}
+}
 
-		for ( i = 0; result == PC_SUCCESS && i < mt->depth; i++ ) {
-			mt->signal[i] = (double **)malloc(sizeof(double *)*mt->registers);
-			if ( mt->signal[i] == NULL ) {
-				result = PC_ERROR_MEM;
+static void multi_tau_g2cn_push_levels(multi_tau_g2cn_t *mt, 
+		unsigned int const level) {
+/* Push the current intensity into the given level, carrying the bin averages
+ * on to the levels above as they fill. */
+	unsigned int i, j, c0;
+	unsigned int first, last;
+	unsigned int reg;
+	unsigned int const channels = mt->channels;
+	unsigned int const registers = mt->registers;
+	double const *current;
+	double const *past;
+	double *signal;
+	double *accumulated;
+	double *averages;
+	double *row;
+
+	for ( i = level; i < mt->depth; i++ ) {
+		signal = &(mt->signal[(size_t)i*registers*channels]);
+		accumulated = &(mt->accumulated[(size_t)i*channels]);
+		averages = &(mt->averages[(size_t)i*channels]);
+
+		/* The oldest register of the ring becomes the newest. */
+		mt->newest[i] = mt->newest[i] == 0 ? 
+				registers - 1 : mt->newest[i] - 1;
+		memcpy(&(signal[(size_t)mt->newest[i]*channels]), mt->intensity, 
+				sizeof(double)*channels);
+		current = &(signal[(size_t)mt->newest[i]*channels]);
+
+		for ( c0 = 0; c0 < channels; c0++ ) {
+			accumulated[c0] += mt->intensity[c0];
+			averages[c0] += current[c0];
+		}
+
+		mt->pushes[i]++;
+
+		/* This row just saw a push, so update its correlation. */
+		first = (i == 0 ? 0 : registers/mt->binning);
+		last = mt->pushes[i] < registers ? mt->pushes[i] : registers;
+
+		for ( j = first; j < last; j++ ) {
+			reg = mt->newest[i] + j;
+			if ( reg >= registers ) {
+				reg -= registers;
 			}
 
-			for ( j = 0; result == PC_SUCCESS && j < mt->registers; j++ ) {
-				mt->signal[i][j] = (double *)malloc(sizeof(double)*
-						mt->channels);
-				if ( mt->signal[i][j] == NULL ) {
-					result = PC_ERROR_MEM;
-				}
+			past = &(signal[(size_t)reg*channels]);
+			row = &(mt->g2[((size_t)i*registers + j)*channels*channels +
+					(size_t)mt->row_first*channels]);
+
+			for ( c0 = mt->row_first; c0 < mt->row_last; c0++ ) {
+				multi_tau_row_add(row, past, current[c0], channels);
+				row += channels;
 			}
 		}
-	}
 
-	if ( result == PC_SUCCESS ) {
-		mt->accumulated = (double **)malloc(sizeof(double *)*mt->depth);
-		if ( mt->accumulated == NULL ) {
-			result = PC_ERROR_MEM;
-		} else {
-			for ( i = 0; i < mt->depth; i++ ) {
-				mt->accumulated[i] = (double *)malloc(sizeof(double)*
-						mt->channels);
-				if ( mt->accumulated[i] == NULL ) {
-					result = PC_ERROR_MEM;
-				}
+		if ( mt->pushes[i] % mt->binning == 0 ) {
+			for ( c0 = 0; c0 < channels; c0++ ) {
+				mt->intensity[c0] = accumulated[c0]/mt->binning;
+				accumulated[c0] = 0;
 			}
+		} else {
+			break;
 		}
 	}
+}
 
-	if ( result == PC_SUCCESS ) {
-		mt->averages = (double **)malloc(sizeof(double *)*mt->depth);
-		if ( mt->averages == NULL ) {
-			result = PC_ERROR_MEM;
-		} else {
+void multi_tau_g2cn_set_rows(multi_tau_g2cn_t *mt, 
+		unsigned int const row_first, unsigned int const row_last) {
+	mt->row_first = row_first;
+	mt->row_last = row_last;
+}
+
+void multi_tau_g2cn_copy_rows(multi_tau_g2cn_t *mt, 
+		multi_tau_g2cn_t const *other) {
+/* Take the rows of g2 computed by the other correlator. */
+	size_t i;
+	size_t const channels = mt->channels;
+	size_t const rows = (size_t)mt->depth*mt->registers;
+	size_t const offset = other->row_first*channels;
+
+	for ( i = 0; i < rows; i++ ) {
+		memcpy(&(mt->g2[i*channels*channels + offset]), 
+				&(other->g2[i*channels*channels + offset]),
+				sizeof(double)*(other->row_last - other->row_first)*channels);
+	}
+}
+
+void multi_tau_g2cn_push(multi_tau_g2cn_t *mt, counts_t const *counts) {
+	unsigned int c0;
+
+	mt->n_seen++;
+
+	for ( c0 = 0; c0 < mt->channels; c0++ ) {
+		mt->intensity[c0] = (double)counts->counts[c0];
+	}
+
+	multi_tau_g2cn_push_levels(mt, 0);
+}
+
+void multi_tau_g2cn_push_empty(multi_tau_g2cn_t *mt, 
+		unsigned long long const n) {
+/* An empty push adds nothing to the sums or products, so it only moves the
+ * ring and zeroes the register it lands on; past the size of the ring, every
+ * register is zero and the pushes need only be counted. Of the n empty pushes
+ * into a level, the first ones complete the bin in progress, whose average 
+ * goes up as an ordinary push, and the rest form whole empty bins, which go
+ * up as empty pushes in turn.
+ */
+	unsigned int i, j, c0;
+	unsigned int const channels = mt->channels;
+	unsigned int const registers = mt->registers;
+	unsigned long long remaining = n;
+	unsigned long long fill;
+	double *signal;
+	double *accumulated;
+
+	mt->n_seen += n;
+
+	for ( i = 0; i < mt->depth && remaining > 0; i++ ) {
+		signal = &(mt->signal[(size_t)i*registers*channels]);
+		accumulated = &(mt->accumulated[(size_t)i*channels]);
+
+		for ( j = 0; j < registers && j < remaining; j++ ) {
+			mt->newest[i] = mt->newest[i] == 0 ? 
+					registers - 1 : mt->newest[i] - 1;
+			memset(&(signal[(size_t)mt->newest[i]*channels]), 0, 
+					sizeof(double)*channels);
+		}
+
+		fill = mt->binning - mt->pushes[i] % mt->binning;
+		mt->pushes[i] += remaining;
+
+		if ( remaining < fill ) {
+			break;
+		}
+
+		for ( c0 = 0; c0 < channels; c0++ ) {
+			mt->intensity[c0] = accumulated[c0]/mt->binning;
+			accumulated[c0] = 0;
+		}
+
+		remaining = (remaining - fill)/mt->binning;
+
+		if ( i + 1 < mt->depth ) {
+			multi_tau_g2cn_push_levels(mt, i + 1);
+		}
+	}
+}
+
+int multi_tau_g2cn_fprintf(FILE *stream_out, multi_tau_g2cn_t const *mt) {
+	unsigned int i, j, c0, c1;
+	unsigned int const channels = mt->channels;
+	double normalization;
+	double correlation;
+	double const *averages;
+	unsigned long long tau;
+
+	for ( c0 = 0; c0 < channels; c0++ ) {
+		for ( c1 = 0; c1 < channels; c1++ ) {
 			for ( i = 0; i < mt->depth; i++ ) {
-				mt->averages[i] = (double *)malloc(sizeof(double)*
-						mt->channels);
-				if ( mt->averages[i] == NULL ) {
-					result = PC_ERROR_MEM;
+				averages = &(mt->averages[(size_t)i*channels]);
+
+				for ( j = (i == 0 ? 0 : mt->registers/mt->binning);
+						j < mt->registers; j++ ) {
+					if ( mt->n_seen == 0 || mt->pushes[i] <=  j ) {
+						normalization = 0;
+					} else {
+						normalization = 1;
+						normalization *= mt->pushes[i];
+						normalization *= (double)averages[c0]/
+								(double)mt->pushes[i];
+						normalization *= (double)averages[c1]/
+								(double)mt->pushes[i]; 
+						/* correct for the undersampling of various bins */
+						normalization *= (double)(mt->pushes[i]-j)/
+								(double)mt->pushes[i];
+					}
+
+					if ( normalization <= 0 ) {
+						correlation = 0;
+					} else {
+						correlation = mt->g2[
+								(((size_t)i*mt->registers + j)*channels + c0)*
+								channels + c1]/normalization;
+					}
+
+					tau = mt->tau[i*mt->registers + j];
+					fprintf(stream_out,
+							"%u,%u,%g,%g,%lf\n",
+							c0, 
+							c1,
+							(double)tau*mt->bin_width,
+							(double)(tau+pow_int(mt->binning, i))
+									*mt->bin_width,
+							correlation); 
 				}
 			}
 		}
 	}
 
+	return( ferror(stream_out) ? PC_ERROR_IO : PC_SUCCESS );
+}
+
+multi_tau_g2c1_t *multi_tau_g2c1_alloc(unsigned int const binning,
+		unsigned int const registers, unsigned int const depth,
+		unsigned long long const bin_width) {
+	int i, j;
+	int result = PC_SUCCESS;
+	multi_tau_g2c1_t *mt = NULL;
+
+	if ( binning > registers ) {
+		error("Binning must be smaller than the number of registers.\n");
+		result = PC_ERROR_OPTIONS;
+	} else if ( binning == 0 ) {
+		error("Binning must be non-zero.\n");
+		result = PC_ERROR_OPTIONS;
+	} else if ( depth == 0 ) {
+		error("Depth must be non-zero.\n");
+		result = PC_ERROR_OPTIONS;
+	}
+
 	if ( result == PC_SUCCESS ) {
-		mt->g2 = (double ****)malloc(sizeof(double ***)*mt->depth);
-		if ( mt->g2 == NULL ) {
+		mt = (multi_tau_g2c1_t *)calloc(1, sizeof(multi_tau_g2c1_t));
+
+		if ( mt == NULL ) {
 			result = PC_ERROR_MEM;
 		}
+	}
 
-		for ( i = 0; result == PC_SUCCESS && i < mt->depth; i++ ) {
-			mt->g2[i] = (double ***)malloc(sizeof(double **)*mt->registers);
-			if ( mt->g2[i] == NULL ) {
-				result = PC_ERROR_MEM;
-			}
+	if ( result == PC_SUCCESS ) {
+		mt->binning = binning;
+		mt->registers = registers;
+		mt->depth = depth;
 
-			for ( j = 0; result == PC_SUCCESS && j < mt->registers; j++ ) {
-				mt->g2[i][j] = (double **)malloc(sizeof(double *)*mt->channels);
-				if ( mt->g2[i][j] == NULL ) {
-					result = PC_ERROR_MEM;
-				}
+		mt->bin_width = bin_width;
 
-				for ( c0 = 0; result == PC_SUCCESS && c0 < mt->channels; 
-						c0++ ) {
-					mt->g2[i][j][c0] = (double *)malloc(sizeof(double)*
-							mt->channels);
-					if ( mt->g2[i][j][c0] == NULL ) {
-						result = PC_ERROR_MEM;
-					}
-				}
-			}
+		mt->counts = (unsigned long long *)malloc(
+				sizeof(unsigned long long)*registers);
+		mt->counts_g2 = (unsigned long long *)malloc(
+				sizeof(unsigned long long)*registers);
+		mt->signal = multi_tau_doubles_alloc((size_t)depth*registers);
+		mt->newest = (unsigned int *)malloc(sizeof(unsigned int)*depth);
+		mt->accumulated = multi_tau_doubles_alloc(depth);
+		mt->pushes = (unsigned long long *)malloc(
+				sizeof(unsigned long long)*depth);
+		mt->averages = multi_tau_doubles_alloc(depth);
+		mt->g2 = multi_tau_doubles_alloc((size_t)depth*registers);
+		mt->tau = (unsigned long long *)malloc(
+				sizeof(unsigned long long)*depth*registers);
+
+		if ( mt->counts == NULL || mt->counts_g2 == NULL ||
+				mt->signal == NULL || mt->newest == NULL || 
+				mt->accumulated == NULL || mt->pushes == NULL || 
+				mt->averages == NULL || mt->g2 == NULL || mt->tau == NULL ) {
+			error("Could not allocate the multi-tau registers.\n");
+			result = PC_ERROR_MEM;
 		}
 	}
 
 	if ( result == PC_SUCCESS ) {
-		mt->tau = (unsigned long long **)malloc(sizeof(unsigned long long *)*
-				mt->depth);
-		if ( mt->tau != NULL ) {
-			for ( i = 0; result == PC_SUCCESS && i < mt->depth; i++ ) {
-				mt->tau[i] = (unsigned long long *)malloc(
-						sizeof(unsigned long long)*mt->registers);
-				if ( mt->tau[i] == NULL ) {
-					result = PC_ERROR_MEM;
-				} else {
-					for ( j = 0; j < mt->registers; j++ ) {
-						mt->tau[i][j] = j*powull(mt->binning, i);
-					}
-				}
+		for ( i = 0; i < mt->depth; i++ ) {
+			for ( j = 0; j < mt->registers; j++ ) {
+				mt->tau[i*mt->registers + j] = j*powull(mt->binning, i);
 			}
 		}
 	}
 
 	if ( result != PC_SUCCESS ) {
-		multi_tau_g2cn_free(&mt);
+		multi_tau_g2c1_free(&mt);
 		mt = NULL;
 	} 
 	
 	return(mt);
 }
 
-void multi_tau_g2cn_init(multi_tau_g2cn_t *mt) {
-	int i, j, c0;
+void multi_tau_g2c1_init(multi_tau_g2c1_t *mt) {
+	size_t const depth = mt->depth;
+	size_t const registers = mt->registers;
 
 	mt->n_seen = 0;
 
-	memset(mt->intensity, (double)0, sizeof(double)*mt->channels);
-	memset(mt->pushes, 0, sizeof(unsigned int)*mt->depth);
+	memset(mt->counts, 0, sizeof(unsigned long long)*registers);
+	mt->counts_accumulated = 0;
+	mt->counts_total = 0;
+	memset(mt->counts_g2, 0, sizeof(unsigned long long)*registers);
+
+	memset(mt->signal, 0, sizeof(double)*depth*registers);
+	memset(mt->newest, 0, sizeof(unsigned int)*depth);
+	memset(mt->accumulated, 0, sizeof(double)*depth);
+	memset(mt->pushes, 0, sizeof(unsigned long long)*depth);
+	memset(mt->averages, 0, sizeof(double)*depth);
+	memset(mt->g2, 0, sizeof(double)*depth*registers);
+}
 
-	for ( i = 0; i < mt->depth; i++ ) {
-		memset(mt->accumulated[i], 0, sizeof(double)*mt->channels);
-		memset(mt->averages[i], 0, sizeof(double)*mt->channels);
-		
-		for ( j = 0; j < mt->registers; j++ ) {
-			memset(mt->signal[i][j], 0, sizeof(double)*mt->channels);
-
-			for ( c0 = 0; c0 < mt->channels; c0++ ) {
-				memset(mt->g2[i][j][c0], 0, sizeof(double)*mt->channels);
-			}
-		}
+void multi_tau_g2c1_free(multi_tau_g2c1_t **mt) {
+	if ( *mt != NULL ) {
+		free((*mt)->counts);
+		free((*mt)->counts_g2);
+		free((*mt)->signal);
+		free((*mt)->newest);
+		free((*mt)->accumulated);
+		free((*mt)->pushes);
+		free((*mt)->averages);
+		free((*mt)->g2);
+		free((*mt)->tau);
+		free(*mt);
+		*mt = NULL;
 	}
 }
 
-void multi_tau_g2cn_free(multi_tau_g2cn_t **mt) {
-	int i, j, c0;
+static void multi_tau_g2c1_push_levels(multi_tau_g2c1_t *mt, 
+		unsigned int const level, double intensity) {
+/* The binned levels hold averages, so they work in floating point. */
+	unsigned int i, j;
+	unsigned int first, last;
+	unsigned int reg;
+	unsigned int const registers = mt->registers;
+	double *signal;
 
-	if ( *mt != NULL ) {
-		free((*mt)->intensity);
-		free((*mt)->pushes);
+	for ( i = level; i < mt->depth; i++ ) {
+		signal = &(mt->signal[(size_t)i*registers]);
+
+		mt->newest[i] = mt->newest[i] == 0 ? 
+				registers - 1 : mt->newest[i] - 1;
+		signal[mt->newest[i]] = intensity;
+
+		mt->accumulated[i] += intensity;
+		mt->averages[i] += intensity;
+		mt->pushes[i]++;
+
+		first = registers/mt->binning;
+		last = mt->pushes[i] < registers ? mt->pushes[i] : registers;
 
-		for ( i = 0; (*mt)->signal != NULL && i < (*mt)->depth; i++ ) {
-			for ( j = 0; (*mt)->signal[i] != NULL && j < (*mt)->registers; 
-					j++ ) {
-				free((*mt)->signal[i][j]);
+		for ( j = first; j < last; j++ ) {
+			reg = mt->newest[i] + j;
+			if ( reg >= registers ) {
+				reg -= registers;
 			}
-			free((*mt)->signal[i]);
+
+			mt->g2[(size_t)i*registers + j] += intensity*signal[reg];
 		}
-		free((*mt)->signal);
 
-		for ( i = 0; (*mt)->accumulated != NULL && i < (*mt)->depth; i++ ) {
-			free((*mt)->accumulated[i]);
+		if ( mt->pushes[i] % mt->binning == 0 ) {
+			intensity = mt->accumulated[i]/mt->binning;
+			mt->accumulated[i] = 0;
+		} else {
+			break;
 		}
-		free((*mt)->accumulated);
+	}
+}
+
+void multi_tau_g2c1_push(multi_tau_g2c1_t *mt, counts_t const *counts) {
+	unsigned int j;
+	unsigned int first, last;
+	unsigned int reg;
+	unsigned int const registers = mt->registers;
+	unsigned long long const count = counts->counts[0];
+	unsigned long long const *past;
+	unsigned long long *g2;
+	double intensity;
 
-		for ( i = 0; (*mt)->averages != NULL && i < (*mt)->depth; i++ ) {
-			free((*mt)->averages[i]);
+	mt->n_seen++;
+
+	/* Level 0: the raw counts, all in integers. */
+	mt->newest[0] = mt->newest[0] == 0 ? registers - 1 : mt->newest[0] - 1;
+	mt->counts[mt->newest[0]] = count;
+	mt->counts_accumulated += count;
+	mt->counts_total += count;
+	mt->pushes[0]++;
+
+	/* An empty bin adds nothing to any product, and for sparse signals most
+	 * bins are empty. Otherwise, walk the ring in its two contiguous pieces:
+	 * from the newest register to the end, then from the start. */
+	if ( count != 0 ) {
+		last = mt->pushes[0] < registers ? mt->pushes[0] : registers;
+		reg = mt->newest[0];
+		first = registers - reg < last ? registers - reg : last;
+
+		past = &(mt->counts[reg]);
+		g2 = mt->counts_g2;
+		for ( j = 0; j < first; j++ ) {
+			g2[j] += count*past[j];
 		}
-		free((*mt)->averages);
 
-		for ( i = 0; (*mt)->g2 != NULL && i < (*mt)->depth; i++ ) {
-			for ( j = 0; (*mt)->g2[i] != NULL && j < (*mt)->registers; j++ ) {
-				for ( c0 = 0; (*mt)->g2[i][j] != NULL && c0 < (*mt)->channels; 
-						c0++ ) {
-					free((*mt)->g2[i][j][c0]);
-				}
-				free((*mt)->g2[i][j]);
+		past = &(mt->counts[0]) - first;
+		for ( ; j < last; j++ ) {
+			g2[j] += count*past[j];
+		}
+	}
+
+	if ( mt->pushes[0] % mt->binning != 0 ) {
+		return;
+	}
+
+	intensity = (double)mt->counts_accumulated/mt->binning;
+	mt->counts_accumulated = 0;
+
+	if ( mt->depth > 1 ) {
+		multi_tau_g2c1_push_levels(mt, 1, intensity);
+	}
+}
+
+void multi_tau_g2c1_push_empty(multi_tau_g2c1_t *mt, 
+		unsigned long long const n) {
+/* As for the n-channel correlator, but with the first level in integers. */
+	unsigned int i, j;
+	unsigned int const registers = mt->registers;
+	unsigned long long remaining = n;
+	unsigned long long fill;
+	double intensity;
+
+	mt->n_seen += n;
+
+	for ( i = 0; i < mt->depth && remaining > 0; i++ ) {
+		for ( j = 0; j < registers && j < remaining; j++ ) {
+			mt->newest[i] = mt->newest[i] == 0 ? 
+					registers - 1 : mt->newest[i] - 1;
+
+			if ( i == 0 ) {
+				mt->counts[mt->newest[i]] = 0;
+			} else {
+				mt->signal[(size_t)i*registers + mt->newest[i]] = 0;
 			}
-			free((*mt)->g2[i]);
 		}
-		free((*mt)->g2);
 
-		for ( i = 0; (*mt)->tau != NULL && i < (*mt)->depth; i++ ) {
-			free((*mt)->tau[i]);
+		fill = mt->binning - mt->pushes[i] % mt->binning;
+		mt->pushes[i] += remaining;
+
+		if ( remaining < fill ) {
+			break;
 		}
-		free((*mt)->tau);
 
-		free(*mt);
-		*mt = NULL;
+		if ( i == 0 ) {
+			intensity = (double)mt->counts_accumulated/mt->binning;
+			mt->counts_accumulated = 0;
+		} else {
+			intensity = mt->accumulated[i]/mt->binning;
+			mt->accumulated[i] = 0;
+		}
+
+		remaining = (remaining - fill)/mt->binning;
+
+		if ( i + 1 < mt->depth ) {
+			multi_tau_g2c1_push_levels(mt, i + 1, intensity);
+		}
 	}
 }
 
-void multi_tau_g2cn_push(multi_tau_g2cn_t *mt, counts_t const *counts) {
-	int i, j, c0, c1;
-	double *temp;
+int multi_tau_g2c1_fprintf(FILE *stream_out, multi_tau_g2c1_t const *mt) {
+	unsigned int i, j;
+	double normalization;
+	double correlation;
+	double average;
+	double g2;
+	unsigned long long tau;
 
-	mt->n_seen++;
+	for ( i = 0; i < mt->depth; i++ ) {
+		average = (i == 0 ? (double)mt->counts_total : mt->averages[i]);
+
+		for ( j = (i == 0 ? 0 : mt->registers/mt->binning);
+				j < mt->registers; j++ ) {
+			if ( mt->n_seen == 0 || mt->pushes[i] <=  j ) {
+				normalization = 0;
+			} else {
+				normalization = 1;
+				normalization *= mt->pushes[i];
+				normalization *= average/(double)mt->pushes[i];
+				normalization *= average/(double)mt->pushes[i]; 
+				/* correct for the undersampling of various bins */
+				normalization *= (double)(mt->pushes[i]-j)/
+						(double)mt->pushes[i];
+			}
 
-	debug("Copying to buffer.\n");
+			if ( normalization <= 0 ) {
+				correlation = 0;
+			} else {
+				g2 = (i == 0 ? (double)mt->counts_g2[j] : 
+						mt->g2[(size_t)i*mt->registers + j]);
+				correlation = g2/normalization;
+			}
 
-	for ( c0 = 0; c0 < mt->channels; c0++ ) {
-		mt->intensity[c0] = (double)counts->counts[c0];
+			tau = mt->tau[i*mt->registers + j];
+			fprintf(stream_out,
+					"%u,%u,%g,%g,%lf\n",
+					0, 
+					0,
+					(double)tau*mt->bin_width,
+					(double)(tau+pow_int(mt->binning, i))
+							*mt->bin_width,
+					correlation); 
+		}
 	}
 
-	/* update signal */
-	debug("Updating signal.\n");
-	for ( i = 0; i < mt->depth; i++ ) {
-		temp = mt->signal[i][mt->registers-1];
+	return( ferror(stream_out) ? PC_ERROR_IO : PC_SUCCESS );
+}
+
+multi_tau_g3cn_t *multi_tau_g3cn_alloc(unsigned int const binning,
+		unsigned int const registers, unsigned int const depth,
+		unsigned int const channels, unsigned long long const bin_width) {
+	int i, j;
+	int result = PC_SUCCESS;
+	multi_tau_g3cn_t *mt = NULL;
+
+	if ( binning > registers ) {
+		error("Binning must be smaller than the number of registers.\n");
+		result = PC_ERROR_OPTIONS;
+	} else if ( binning == 0 ) {
+		error("Binning must be non-zero.\n");
+		result = PC_ERROR_OPTIONS;
+	} else if ( channels == 0 ) {
+		error("Number of channels must be non-zero.\n");
+		result = PC_ERROR_OPTIONS;
+	} else if ( depth == 0 ) {
+		error("Depth must be non-zero.\n");
+		result = PC_ERROR_OPTIONS;
+	}
 
-		memmove(&(mt->signal[i][1]),
-				&(mt->signal[i][0]),
-				sizeof(double *)*(mt->registers-1)); 
-		mt->signal[i][0] = temp; 
+	if ( result == PC_SUCCESS ) {
+		mt = (multi_tau_g3cn_t *)calloc(1, sizeof(multi_tau_g3cn_t));
+
+		if ( mt == NULL ) {
+			result = PC_ERROR_MEM;
+		}
+	}
+
+	if ( result == PC_SUCCESS ) {
+		mt->binning = binning;
+		mt->registers = registers;
+		mt->depth = depth;
+		mt->channels = channels;
 
-		memcpy(mt->signal[i][0], mt->intensity, sizeof(double)*mt->channels);
+		mt->bin_width = bin_width;
 	
-		for ( c0 = 0; c0 < mt->channels; c0++ ) {
-			mt->accumulated[i][c0] += mt->intensity[c0];
+		mt->intensity = multi_tau_doubles_alloc(channels);
+		mt->signal = multi_tau_doubles_alloc(
+				(size_t)depth*registers*channels);
+		mt->newest = (unsigned int *)malloc(sizeof(unsigned int)*depth);
+		mt->accumulated = multi_tau_doubles_alloc((size_t)depth*channels);
+		mt->pushes = (unsigned long long *)malloc(
+				sizeof(unsigned long long)*depth);
+		mt->averages = multi_tau_doubles_alloc((size_t)depth*channels);
+		mt->g3 = multi_tau_doubles_alloc(
+				(size_t)depth*registers*registers*
+				channels*channels*channels);
+		mt->tau = (unsigned long long *)malloc(
+				sizeof(unsigned long long)*depth*registers);
+
+		if ( mt->intensity == NULL || mt->signal == NULL || 
+				mt->newest == NULL || mt->accumulated == NULL ||
+				mt->pushes == NULL || mt->averages == NULL ||
+				mt->g3 == NULL || mt->tau == NULL ) {
+			error("Could not allocate the multi-tau registers.\n");
+			result = PC_ERROR_MEM;
+		}
+	}
+
+	if ( result == PC_SUCCESS ) {
+		for ( i = 0; i < mt->depth; i++ ) {
+			for ( j = 0; j < mt->registers; j++ ) {
+				mt->tau[i*mt->registers + j] = j*powull(mt->binning, i);
+			}
+		}
+	}
+
+	if ( result != PC_SUCCESS ) {
+		multi_tau_g3cn_free(&mt);
+		mt = NULL;
+	} 
+	
+	return(mt);
+}
+
+void multi_tau_g3cn_init(multi_tau_g3cn_t *mt) {
+	size_t const channels = mt->channels;
+	size_t const depth = mt->depth;
+	size_t const registers = mt->registers;
+
+	mt->n_seen = 0;
+
+	memset(mt->intensity, 0, sizeof(double)*channels);
+	memset(mt->signal, 0, sizeof(double)*depth*registers*channels);
+	memset(mt->newest, 0, sizeof(unsigned int)*depth);
+	memset(mt->accumulated, 0, sizeof(double)*depth*channels);
+	memset(mt->pushes, 0, sizeof(unsigned long long)*depth);
+	memset(mt->averages, 0, sizeof(double)*depth*channels);
+	memset(mt->g3, 0, sizeof(double)*depth*registers*registers*
+			channels*channels*channels);
+}
+
+void multi_tau_g3cn_free(multi_tau_g3cn_t **mt) {
+	if ( *mt != NULL ) {
+		free((*mt)->intensity);
+		free((*mt)->signal);
+		free((*mt)->newest);
+		free((*mt)->accumulated);
+		free((*mt)->pushes);
+		free((*mt)->averages);
+		free((*mt)->g3);
+		free((*mt)->tau);
+		free(*mt);
+		*mt = NULL;
+	}
+}
+
+static void multi_tau_g3cn_push_levels(multi_tau_g3cn_t *mt, 
+		unsigned int const level) {
+	unsigned int i, j1, j2, c0, c1;
+	unsigned int first, last;
+	unsigned int reg1, reg2;
+	unsigned int const channels = mt->channels;
+	unsigned int const registers = mt->registers;
+	size_t const block = (size_t)channels*channels*channels;
+	double const *current;
+	double const *past1;
+	double const *past2;
+	double *signal;
+	double *accumulated;
+	double *averages;
+	double *row;
+
+	for ( i = level; i < mt->depth; i++ ) {
+		signal = &(mt->signal[(size_t)i*registers*channels]);
+		accumulated = &(mt->accumulated[(size_t)i*channels]);
+		averages = &(mt->averages[(size_t)i*channels]);
+
+		mt->newest[i] = mt->newest[i] == 0 ? 
+				registers - 1 : mt->newest[i] - 1;
+		memcpy(&(signal[(size_t)mt->newest[i]*channels]), mt->intensity, 
+				sizeof(double)*channels);
+		current = &(signal[(size_t)mt->newest[i]*channels]);
+
+		for ( c0 = 0; c0 < channels; c0++ ) {
+			accumulated[c0] += mt->intensity[c0];
+			averages[c0] += current[c0];
 		}
 
 		mt->pushes[i]++;
-		/* use this section to update the correlation, since this row just
-		 * saw a push 
-		 */
-		for ( c0 = 0; c0 < mt->channels; c0++ ) {
-			mt->averages[i][c0] += mt->signal[i][0][c0];
-
-			for ( c1 = 0; c1 < mt->channels; c1++ ) {
-				for ( j = (i == 0 ? 0 : mt->registers/mt->binning); 
-						j < mt->registers && j < mt->pushes[i]; j++ ) {
-					mt->g2[i][j][c0][c1] += 
-							mt->signal[i][0][c0]*
-							mt->signal[i][j][c1];
+
+		first = (i == 0 ? 0 : registers/mt->binning);
+		last = mt->pushes[i] < registers ? mt->pushes[i] : registers;
+
+		for ( j1 = 0; j1 < last; j1++ ) {
+			reg1 = mt->newest[i] + j1;
+			if ( reg1 >= registers ) {
+				reg1 -= registers;
+			}
+			past1 = &(signal[(size_t)reg1*channels]);
+
+			/* Pairs with both lags below first belong to the level below. */
+			for ( j2 = (j1 < first ? first : 0); j2 < last; j2++ ) {
+				reg2 = mt->newest[i] + j2;
+				if ( reg2 >= registers ) {
+					reg2 -= registers;
+				}
+				past2 = &(signal[(size_t)reg2*channels]);
+
+				row = &(mt->g3[(((size_t)i*registers + j1)*registers + j2)*
+						block]);
+
+				for ( c0 = 0; c0 < channels; c0++ ) {
+					for ( c1 = 0; c1 < channels; c1++ ) {
+						multi_tau_row_add(row, past2, current[c0]*past1[c1],
+								channels);
+						row += channels;
+					}
 				}
 			}
 		}
 
 		if ( mt->pushes[i] % mt->binning == 0 ) {
-			for ( c0 = 0; c0 < mt->channels; c0++ ) {
-				mt->intensity[c0] = mt->accumulated[i][c0]/mt->binning;
-				mt->accumulated[i][c0] = 0;
+			for ( c0 = 0; c0 < channels; c0++ ) {
+				mt->intensity[c0] = accumulated[c0]/mt->binning;
+				accumulated[c0] = 0;
 			}
 		} else {
 			break;
 		}
 	}
+}
 
-	/* update correlation */
-	/* use this section to update all correlations.
-	debug("Updating correlation.\n");
-	for ( i = 0; i < mt->depth; i++ ) {
-		for ( c0 = 0; c0 < mt->channels; c0++ ) {
-			mt->averages[i][c0] += mt->signal[i][0][c0];
+void multi_tau_g3cn_push(multi_tau_g3cn_t *mt, counts_t const *counts) {
+	unsigned int c0;
 
-			debug("g2.\n");
-			for ( c1 = 0; c1 < mt->channels; c1++ ) {
-				for ( j = (i == 0 ? 0 : mt->registers/mt->binning) ;
-						j < mt->registers; j++ ) {
-					mt->g2[i][j][c0][c1] += mt->signal[i][0][c0]*
-							mt->signal[i][j][c1];
-				}
-			}
+	mt->n_seen++;
+
+	for ( c0 = 0; c0 < mt->channels; c0++ ) {
+		mt->intensity[c0] = (double)counts->counts[c0];
+	}
+
+	multi_tau_g3cn_push_levels(mt, 0);
+}
+
+void multi_tau_g3cn_push_empty(multi_tau_g3cn_t *mt, 
+		unsigned long long const n) {
+/* As for g2: an empty push only moves the registers. */
+	unsigned int i, j, c0;
+	unsigned int const channels = mt->channels;
+	unsigned int const registers = mt->registers;
+	unsigned long long remaining = n;
+	unsigned long long fill;
+	double *signal;
+	double *accumulated;
+
+	mt->n_seen += n;
+
+	for ( i = 0; i < mt->depth && remaining > 0; i++ ) {
+		signal = &(mt->signal[(size_t)i*registers*channels]);
+		accumulated = &(mt->accumulated[(size_t)i*channels]);
+
+		for ( j = 0; j < registers && j < remaining; j++ ) {
+			mt->newest[i] = mt->newest[i] == 0 ? 
+					registers - 1 : mt->newest[i] - 1;
+			memset(&(signal[(size_t)mt->newest[i]*channels]), 0, 
+					sizeof(double)*channels);
+		}
+
+		fill = mt->binning - mt->pushes[i] % mt->binning;
+		mt->pushes[i] += remaining;
+
+		if ( remaining < fill ) {
+			break;
+		}
+
+		for ( c0 = 0; c0 < channels; c0++ ) {
+			mt->intensity[c0] = accumulated[c0]/mt->binning;
+			accumulated[c0] = 0;
+		}
+
+		remaining = (remaining - fill)/mt->binning;
+
+		if ( i + 1 < mt->depth ) {
+			multi_tau_g3cn_push_levels(mt, i + 1);
 		}
-	}*/
+	}
 }
 
-int multi_tau_g2cn_fprintf(FILE *stream_out, multi_tau_g2cn_t const *mt) {
-	unsigned int i, j, c0, c1;
+int multi_tau_g3cn_fprintf(FILE *stream_out, multi_tau_g3cn_t const *mt) {
+	unsigned int i, j1, j2, c0, c1, c2;
+	unsigned int first;
+	unsigned int lag;
+	unsigned int const channels = mt->channels;
+	unsigned int const registers = mt->registers;
 	double normalization;
 	double correlation;
-
-	for ( c0 = 0; c0 < mt->channels; c0++ ) {
-		for ( c1 = 0; c1 < mt->channels; c1++ ) {
-			for ( i = 0; i < mt->depth; i++ ) {
-				for ( j = (i == 0 ? 0 : mt->registers/mt->binning);
-						j < mt->registers; j++ ) {
-					if ( mt->n_seen == 0 || mt->pushes[i] <=  j ) {
-						normalization = 0;
-					} else {
-						normalization = 1;
-						normalization *= mt->pushes[i];
-						normalization *= (double)mt->averages[i][c0]/
-								(double)mt->pushes[i];
-						normalization *= (double)mt->averages[i][c1]/
-								(double)mt->pushes[i]; 
-						/* correct for the undersampling of various bins */
-						normalization *= (double)(mt->pushes[i]-j)/
-								(double)mt->pushes[i];
+	double const *averages;
+	unsigned long long tau1, tau2;
+	unsigned long long width;
+
+	for ( c0 = 0; c0 < channels; c0++ ) {
+		for ( c1 = 0; c1 < channels; c1++ ) {
+			for ( c2 = 0; c2 < channels; c2++ ) {
+				for ( i = 0; i < mt->depth; i++ ) {
+					averages = &(mt->averages[(size_t)i*channels]);
+					first = (i == 0 ? 0 : registers/mt->binning);
+					width = pow_int(mt->binning, i);
+
+					for ( j1 = 0; j1 < registers; j1++ ) {
+						for ( j2 = (j1 < first ? first : 0); j2 < registers;
+								j2++ ) {
+							/* Each pair is seen once both lags are filled. */
+							lag = j1 > j2 ? j1 : j2;
+
+							if ( mt->n_seen == 0 || mt->pushes[i] <= lag ) {
+								normalization = 0;
+							} else {
+								normalization = 1;
+								normalization *= mt->pushes[i];
+								normalization *= (double)averages[c0]/
+										(double)mt->pushes[i];
+								normalization *= (double)averages[c1]/
+										(double)mt->pushes[i];
+								normalization *= (double)averages[c2]/
+										(double)mt->pushes[i];
+								normalization *= (double)(mt->pushes[i]-lag)/
+										(double)mt->pushes[i];
+							}
+
+							if ( normalization <= 0 ) {
+								correlation = 0;
+							} else {
+								correlation = mt->g3[
+										((((size_t)i*registers + j1)*
+										registers + j2)*channels + c0)*
+										channels*channels + 
+										(size_t)c1*channels + c2]/
+										normalization;
+							}
+
+							tau1 = mt->tau[i*registers + j1];
+							tau2 = mt->tau[i*registers + j2];
+							fprintf(stream_out,
+									"%u,%u,%u,%g,%g,%g,%g,%lf\n",
+									c0, c1, c2,
+									(double)tau1*mt->bin_width,
+									(double)(tau1+width)*mt->bin_width,
+									(double)tau2*mt->bin_width,
+									(double)(tau2+width)*mt->bin_width,
+									correlation); 
+						}
 					}
-
-					if ( normalization <= 0 ) {
-						correlation = 0;
-					} else {
-						correlation = mt->g2[i][j][c0][c1]/normalization;
-					}
-
-					fprintf(stream_out,
-							"%u,%u,%g,%g,%lf\n",
-							c0, 
-							c1,
-							(double)mt->tau[i][j]*mt->bin_width,
-							(double)(mt->tau[i][j]+pow_int(mt->binning, i))
-									*mt->bin_width,
-							correlation); 
 				}
 			}
 		}
@@ -36,9 +36,14 @@
 
 #include "../statistics/counts.h"
 
-/* n-channel implementation of the multi-tau algorithm. For performance 
- * purposes, it may end up being worthwhile to write a separate implementation
- * which uses only one channel.
+/* n-channel implementation of the multi-tau algorithm. 
+ *
+ * Each array is a single contiguous block, indexed as 
+ *   signal[level][register][channel]
+ *   g2[level][lag][c0][c1]
+ * and so on, with the registers of each level used as a ring: newest[level]
+ * is the register holding the latest values, and the values from lag j
+ * before are j registers after it.
  */
 typedef struct {
 	unsigned int binning;
@@ -48,17 +53,23 @@ typedef struct {
 	unsigned int channels;
 	unsigned long long bin_width;
 
+	/* Only the rows c0 from row_first up to row_last of g2 are computed; 
+	 * by default, this is all of them. */
+	unsigned int row_first;
+	unsigned int row_last;
+
 	unsigned long long n_seen;
 
 	double *intensity;
 
-	double ***signal;
-	double **accumulated;
+	double *signal;
+	unsigned int *newest;
+	double *accumulated;
 	unsigned long long *pushes;
-	double **averages;
+	double *averages;
 
-	double ****g2;
-	unsigned long long **tau;
+	double *g2;
+	unsigned long long *tau;
 } multi_tau_g2cn_t;
 
 multi_tau_g2cn_t *multi_tau_g2cn_alloc(unsigned int const binning,
@@ -66,9 +77,100 @@ multi_tau_g2cn_t *multi_tau_g2cn_alloc(unsigned int const binning,
 		unsigned int const channels, unsigned long long const bin_width);
 void multi_tau_g2cn_init(multi_tau_g2cn_t *mt);
 void multi_tau_g2cn_free(multi_tau_g2cn_t **mt);
+void multi_tau_g2cn_set_rows(multi_tau_g2cn_t *mt, 
+		unsigned int const row_first, unsigned int const row_last);
+void multi_tau_g2cn_copy_rows(multi_tau_g2cn_t *mt, 
+		multi_tau_g2cn_t const *other);
 
 void multi_tau_g2cn_push(multi_tau_g2cn_t *mt, counts_t const *counts);
+void multi_tau_g2cn_push_empty(multi_tau_g2cn_t *mt, 
+		unsigned long long const n);
 
 int multi_tau_g2cn_fprintf(FILE *stream_out, multi_tau_g2cn_t const *mt);
 
+/* Single-channel implementation. The raw counts are integers, so the first 
+ * level keeps its registers, sums and products as 64-bit integers and only
+ * the binned levels, whose values are averages, use floating point. The 
+ * layout of the binned levels follows the n-channel version with one 
+ * channel; the entries for level 0 are unused there.
+ */
+typedef struct {
+	unsigned int binning;
+	unsigned int registers;
+	unsigned int depth;
+
+	unsigned long long bin_width;
+
+	unsigned long long n_seen;
+
+	unsigned long long *counts;
+	unsigned long long counts_accumulated;
+	unsigned long long counts_total;
+	unsigned long long *counts_g2;
+
+	double *signal;
+	unsigned int *newest;
+	double *accumulated;
+	unsigned long long *pushes;
+	double *averages;
+
+	double *g2;
+	unsigned long long *tau;
+} multi_tau_g2c1_t;
+
+multi_tau_g2c1_t *multi_tau_g2c1_alloc(unsigned int const binning,
+		unsigned int const registers, unsigned int const depth,
+		unsigned long long const bin_width);
+void multi_tau_g2c1_init(multi_tau_g2c1_t *mt);
+void multi_tau_g2c1_free(multi_tau_g2c1_t **mt);
+
+void multi_tau_g2c1_push(multi_tau_g2c1_t *mt, counts_t const *counts);
+void multi_tau_g2c1_push_empty(multi_tau_g2c1_t *mt, 
+		unsigned long long const n);
+
+int multi_tau_g2c1_fprintf(FILE *stream_out, multi_tau_g2c1_t const *mt);
+
+/* Third-order implementation, with the same registers and binning as the 
+ * n-channel g2. At each level, the newest value of c0 is correlated with 
+ * the values of c1 and c2 at every pair of lags (j1, j2) held in the 
+ * registers; above the first level, the pairs already covered by the level
+ * below (both lags under registers/binning) are skipped. The correlations 
+ * are stored as
+ *   g3[level][j1][j2][c0][c1][c2]
+ * so the memory grows as depth*registers^2, rather than with the lags.
+ */
+typedef struct {
+	unsigned int binning;
+	unsigned int registers;
+	unsigned int depth;
+
+	unsigned int channels;
+	unsigned long long bin_width;
+
+	unsigned long long n_seen;
+
+	double *intensity;
+
+	double *signal;
+	unsigned int *newest;
+	double *accumulated;
+	unsigned long long *pushes;
+	double *averages;
+
+	double *g3;
+	unsigned long long *tau;
+} multi_tau_g3cn_t;
+
+multi_tau_g3cn_t *multi_tau_g3cn_alloc(unsigned int const binning,
+		unsigned int const registers, unsigned int const depth,
+		unsigned int const channels, unsigned long long const bin_width);
+void multi_tau_g3cn_init(multi_tau_g3cn_t *mt);
+void multi_tau_g3cn_free(multi_tau_g3cn_t **mt);
+
+void multi_tau_g3cn_push(multi_tau_g3cn_t *mt, counts_t const *counts);
+void multi_tau_g3cn_push_empty(multi_tau_g3cn_t *mt, 
+		unsigned long long const n);
+
+int multi_tau_g3cn_fprintf(FILE *stream_out, multi_tau_g3cn_t const *mt);
+
 #endif
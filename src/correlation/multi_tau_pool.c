@@ -0,0 +1,272 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "multi_tau_pool.h"
+#include "../error.h"
+#include "../types.h"
+
+/*
+ * With n channels, each push into a level of the correlator costs n*n 
+ * products per lag, against only n to move the registers. The pool splits 
+ * the rows c0 of g2 between its workers, each of which keeps its own copy of
+ * the registers: moving them is cheap enough to repeat, and then the workers
+ * share nothing but the counts they are given. 
+ *
+ * The counts are collected into batches, and every worker replays the whole
+ * batch before the next one is collected. Since each row is computed by 
+ * exactly one worker, in the same order as by a single correlator, the 
+ * result does not depend on the number of workers.
+ */
+#define MULTI_TAU_POOL_BATCH 4096
+
+static void multi_tau_worker_replay(multi_tau_worker_t *worker) {
+	size_t i;
+	counts_t counts;
+
+	counts.channels = worker->channels;
+
+	for ( i = 0; i < worker->n_pushes; i++ ) {
+		counts.counts = &(worker->counts[i*worker->channels]);
+
+		multi_tau_g2cn_push_empty(worker->mt, worker->empty[i]);
+		multi_tau_g2cn_push(worker->mt, &counts);
+	}
+}
+
+static void *multi_tau_worker_run(void *arg) {
+	multi_tau_worker_t *worker = (multi_tau_worker_t *)arg;
+
+	while ( true ) {
+		pthread_mutex_lock(&(worker->mutex));
+		while ( worker->state != MULTI_TAU_WORKER_QUEUED && 
+				! worker->stop ) {
+			pthread_cond_wait(&(worker->cond), &(worker->mutex));
+		}
+
+		if ( worker->stop ) {
+			pthread_mutex_unlock(&(worker->mutex));
+			break;
+		}
+		pthread_mutex_unlock(&(worker->mutex));
+
+		multi_tau_worker_replay(worker);
+
+		pthread_mutex_lock(&(worker->mutex));
+		worker->state = MULTI_TAU_WORKER_DONE;
+		pthread_cond_broadcast(&(worker->cond));
+		pthread_mutex_unlock(&(worker->mutex));
+	}
+
+	return(NULL);
+}
+
+multi_tau_pool_t *multi_tau_pool_alloc(unsigned int const n_workers,
+		unsigned int const binning,
+		unsigned int const registers, unsigned int const depth,
+		unsigned int const channels, unsigned long long const bin_width) {
+	unsigned int i;
+	multi_tau_pool_t *pool = NULL;
+
+	pool = (multi_tau_pool_t *)calloc(1, sizeof(multi_tau_pool_t));
+
+	if ( pool == NULL ) {
+		return(pool);
+	}
+
+	/* Each worker needs at least one row. */
+	pool->n_workers = n_workers < channels ? n_workers : channels;
+	if ( pool->n_workers == 0 ) {
+		pool->n_workers = 1;
+	}
+
+	pool->channels = channels;
+	pool->capacity = MULTI_TAU_POOL_BATCH;
+	pool->counts = (unsigned long long *)malloc(
+			sizeof(unsigned long long)*pool->capacity*channels);
+	pool->empty = (unsigned long long *)malloc(
+			sizeof(unsigned long long)*pool->capacity);
+	pool->workers = (multi_tau_worker_t *)calloc(pool->n_workers, 
+			sizeof(multi_tau_worker_t));
+
+	if ( pool->counts == NULL || pool->empty == NULL || 
+			pool->workers == NULL ) {
+		error("Could not allocate the multi-tau workers.\n");
+		multi_tau_pool_free(&pool);
+		return(pool);
+	}
+
+	for ( i = 0; i < pool->n_workers; i++ ) {
+		pthread_mutex_init(&(pool->workers[i].mutex), NULL);
+		pthread_cond_init(&(pool->workers[i].cond), NULL);
+		pool->workers[i].state = MULTI_TAU_WORKER_IDLE;
+		pool->workers[i].channels = channels;
+		pool->workers[i].counts = pool->counts;
+		pool->workers[i].empty = pool->empty;
+	}
+
+	for ( i = 0; i < pool->n_workers; i++ ) {
+		pool->workers[i].mt = multi_tau_g2cn_alloc(binning, registers,
+				depth, channels, bin_width);
+
+		if ( pool->workers[i].mt == NULL ) {
+			multi_tau_pool_free(&pool);
+			return(pool);
+		}
+
+		multi_tau_g2cn_set_rows(pool->workers[i].mt,
+				i*channels/pool->n_workers, 
+				(i+1)*channels/pool->n_workers);
+	}
+
+	return(pool);
+}
+
+int multi_tau_pool_start(multi_tau_pool_t *pool) {
+	unsigned int i;
+
+	for ( i = 1; i < pool->n_workers; i++ ) {
+		if ( pthread_create(&(pool->workers[i].thread), NULL,
+				multi_tau_worker_run, &(pool->workers[i])) ) {
+			error("Could not start multi-tau thread %u.\n", i);
+			return(PC_ERROR_UNKNOWN);
+		}
+
+		pool->workers[i].running = true;
+	}
+
+	return(PC_SUCCESS);
+}
+
+void multi_tau_pool_init(multi_tau_pool_t *pool) {
+	unsigned int i;
+
+	pool->n_pushes = 0;
+
+	for ( i = 0; i < pool->n_workers; i++ ) {
+		multi_tau_g2cn_init(pool->workers[i].mt);
+	}
+}
+
+void multi_tau_pool_free(multi_tau_pool_t **pool) {
+	unsigned int i;
+	multi_tau_worker_t *worker;
+
+	if ( *pool != NULL ) {
+		if ( (*pool)->workers != NULL ) {
+			for ( i = 0; i < (*pool)->n_workers; i++ ) {
+				worker = &((*pool)->workers[i]);
+
+				if ( worker->running ) {
+					pthread_mutex_lock(&(worker->mutex));
+					worker->stop = true;
+					pthread_cond_broadcast(&(worker->cond));
+					pthread_mutex_unlock(&(worker->mutex));
+					pthread_join(worker->thread, NULL);
+				}
+
+				pthread_mutex_destroy(&(worker->mutex));
+				pthread_cond_destroy(&(worker->cond));
+				multi_tau_g2cn_free(&(worker->mt));
+			}
+
+			free((*pool)->workers);
+		}
+
+		free((*pool)->counts);
+		free((*pool)->empty);
+		free(*pool);
+		*pool = NULL;
+	}
+}
+
+static void multi_tau_pool_run(multi_tau_pool_t *pool) {
+/* Hand the batch to every worker, take the first share here, and wait for
+ * the rest before the batch can be reused. */
+	unsigned int i;
+	multi_tau_worker_t *worker;
+
+	for ( i = 0; i < pool->n_workers; i++ ) {
+		pool->workers[i].n_pushes = pool->n_pushes;
+	}
+
+	for ( i = 1; i < pool->n_workers; i++ ) {
+		worker = &(pool->workers[i]);
+
+		pthread_mutex_lock(&(worker->mutex));
+		worker->state = MULTI_TAU_WORKER_QUEUED;
+		pthread_cond_broadcast(&(worker->cond));
+		pthread_mutex_unlock(&(worker->mutex));
+	}
+
+	multi_tau_worker_replay(&(pool->workers[0]));
+
+	for ( i = 1; i < pool->n_workers; i++ ) {
+		worker = &(pool->workers[i]);
+
+		pthread_mutex_lock(&(worker->mutex));
+		while ( worker->state == MULTI_TAU_WORKER_QUEUED ) {
+			pthread_cond_wait(&(worker->cond), &(worker->mutex));
+		}
+		worker->state = MULTI_TAU_WORKER_IDLE;
+		pthread_mutex_unlock(&(worker->mutex));
+	}
+
+	pool->n_pushes = 0;
+}
+
+void multi_tau_pool_push(multi_tau_pool_t *pool, counts_t const *counts,
+		unsigned long long const empty) {
+	memcpy(&(pool->counts[pool->n_pushes*pool->channels]), counts->counts,
+			sizeof(unsigned long long)*pool->channels);
+	pool->empty[pool->n_pushes] = empty;
+	pool->n_pushes++;
+
+	if ( pool->n_pushes == pool->capacity ) {
+		multi_tau_pool_run(pool);
+	}
+}
+
+int multi_tau_pool_fprintf(FILE *stream_out, multi_tau_pool_t *pool) {
+	unsigned int i;
+
+	if ( pool->n_pushes > 0 ) {
+		multi_tau_pool_run(pool);
+	}
+
+	for ( i = 1; i < pool->n_workers; i++ ) {
+		multi_tau_g2cn_copy_rows(pool->workers[0].mt, pool->workers[i].mt);
+	}
+
+	return(multi_tau_g2cn_fprintf(stream_out, pool->workers[0].mt));
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef MULTI_TAU_POOL_H_
+#define MULTI_TAU_POOL_H_
+
+#include <stdio.h>
+#include <pthread.h>
+
+#include "multi_tau.h"
+#include "../statistics/counts.h"
+
+#define MULTI_TAU_WORKER_IDLE 0
+#define MULTI_TAU_WORKER_QUEUED 1
+#define MULTI_TAU_WORKER_DONE 2
+
+/*
+ * One worker of the pool: its own correlator, which computes some of the 
+ * rows of g2, and the thread which runs it. The first worker is run by the
+ * caller, and has no thread.
+ */
+typedef struct {
+	multi_tau_g2cn_t *mt;
+
+	unsigned int channels;
+	unsigned long long *counts;
+	unsigned long long *empty;
+	size_t n_pushes;
+
+	int state;
+	int stop;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+
+	pthread_t thread;
+	int running;
+} multi_tau_worker_t;
+
+typedef struct {
+	unsigned int n_workers;
+	multi_tau_worker_t *workers;
+
+	unsigned int channels;
+	size_t capacity;
+	size_t n_pushes;
+	unsigned long long *counts;
+	unsigned long long *empty;
+} multi_tau_pool_t;
+
+multi_tau_pool_t *multi_tau_pool_alloc(unsigned int const n_workers,
+		unsigned int const binning,
+		unsigned int const registers, unsigned int const depth,
+		unsigned int const channels, unsigned long long const bin_width);
+int multi_tau_pool_start(multi_tau_pool_t *pool);
+void multi_tau_pool_init(multi_tau_pool_t *pool);
+void multi_tau_pool_free(multi_tau_pool_t **pool);
+
+void multi_tau_pool_push(multi_tau_pool_t *pool, counts_t const *counts,
+		unsigned long long const empty);
+
+int multi_tau_pool_fprintf(FILE *stream_out, multi_tau_pool_t *pool);
+
+#endif
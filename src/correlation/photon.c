@@ -35,6 +35,7 @@
 #include "photon.h"
 #include "correlator.h"
 #include "../error.h"
+#include "../output.h"
 #include "../modes.h"
 #include "../photon/t2.h"
 #include "../photon/t3.h"
@@ -43,11 +44,16 @@
 int correlate_photon(FILE *stream_in, FILE *stream_out, 
 		pc_options_t const *options) {
 	int result = PC_SUCCESS;
+	int status;
 	photon_stream_t *photon_stream;
 	correlator_t *correlator;
 
+	photon_t batch[PHOTON_STREAM_BATCH_SIZE];
+	size_t n_photons;
+	size_t i;
+
 	debug("Allocating correlator, photon stream.\n");
-	photon_stream = photon_stream_alloc(options->mode);
+	photon_stream = photon_stream_alloc(options->mode, options->format);
 	correlator = correlator_alloc(options->mode, options->order,
 			options->queue_size, options->positive_only,
 			options->min_time_distance,
@@ -67,21 +73,28 @@ int correlate_photon(FILE *stream_in, FILE *stream_out,
 		photon_stream_set_unwindowed(photon_stream);
 		correlator_init(correlator);
 
-		debug("Starting calculation.\n");
-		while ( photon_stream_next_photon(photon_stream) == PC_SUCCESS ) {
-			debug("Pushing photon.\n");
-			result = correlator_push(correlator, &(photon_stream->photon));
+		if ( options->read_ahead && 
+				photon_stream_read_ahead(photon_stream) != PC_SUCCESS ) {
+			warn("Could not start reading ahead, continuing without.\n");
+		}
 
-			if ( result != PC_SUCCESS ) {
-				break;
-			}
-	
-			while ( correlator_next(correlator) == PC_SUCCESS ) {
-				debug("Found correlation.\n");
-				correlator->correlation_print(stream_out, 
-						correlator->correlation);
+		debug("Starting calculation.\n");
+		do {
+			status = photon_stream_next_batch(photon_stream, 
+					batch, PHOTON_STREAM_BATCH_SIZE, &n_photons);
+
+			for ( i = 0; result == PC_SUCCESS && i < n_photons; i++ ) {
+				debug("Pushing photon.\n");
+				result = correlator_push(correlator, &batch[i]);
+
+				while ( result == PC_SUCCESS &&
+						correlator_next(correlator) == PC_SUCCESS ) {
+					debug("Found correlation.\n");
+					correlator->correlation_print(stream_out, 
+							correlator->correlation);
+				}
 			}
-		}
+		} while ( result == PC_SUCCESS && status == PC_SUCCESS );
 
 		if ( result == PC_SUCCESS ) {
 			debug("Flushing.\n");
@@ -182,25 +195,35 @@ int t2_correlation_fscanf(FILE *stream_in, correlation_t *correlation) {
 
 int t2_correlation_fprintf(FILE *stream_out, correlation_t const *correlation) {
 	int i;
+	output_t output;
 
 	if ( correlation->order == 1 ) {
-		t2_fprintf(stream_out, correlation->photons);
-	} else {
-		fprintf(stream_out, 
-				"%u", 
-				correlation->photons[0].t2.channel);
-
-		for ( i = 1; i < correlation->order; i++ ) {
-			fprintf(stream_out, 
-					",%u,%lld",
-					correlation->photons[i].t2.channel,
-					correlation->photons[i].t2.time);
+		return(t2_fprintf(stream_out, correlation->photons));
+	} 
+
+	output_init(&output, stream_out);
+
+	if ( output_unsigned(&output, correlation->photons[0].t2.channel) 
+			!= PC_SUCCESS ) {
+		return(PC_ERROR_IO);
+	}
+
+	for ( i = 1; i < correlation->order; i++ ) {
+		if ( output_char(&output, ',') != PC_SUCCESS ||
+				output_unsigned(&output, 
+					correlation->photons[i].t2.channel) != PC_SUCCESS ||
+				output_char(&output, ',') != PC_SUCCESS ||
+				output_long_long(&output, 
+					correlation->photons[i].t2.time) != PC_SUCCESS ) {
+			return(PC_ERROR_IO);
 		}
+	}
 
-		fprintf(stream_out, "\n");
+	if ( output_char(&output, '\n') != PC_SUCCESS ) {
+		return(PC_ERROR_IO);
 	}
 
-	return( ! ferror(stream_out) ? PC_SUCCESS : PC_ERROR_IO );
+	return(output_flush(&output));
 }
 
 int t2_under_max_distance(correlator_t const *correlator) {
@@ -274,26 +297,38 @@ int t3_correlation_fscanf(FILE *stream_in, correlation_t *correlation) {
 
 int t3_correlation_fprintf(FILE *stream_out, correlation_t const *correlation) {
 	int i;
+	output_t output;
 
 	if ( correlation->order == 1 ) {
-		t3_fprintf(stream_out, correlation->photons);
-	} else {
-		fprintf(stream_out, 
-				"%u",
-				correlation->photons[0].t3.channel);
-
-		for ( i = 1; i < correlation->order; i++ ) {
-			fprintf(stream_out, 
-					",%u,%lld,%lld",
-					correlation->photons[i].t3.channel,
-					correlation->photons[i].t3.pulse,
-					correlation->photons[i].t3.time);
+		return(t3_fprintf(stream_out, correlation->photons));
+	}
+
+	output_init(&output, stream_out);
+
+	if ( output_unsigned(&output, correlation->photons[0].t3.channel) 
+			!= PC_SUCCESS ) {
+		return(PC_ERROR_IO);
+	}
+
+	for ( i = 1; i < correlation->order; i++ ) {
+		if ( output_char(&output, ',') != PC_SUCCESS ||
+				output_unsigned(&output, 
+					correlation->photons[i].t3.channel) != PC_SUCCESS ||
+				output_char(&output, ',') != PC_SUCCESS ||
+				output_long_long(&output, 
+					correlation->photons[i].t3.pulse) != PC_SUCCESS ||
+				output_char(&output, ',') != PC_SUCCESS ||
+				output_long_long(&output, 
+					correlation->photons[i].t3.time) != PC_SUCCESS ) {
+			return(PC_ERROR_IO);
 		}
+	}
 
-		fprintf(stream_out, "\n");
+	if ( output_char(&output, '\n') != PC_SUCCESS ) {
+		return(PC_ERROR_IO);
 	}
 
-	return( ! ferror(stream_out) ? PC_SUCCESS : PC_ERROR_IO );
+	return(output_flush(&output));
 }
 
 int t3_under_max_distance(correlator_t const *correlator) {
@@ -31,7 +31,105 @@
 
 #include "photon_gn.h"
 #include <math.h>
+#include <string.h>
 #include "../error.h"
+#include "../modes.h"
+
+static unsigned int const gn_permutations_2[2][2] = {
+	{0, 1}, {1, 0}
+};
+
+static unsigned int const gn_permutations_identity_2[1][2] = {
+	{0, 1}
+};
+
+static unsigned int const gn_permutations_3[6][3] = {
+	{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}
+};
+
+#define GN_KERNEL_NAME photon_gn_kernel_t2_2
+#define GN_KERNEL_MODE MODE_T2
+#define GN_KERNEL_ORDER 2
+#define GN_KERNEL_PERMUTATIONS gn_permutations_2
+#define GN_KERNEL_SYMMETRIC 0
+#include "gn_kernel.h"
+#undef GN_KERNEL_NAME
+#undef GN_KERNEL_MODE
+#undef GN_KERNEL_ORDER
+#undef GN_KERNEL_PERMUTATIONS
+#undef GN_KERNEL_SYMMETRIC
+
+#define GN_KERNEL_NAME photon_gn_kernel_t2_3
+#define GN_KERNEL_MODE MODE_T2
+#define GN_KERNEL_ORDER 3
+#define GN_KERNEL_PERMUTATIONS gn_permutations_3
+#define GN_KERNEL_SYMMETRIC 0
+#include "gn_kernel.h"
+#undef GN_KERNEL_NAME
+#undef GN_KERNEL_MODE
+#undef GN_KERNEL_ORDER
+#undef GN_KERNEL_PERMUTATIONS
+#undef GN_KERNEL_SYMMETRIC
+
+#define GN_KERNEL_NAME photon_gn_kernel_t3_2
+#define GN_KERNEL_MODE MODE_T3
+#define GN_KERNEL_ORDER 2
+#define GN_KERNEL_PERMUTATIONS gn_permutations_2
+#define GN_KERNEL_SYMMETRIC 0
+#include "gn_kernel.h"
+#undef GN_KERNEL_NAME
+#undef GN_KERNEL_MODE
+#undef GN_KERNEL_ORDER
+#undef GN_KERNEL_PERMUTATIONS
+#undef GN_KERNEL_SYMMETRIC
+
+#define GN_KERNEL_NAME photon_gn_kernel_t3_3
+#define GN_KERNEL_MODE MODE_T3
+#define GN_KERNEL_ORDER 3
+#define GN_KERNEL_PERMUTATIONS gn_permutations_3
+#define GN_KERNEL_SYMMETRIC 0
+#include "gn_kernel.h"
+#undef GN_KERNEL_NAME
+#undef GN_KERNEL_MODE
+#undef GN_KERNEL_ORDER
+#undef GN_KERNEL_PERMUTATIONS
+#undef GN_KERNEL_SYMMETRIC
+
+#define GN_KERNEL_NAME photon_gn_kernel_t2_2_symmetric
+#define GN_KERNEL_MODE MODE_T2
+#define GN_KERNEL_ORDER 2
+#define GN_KERNEL_PERMUTATIONS gn_permutations_identity_2
+#define GN_KERNEL_SYMMETRIC 1
+#include "gn_kernel.h"
+#undef GN_KERNEL_NAME
+#undef GN_KERNEL_MODE
+#undef GN_KERNEL_ORDER
+#undef GN_KERNEL_PERMUTATIONS
+#undef GN_KERNEL_SYMMETRIC
+
+#define GN_KERNEL_NAME photon_gn_kernel_t3_2_symmetric
+#define GN_KERNEL_MODE MODE_T3
+#define GN_KERNEL_ORDER 2
+#define GN_KERNEL_PERMUTATIONS gn_permutations_identity_2
+#define GN_KERNEL_SYMMETRIC 1
+#include "gn_kernel.h"
+#undef GN_KERNEL_NAME
+#undef GN_KERNEL_MODE
+#undef GN_KERNEL_ORDER
+#undef GN_KERNEL_PERMUTATIONS
+#undef GN_KERNEL_SYMMETRIC
+
+static int photon_gn_push_generic(photon_gn_t *gn, photon_t const *photon);
+static int photon_gn_flush_generic(photon_gn_t *gn);
+static int photon_gn_push_sweep(photon_gn_t *gn, photon_t const *photon);
+static int photon_gn_flush_sweep(photon_gn_t *gn);
+static int photon_gn_push_log_sweep(photon_gn_t *gn, photon_t const *photon);
+static int photon_gn_flush_log_sweep(photon_gn_t *gn);
+static int photon_gn_push_kernel(photon_gn_t *gn, photon_t const *photon);
+static int photon_gn_flush_kernel(photon_gn_t *gn);
+static int photon_gn_push_lifetime(photon_gn_t *gn, photon_t const *photon);
+static int photon_gn_flush_lifetime(photon_gn_t *gn);
+
 /* 
  * For correlation we typically need to join several operations together.
  * At minimum, we must send the photons to the correlator and the correlations
@@ -45,7 +143,9 @@
 
 photon_gn_t *photon_gn_alloc(int const mode, int const order, 
 		int const channels, size_t const queue_size,
-		limits_t const *time_limits, limits_t const *pulse_limits) {
+		int const time_scale, limits_t const *time_limits, 
+		limits_t const *pulse_limits,
+		unsigned int const n_tuples, unsigned int const *tuples) {
 	photon_gn_t *gn = NULL;
 	long long min_time_distance, max_time_distance;
 	long long min_pulse_distance, max_pulse_distance;
@@ -69,28 +169,192 @@ photon_gn_t *photon_gn_alloc(int const mode, int const order,
 			min_time_distance, max_time_distance,
 			min_pulse_distance, max_pulse_distance);
 
-	gn->correlator = correlator_alloc(mode, order, 
-			queue_size, false,
-			min_time_distance, max_time_distance,
-			min_pulse_distance, max_pulse_distance);
+	gn->correlator = NULL;
+	gn->sweep = NULL;
+	gn->log_sweep = NULL;
+	gn->lifetime = NULL;
+	gn->histogram = NULL;
+	gn->block = NULL;
+	gn->kernel = NULL;
+	gn->push = photon_gn_push_generic;
+	gn->flush = photon_gn_flush_generic;
+
+	memcpy(&(gn->time_limits), time_limits, sizeof(limits_t));
+	memcpy(&(gn->pulse_limits), pulse_limits, sizeof(limits_t));
+
 	gn->histogram = histogram_gn_alloc(mode, order, channels,
-			SCALE_LINEAR, time_limits,
-			SCALE_LINEAR, pulse_limits);
+			time_scale, time_limits,
+			SCALE_LINEAR, pulse_limits,
+			n_tuples, tuples);
+
+	if ( gn->histogram == NULL ) {
+		photon_gn_free(&gn);
+		return(gn);
+	}
+
+	/* g2 for t2 photons is most of what we do, and needs none of the 
+	 * general machinery, so it gets its own engine, as do lifetimes. The 
+	 * other common cases get kernels specialized for their mode and order, 
+	 * and anything else goes through the correlator one correlation at a 
+	 * time. Other time scales are only handled for t2 g2, by an engine 
+	 * which works a bin at a time.
+	 */
+	if ( mode == MODE_T2 && order == 2 && time_scale != SCALE_LINEAR ) {
+		debug("Using the log-binned g2 sweep.\n");
+		gn->log_sweep = log_sweep_alloc(channels, queue_size,
+				gn->histogram->edges[0],
+				min_time_distance, max_time_distance);
+		gn->push = photon_gn_push_log_sweep;
+		gn->flush = photon_gn_flush_log_sweep;
+	} else if ( time_scale != SCALE_LINEAR ) {
+		error("Only t2 g2 can be calculated on a non-linear time axis.\n");
+		photon_gn_free(&gn);
+		return(gn);
+	} else if ( mode == MODE_T2 && order == 2 && max_time_distance > 0 ) {
+		debug("Using the g2 sweep.\n");
+		gn->sweep = sweep_alloc(channels, queue_size,
+				min_time_distance, max_time_distance);
+		gn->push = photon_gn_push_sweep;
+		gn->flush = photon_gn_flush_sweep;
+	} else if ( mode == MODE_T3 && order == 1 ) {
+		debug("Using the lifetime histogram.\n");
+		gn->lifetime = lifetime_alloc(time_limits,
+				min_time_distance, max_time_distance);
+		gn->push = photon_gn_push_lifetime;
+		gn->flush = photon_gn_flush_lifetime;
+	} else {
+		gn->correlator = correlator_alloc(mode, order, 
+				queue_size, false,
+				min_time_distance, max_time_distance,
+				min_pulse_distance, max_pulse_distance);
+
+		if ( mode == MODE_T2 && order == 2 ) {
+			gn->kernel = photon_gn_kernel_t2_2;
+		} else if ( mode == MODE_T2 && order == 3 ) {
+			gn->kernel = photon_gn_kernel_t2_3;
+		} else if ( mode == MODE_T3 && order == 2 ) {
+			gn->kernel = photon_gn_kernel_t3_2;
+		} else if ( mode == MODE_T3 && order == 3 ) {
+			gn->kernel = photon_gn_kernel_t3_3;
+		}
 
-	if ( gn->correlator == NULL || gn->histogram == NULL ) {
+		if ( gn->kernel != NULL ) {
+			debug("Using a kernel for mode %d, order %d.\n", mode, order);
+			gn->push = photon_gn_push_kernel;
+			gn->flush = photon_gn_flush_kernel;
+			gn->block = photon_block_alloc(mode, queue_size);
+
+			if ( gn->block == NULL ) {
+				photon_gn_free(&gn);
+				return(gn);
+			}
+		}
+	}
+
+	if ( gn->correlator == NULL && gn->sweep == NULL && 
+			gn->log_sweep == NULL && gn->lifetime == NULL ) {
 		photon_gn_free(&gn);
 		return(gn);
 	}
 
+	/* The two orderings of a pair mirror each other, so when the bins do
+	 * as well only one ordering needs to be counted. */
+	if ( order == 2 && histogram_gn_can_mirror(gn->histogram) ) {
+		debug("Counting only one ordering of each pair.\n");
+
+		if ( histogram_gn_set_symmetric(gn->histogram) != PC_SUCCESS ) {
+			photon_gn_free(&gn);
+			return(gn);
+		}
+
+		if ( gn->correlator != NULL ) {
+			correlator_set_symmetric(gn->correlator, true);
+		}
+
+		if ( gn->kernel == photon_gn_kernel_t2_2 ) {
+			gn->kernel = photon_gn_kernel_t2_2_symmetric;
+		} else if ( gn->kernel == photon_gn_kernel_t3_2 ) {
+			gn->kernel = photon_gn_kernel_t3_2_symmetric;
+		}
+	}
+
 	return(gn);
 }
 
 void photon_gn_init(photon_gn_t *gn) {
-	correlator_init(gn->correlator);
+	if ( gn->sweep != NULL ) {
+		sweep_init(gn->sweep);
+	} else if ( gn->log_sweep != NULL ) {
+		log_sweep_init(gn->log_sweep);
+	} else if ( gn->lifetime != NULL ) {
+		lifetime_init(gn->lifetime);
+	} else {
+		correlator_init(gn->correlator);
+	}
+
+	front_limit_init(&(gn->limit));
+	gn->fronts = 0;
+
 	histogram_gn_init(gn->histogram);
 }
 
 int photon_gn_push(photon_gn_t *gn, photon_t const *photon) {
+	return(gn->push(gn, photon));
+}
+
+int photon_gn_push_batch(photon_gn_t *gn, photon_t const *photons,
+		size_t const n_photons) {
+/* Push several photons in order. The lifetime histogram takes them all at
+ * once, the rest one at a time. */
+	size_t i;
+	int status;
+	int result = PC_SUCCESS;
+
+	if ( gn->lifetime != NULL ) {
+		return(lifetime_push_batch(gn->lifetime, gn->histogram, 
+				photons, n_photons));
+	}
+
+	for ( i = 0; i < n_photons; i++ ) {
+		status = gn->push(gn, &photons[i]);
+
+		if ( status != PC_SUCCESS ) {
+			result = status;
+		}
+	}
+
+	return(result);
+}
+
+int photon_gn_flush(photon_gn_t *gn) {
+	return(gn->flush(gn));
+}
+
+int photon_gn_can_limit(photon_gn_t const *gn) {
+	return( gn->sweep != NULL || gn->log_sweep != NULL ||
+			(gn->kernel != NULL && gn->histogram->mode == MODE_T2) ||
+			gn->lifetime != NULL );
+}
+
+void photon_gn_set_limit(photon_gn_t *gn, unsigned long long const limit) {
+/* Only count the correlations whose first photon is among the first limit
+ * pushed since the last init. For t2 the correlator handles the photons
+ * as fronts in the order they arrive, and the block of each front depends
+ * only on the photons after it, so the counts for those photons are exactly
+ * as they would be in the full stream.
+ */
+	front_limit_set(&(gn->limit), limit);
+
+	if ( gn->sweep != NULL ) {
+		sweep_set_limit(gn->sweep, limit);
+	} else if ( gn->log_sweep != NULL ) {
+		log_sweep_set_limit(gn->log_sweep, limit);
+	} else if ( gn->lifetime != NULL ) {
+		lifetime_set_limit(gn->lifetime, limit);
+	}
+}
+
+static int photon_gn_push_generic(photon_gn_t *gn, photon_t const *photon) {
 	int result = correlator_push(gn->correlator, photon);
 
 	while ( result == PC_SUCCESS &&
@@ -102,7 +366,7 @@ int photon_gn_push(photon_gn_t *gn, photon_t const *photon) {
 	return(result);
 }
 
-int photon_gn_flush(photon_gn_t *gn) {
+static int photon_gn_flush_generic(photon_gn_t *gn) {
 	int result = PC_SUCCESS;
 
 	correlator_flush(gn->correlator);
@@ -116,6 +380,137 @@ int photon_gn_flush(photon_gn_t *gn) {
 	return(result);
 }
 
+static int photon_gn_push_sweep(photon_gn_t *gn, photon_t const *photon) {
+	return(sweep_push(gn->sweep, gn->histogram, photon));
+}
+
+static int photon_gn_flush_sweep(photon_gn_t *gn) {
+	sweep_init(gn->sweep);
+	return(PC_SUCCESS);
+}
+
+static int photon_gn_push_log_sweep(photon_gn_t *gn, photon_t const *photon) {
+	return(log_sweep_push(gn->log_sweep, gn->histogram, photon));
+}
+
+static int photon_gn_flush_log_sweep(photon_gn_t *gn) {
+	int result = log_sweep_flush(gn->log_sweep, gn->histogram);
+
+	log_sweep_init(gn->log_sweep);
+	return(result);
+}
+
+static int photon_gn_check_channel(photon_gn_t const *gn, 
+		photon_t const *photon) {
+/* The kernels index the histograms by channel without checking, so catch
+ * bad channels before they reach the queue.
+ */
+	unsigned int const channel = gn->histogram->mode == MODE_T2 ?
+			photon->t2.channel : photon->t3.channel;
+
+	if ( channel >= gn->histogram->channels ) {
+		error("Invalid histogram index requested for channel %u "
+				"(limit %u). Check that you have specified the correct "
+				"number of channels.\n", 
+				channel, gn->histogram->channels);
+		return(PC_ERROR_INDEX);
+	}
+
+	return(PC_SUCCESS);
+}
+
+static int photon_gn_gather(photon_gn_t *gn) {
+/* Copy the photons of the current block which the kernel may use, from 
+ * the front of the queue up to the pruned limit.
+ */
+	size_t i;
+	size_t const n = gn->correlator->index_offsets->limit + 1;
+	photon_t *photon;
+	photon_block_t *block = gn->block;
+
+	if ( n > block->capacity ) {
+		photon_block_free(&(gn->block));
+		gn->block = photon_block_alloc(gn->histogram->mode, 2*n);
+		block = gn->block;
+
+		if ( block == NULL ) {
+			error("Could not allocate photons for the kernel.\n");
+			return(PC_ERROR_MEM);
+		}
+	}
+
+	for ( i = 0; i < n; i++ ) {
+		photon_queue_index(gn->correlator->queue, &photon, i);
+
+		if ( block->mode == MODE_T2 ) {
+			block->channel[i] = photon->t2.channel;
+			block->time[i] = photon->t2.time;
+		} else {
+			block->channel[i] = photon->t3.channel;
+			block->pulse[i] = photon->t3.pulse;
+			block->time[i] = photon->t3.time;
+		}
+	}
+
+	block->n_photons = n;
+
+	return(PC_SUCCESS);
+}
+
+static int photon_gn_next_blocks(photon_gn_t *gn) {
+	int result = PC_SUCCESS;
+
+	while ( result == PC_SUCCESS &&
+			correlator_next_block(gn->correlator) == PC_SUCCESS ) {
+		if ( gn->limit.limited && gn->fronts >= gn->limit.fronts ) {
+			continue;
+		}
+
+		gn->fronts++;
+		result = photon_gn_gather(gn);
+
+		if ( result == PC_SUCCESS ) {
+			gn->kernel(gn);
+		}
+	}
+
+	return(result);
+}
+
+static int photon_gn_push_kernel(photon_gn_t *gn, photon_t const *photon) {
+	int result = photon_gn_check_channel(gn, photon);
+
+	if ( result != PC_SUCCESS ) {
+		front_limit_push(&(gn->limit), false);
+		return(result);
+	}
+
+	front_limit_push(&(gn->limit), true);
+	result = correlator_push(gn->correlator, photon);
+
+	if ( result == PC_SUCCESS ) {
+		result = photon_gn_next_blocks(gn);
+	}
+
+	return(result);
+}
+
+static int photon_gn_flush_kernel(photon_gn_t *gn) {
+	correlator_flush(gn->correlator);
+
+	return(photon_gn_next_blocks(gn));
+}
+
+static int photon_gn_push_lifetime(photon_gn_t *gn, photon_t const *photon) {
+	return(lifetime_push(gn->lifetime, gn->histogram, photon));
+}
+
+static int photon_gn_flush_lifetime(photon_gn_t *gn) {
+	/* Photons are binned as they arrive, so only the limit is left. */
+	lifetime_init(gn->lifetime);
+	return(PC_SUCCESS);
+}
+
 int photon_gn_fprintf(FILE *stream_out, photon_gn_t const *gn) {
 	return(histogram_gn_fprintf(stream_out, gn->histogram));
 }
@@ -132,6 +527,10 @@ int photon_gn_fprintf_counts(FILE *stream_out, photon_gn_t const *gn) {
 void photon_gn_free(photon_gn_t **gn) {
 	if  ( *gn != NULL ) {
 		correlator_free(&((*gn)->correlator));
+		sweep_free(&((*gn)->sweep));
+		log_sweep_free(&((*gn)->log_sweep));
+		lifetime_free(&((*gn)->lifetime));
+		photon_block_free(&((*gn)->block));
 		histogram_gn_free(&((*gn)->histogram));
 
 		free(*gn);
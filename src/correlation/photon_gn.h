@@ -35,19 +35,45 @@
 #include <stdio.h>
 #include "../options.h"
 #include "../correlation/correlator.h"
+#include "../correlation/sweep.h"
+#include "../correlation/log_sweep.h"
+#include "../correlation/front_limit.h"
+#include "../photon/block.h"
 #include "../histogram/histogram_gn.h"
+#include "../histogram/lifetime.h"
 
-typedef struct {
+typedef struct _photon_gn_t {
 	correlator_t *correlator;
+	sweep_t *sweep;
+	log_sweep_t *log_sweep;
+	lifetime_t *lifetime;
 	histogram_gn_t *histogram;
+
+	limits_t time_limits;
+	limits_t pulse_limits;
+
+	photon_block_t *block;
+	void (*kernel)(struct _photon_gn_t *gn);
+
+	int (*push)(struct _photon_gn_t *gn, photon_t const *photon);
+	int (*flush)(struct _photon_gn_t *gn);
+
+	front_limit_t limit;
+	unsigned long long fronts;
 } photon_gn_t;
 
 photon_gn_t *photon_gn_alloc(int const mode, int const order, 
 		int const channels, size_t const queue_size,
-		limits_t const *time_limits, limits_t const *pulse_limits);
+		int const time_scale, limits_t const *time_limits, 
+		limits_t const *pulse_limits,
+		unsigned int const n_tuples, unsigned int const *tuples);
 void photon_gn_init(photon_gn_t *gn);
 int photon_gn_push(photon_gn_t *gn, photon_t const *photon);
+int photon_gn_push_batch(photon_gn_t *gn, photon_t const *photons,
+		size_t const n_photons);
 int photon_gn_flush(photon_gn_t *gn);
+int photon_gn_can_limit(photon_gn_t const *gn);
+void photon_gn_set_limit(photon_gn_t *gn, unsigned long long const limit);
 int photon_gn_fprintf(FILE *stream_out, photon_gn_t const *gn);
 int photon_gn_fprintf_bins(FILE *stream_out, photon_gn_t const *gn,
 			unsigned int const blanks);
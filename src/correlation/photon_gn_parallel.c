@@ -0,0 +1,392 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "photon_gn_parallel.h"
+#include "../error.h"
+#include "../modes.h"
+#include "../types.h"
+
+/*
+ * Split photon_gn over threads, as photon_gn_push and photon_gn_flush would
+ * run it on one. The photons are collected into a segment, and the photons
+ * of the segment whose correlations are all closed by later photons in it 
+ * are split into contiguous chunks, one per worker. Each worker counts only 
+ * the correlations starting in its chunk, so it is given the photons of the
+ * following chunks as far as the last photon which could affect those: the 
+ * first photon at least the maximum distance beyond the chunk, which closes
+ * the block of its last photon. Only a worker which reaches the end of the 
+ * photons is flushed, and the counts are summed into the caller's gn. They
+ * are identical to those of a single gn.
+ *
+ * The photons which are not yet closed are carried over into the other 
+ * segment, which is filled while the workers count this one, so reading and
+ * counting overlap. Memory stays at two segments, unless the correlation 
+ * has no maximum distance, in which case every photon must be kept until 
+ * the end.
+ */
+static void *photon_gn_worker_run(void *arg) {
+	photon_gn_worker_t *worker = (photon_gn_worker_t *)arg;
+
+	photon_gn_push_batch(worker->gn, worker->photons, worker->n_photons);
+
+	if ( worker->flush ) {
+		worker->result = photon_gn_flush(worker->gn);
+	} else {
+		worker->result = PC_SUCCESS;
+	}
+
+	return(NULL);
+}
+
+photon_gn_parallel_t *photon_gn_parallel_alloc(unsigned int const n_gns,
+		int const mode, int const order, 
+		int const channels, size_t const queue_size,
+		int const time_scale, limits_t const *time_limits, 
+		limits_t const *pulse_limits,
+		unsigned int const n_tuples, unsigned int const *tuples) {
+	unsigned int i;
+	photon_gn_parallel_t *parallel = NULL;
+
+	parallel = (photon_gn_parallel_t *)calloc(1, 
+			sizeof(photon_gn_parallel_t));
+
+	if ( parallel == NULL ) {
+		return(parallel);
+	}
+
+	parallel->n_gns = n_gns;
+	parallel->workers = (photon_gn_worker_t *)calloc(n_gns, 
+			sizeof(photon_gn_worker_t));
+
+	if ( parallel->workers == NULL ) {
+		photon_gn_parallel_free(&parallel);
+		return(parallel);
+	}
+
+	for ( i = 0; i < n_gns; i++ ) {
+		parallel->workers[i].gn = photon_gn_alloc(mode, order, channels,
+				queue_size, time_scale, time_limits, pulse_limits, 
+				n_tuples, tuples);
+
+		if ( parallel->workers[i].gn == NULL ) {
+			photon_gn_parallel_free(&parallel);
+			return(parallel);
+		}
+	}
+
+	return(parallel);
+}
+
+void photon_gn_parallel_init(photon_gn_parallel_t *parallel) {
+	parallel->n_buffered = 0;
+}
+
+static int photon_gn_parallel_finish(photon_gn_parallel_t *parallel,
+		photon_gn_t *gn) {
+/* Wait for the workers of the last segment and add their counts to gn. */
+	unsigned int i;
+	int result = PC_SUCCESS;
+	photon_gn_worker_t *worker;
+
+	for ( i = 0; i < parallel->n_workers; i++ ) {
+		worker = &(parallel->workers[i]);
+
+		if ( worker->running ) {
+			pthread_join(worker->thread, NULL);
+			worker->running = false;
+		}
+
+		if ( worker->result != PC_SUCCESS ) {
+			result = worker->result;
+		}
+
+		histogram_gn_update(gn->histogram, worker->gn->histogram);
+	}
+
+	parallel->n_workers = 0;
+
+	return(result);
+}
+
+void photon_gn_parallel_free(photon_gn_parallel_t **parallel) {
+	unsigned int i;
+
+	if ( *parallel != NULL ) {
+		if ( (*parallel)->workers != NULL ) {
+			for ( i = 0; i < (*parallel)->n_gns; i++ ) {
+				if ( (*parallel)->workers[i].running ) {
+					pthread_join((*parallel)->workers[i].thread, NULL);
+				}
+
+				photon_gn_free(&((*parallel)->workers[i].gn));
+			}
+
+			free((*parallel)->workers);
+		}
+
+		free((*parallel)->segments[0]);
+		free((*parallel)->segments[1]);
+		free(*parallel);
+		*parallel = NULL;
+	}
+}
+
+static long long photon_gn_parallel_max_distance(photon_gn_t const *gn) {
+	if ( gn->sweep != NULL ) {
+		return(gn->sweep->max_time_distance);
+	} else if ( gn->log_sweep != NULL ) {
+		return(gn->log_sweep->max_time_distance);
+	} else if ( gn->correlator != NULL ) {
+		return(gn->correlator->max_time_distance);
+	} else {
+		return(0);
+	}
+}
+
+static int photon_gn_parallel_counted(photon_gn_t const *gn,
+		photon_t const *photon) {
+/* Photons on invalid or unselected channels never reach the engine, so 
+ * cannot close a correlation. */
+	unsigned int const channel = photon->t2.channel;
+
+	return( channel < gn->histogram->channels && 
+			gn->histogram->channel_selected[channel] );
+}
+
+static size_t photon_gn_parallel_closed(photon_gn_parallel_t const *parallel,
+		photon_t const *photons, size_t const n_photons) {
+/* The number of leading photons whose correlations are closed by the later
+ * photons given: those at least the maximum distance before the last photon 
+ * which reaches the engine. The t3 first-order histogram has nothing to close. */
+	photon_gn_t const *gn = parallel->workers[0].gn;
+	long long const max_distance = photon_gn_parallel_max_distance(gn);
+	size_t last;
+	size_t closed;
+
+	if ( gn->histogram->mode != MODE_T2 ) {
+		return(n_photons);
+	} else if ( max_distance == 0 ) {
+		return(0);
+	}
+
+	for ( last = n_photons; last > 0 && 
+			! photon_gn_parallel_counted(gn, &photons[last-1]); 
+			last-- ) {
+	}
+
+	closed = 0;
+	while ( last > 0 && closed < last - 1 &&
+			photons[last-1].t2.time - photons[closed].t2.time 
+				>= max_distance ) {
+		closed++;
+	}
+
+	return(closed);
+}
+
+static void photon_gn_parallel_start(photon_gn_parallel_t *parallel,
+		photon_t const *photons, size_t const n_photons, 
+		size_t const n_counted) {
+/* Start the workers on the correlations of the first n_counted photons. */
+	unsigned int i;
+	size_t start;
+	size_t end;
+	size_t last;
+	photon_gn_t const *gn = parallel->workers[0].gn;
+	long long const max_distance = photon_gn_parallel_max_distance(gn);
+	photon_gn_worker_t *worker;
+
+	parallel->n_workers = parallel->n_gns;
+	if ( parallel->n_workers > n_counted ) {
+		parallel->n_workers = n_counted;
+	}
+
+	for ( i = 0; i < parallel->n_workers; i++ ) {
+		worker = &(parallel->workers[i]);
+
+		start = n_counted/parallel->n_workers*i;
+		end = i + 1 == parallel->n_workers ? 
+				n_counted : n_counted/parallel->n_workers*(i+1);
+
+		photon_gn_init(worker->gn);
+		worker->photons = &photons[start];
+		worker->result = PC_SUCCESS;
+
+		last = end;
+		if ( gn->histogram->mode == MODE_T2 ) {
+			if ( max_distance == 0 ) {
+				last = n_photons;
+			}
+
+			while ( last < n_photons && 
+					( photons[last].t2.time - photons[end-1].t2.time 
+						< max_distance ||
+					  ! photon_gn_parallel_counted(gn, &photons[last]) ) ) {
+				last++;
+			}
+
+			if ( last < n_photons ) {
+				last++;
+			}
+		}
+
+		worker->n_photons = last - start;
+		worker->flush = (last == n_photons);
+
+		if ( end != n_photons ) {
+			photon_gn_set_limit(worker->gn, end - start);
+		}
+
+		debug("Worker %u: photons %zu to %zu, counting to %zu.\n", 
+				i, start, last, end);
+
+		if ( pthread_create(&(worker->thread), NULL, 
+				photon_gn_worker_run, worker) != 0 ) {
+			error("Could not start thread %u, handling its photons "
+					"directly.\n", i);
+			photon_gn_worker_run(worker);
+		} else {
+			worker->running = true;
+		}
+	}
+}
+
+static int photon_gn_parallel_reserve(photon_t **segment, size_t *capacity,
+		size_t const size) {
+	photon_t *photons;
+
+	if ( size <= *capacity ) {
+		return(PC_SUCCESS);
+	}
+
+	photons = (photon_t *)realloc(*segment, sizeof(photon_t)*size);
+
+	if ( photons == NULL ) {
+		error("Could not allocate photons for the threads.\n");
+		return(PC_ERROR_MEM);
+	}
+
+	*segment = photons;
+	*capacity = size;
+
+	return(PC_SUCCESS);
+}
+
+static int photon_gn_parallel_submit(photon_gn_parallel_t *parallel,
+		photon_gn_t *gn) {
+/* Hand the closed photons of the current segment to the workers, and carry
+ * the rest over to the other segment once its workers are done. */
+	int result;
+	unsigned int const current = parallel->current;
+	unsigned int const other = 1 - current;
+	size_t const n_counted = photon_gn_parallel_closed(parallel,
+			parallel->segments[current], parallel->n_buffered);
+	size_t const tail = parallel->n_buffered - n_counted;
+
+	if ( n_counted == 0 ) {
+		return(PC_SUCCESS);
+	}
+
+	result = photon_gn_parallel_finish(parallel, gn);
+
+	if ( result == PC_SUCCESS ) {
+		result = photon_gn_parallel_reserve(&(parallel->segments[other]),
+				&(parallel->capacity[other]), parallel->capacity[current]);
+	}
+
+	if ( result == PC_SUCCESS ) {
+		photon_gn_parallel_start(parallel, parallel->segments[current], 
+				parallel->n_buffered, n_counted);
+
+		memcpy(parallel->segments[other], 
+				&(parallel->segments[current][n_counted]),
+				sizeof(photon_t)*tail);
+		parallel->current = other;
+		parallel->n_buffered = tail;
+	}
+
+	return(result);
+}
+
+int photon_gn_parallel_push(photon_gn_parallel_t *parallel, photon_gn_t *gn,
+		photon_t const *photons, size_t const n_photons) {
+	int result = PC_SUCCESS;
+	size_t size;
+
+	if ( parallel->n_buffered + n_photons > 
+			parallel->capacity[parallel->current] ) {
+		result = photon_gn_parallel_submit(parallel, gn);
+	}
+
+	/* Keep room for at least as many new photons as are carried over, so 
+	 * that each segment makes progress. */
+	size = 2*(parallel->n_buffered + n_photons);
+	if ( size < PHOTON_GN_SEGMENT_SIZE ) {
+		size = PHOTON_GN_SEGMENT_SIZE;
+	}
+
+	if ( result == PC_SUCCESS && parallel->n_buffered + n_photons > 
+			parallel->capacity[parallel->current] ) {
+		result = photon_gn_parallel_reserve(
+				&(parallel->segments[parallel->current]),
+				&(parallel->capacity[parallel->current]), size);
+	}
+
+	if ( result == PC_SUCCESS ) {
+		memcpy(&(parallel->segments[parallel->current][parallel->n_buffered]),
+				photons, sizeof(photon_t)*n_photons);
+		parallel->n_buffered += n_photons;
+	}
+
+	return(result);
+}
+
+int photon_gn_parallel_flush(photon_gn_parallel_t *parallel, 
+		photon_gn_t *gn) {
+/* Count everything left, and flush at the end of the photons. */
+	int result;
+
+	result = photon_gn_parallel_finish(parallel, gn);
+
+	if ( result == PC_SUCCESS && parallel->n_buffered > 0 ) {
+		photon_gn_parallel_start(parallel, 
+				parallel->segments[parallel->current],
+				parallel->n_buffered, parallel->n_buffered);
+		result = photon_gn_parallel_finish(parallel, gn);
+	}
+
+	parallel->n_buffered = 0;
+
+	return(result);
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PHOTON_GN_PARALLEL_H_
+#define PHOTON_GN_PARALLEL_H_
+
+#include <pthread.h>
+
+#include "photon_gn.h"
+
+/* The photons are collected into segments of this many, to be split between
+ * the threads. */
+#define PHOTON_GN_SEGMENT_SIZE 262144
+
+/*
+ * One worker: its own gn, the chunk of the segment it counts, and the thread
+ * which runs it.
+ */
+typedef struct {
+	photon_gn_t *gn;
+	photon_t const *photons;
+	size_t n_photons;
+	int flush;
+	int result;
+
+	pthread_t thread;
+	int running;
+} photon_gn_worker_t;
+
+typedef struct {
+	unsigned int n_gns;
+	photon_gn_worker_t *workers;
+	unsigned int n_workers;
+
+	photon_t *segments[2];
+	size_t capacity[2];
+	unsigned int current;
+	size_t n_buffered;
+} photon_gn_parallel_t;
+
+photon_gn_parallel_t *photon_gn_parallel_alloc(unsigned int const n_gns,
+		int const mode, int const order, 
+		int const channels, size_t const queue_size,
+		int const time_scale, limits_t const *time_limits, 
+		limits_t const *pulse_limits,
+		unsigned int const n_tuples, unsigned int const *tuples);
+void photon_gn_parallel_init(photon_gn_parallel_t *parallel);
+void photon_gn_parallel_free(photon_gn_parallel_t **parallel);
+
+int photon_gn_parallel_push(photon_gn_parallel_t *parallel, photon_gn_t *gn,
+		photon_t const *photons, size_t const n_photons);
+int photon_gn_parallel_flush(photon_gn_parallel_t *parallel, 
+		photon_gn_t *gn);
+
+#endif
@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+
+#include "photon_gn_pool.h"
+#include "../error.h"
+#include "../types.h"
+
+/*
+ * Time-dependent correlations treat each window on its own, so several 
+ * windows can be computed at once. The pool holds one worker per thread,
+ * and window n goes to worker n modulo the size of the pool. Before a 
+ * worker takes a new window, the row of its previous window is written; 
+ * since the workers are used in turn, that is always the oldest window
+ * still outstanding, and the rows come out in window order without any 
+ * further bookkeeping.
+ *
+ * Reading the photons, and everything else which must see them in order 
+ * (intensity, number), stays with the caller.
+ */
+static void *photon_gn_window_run(void *arg) {
+	photon_gn_window_t *window = (photon_gn_window_t *)arg;
+
+	while ( true ) {
+		pthread_mutex_lock(&(window->mutex));
+		while ( window->state != PHOTON_GN_WINDOW_QUEUED && 
+				! window->stop ) {
+			pthread_cond_wait(&(window->cond), &(window->mutex));
+		}
+
+		if ( window->stop ) {
+			pthread_mutex_unlock(&(window->mutex));
+			break;
+		}
+		pthread_mutex_unlock(&(window->mutex));
+
+		photon_gn_init(window->gn);
+		photon_gn_push_batch(window->gn, window->photons, window->n_photons);
+		photon_gn_flush(window->gn);
+
+		pthread_mutex_lock(&(window->mutex));
+		window->state = PHOTON_GN_WINDOW_DONE;
+		pthread_cond_broadcast(&(window->cond));
+		pthread_mutex_unlock(&(window->mutex));
+	}
+
+	return(NULL);
+}
+
+photon_gn_pool_t *photon_gn_pool_alloc(unsigned int const n_windows,
+		int const mode, int const order, 
+		int const channels, size_t const queue_size,
+		int const time_scale, limits_t const *time_limits, 
+		limits_t const *pulse_limits,
+		unsigned int const n_tuples, unsigned int const *tuples) {
+	unsigned int i;
+	photon_gn_pool_t *pool = NULL;
+
+	pool = (photon_gn_pool_t *)malloc(sizeof(photon_gn_pool_t));
+
+	if ( pool == NULL ) {
+		return(pool);
+	}
+
+	pool->n_windows = n_windows;
+	pool->next = 0;
+	pool->windows = (photon_gn_window_t *)calloc(n_windows, 
+			sizeof(photon_gn_window_t));
+
+	if ( pool->windows == NULL ) {
+		photon_gn_pool_free(&pool);
+		return(pool);
+	}
+
+	for ( i = 0; i < n_windows; i++ ) {
+		pthread_mutex_init(&(pool->windows[i].mutex), NULL);
+		pthread_cond_init(&(pool->windows[i].cond), NULL);
+		pool->windows[i].state = PHOTON_GN_WINDOW_IDLE;
+	}
+
+	for ( i = 0; i < n_windows; i++ ) {
+		pool->windows[i].gn = photon_gn_alloc(mode, order, channels,
+				queue_size, time_scale, time_limits, pulse_limits, 
+				n_tuples, tuples);
+
+		if ( pool->windows[i].gn == NULL ) {
+			photon_gn_pool_free(&pool);
+			return(pool);
+		}
+	}
+
+	return(pool);
+}
+
+int photon_gn_pool_start(photon_gn_pool_t *pool) {
+	unsigned int i;
+
+	for ( i = 0; i < pool->n_windows; i++ ) {
+		if ( pthread_create(&(pool->windows[i].thread), NULL,
+				photon_gn_window_run, &(pool->windows[i])) ) {
+			error("Could not start window thread %u.\n", i);
+			return(PC_ERROR_UNKNOWN);
+		}
+
+		pool->windows[i].running = true;
+	}
+
+	return(PC_SUCCESS);
+}
+
+void photon_gn_pool_free(photon_gn_pool_t **pool) {
+	unsigned int i;
+	photon_gn_window_t *window;
+
+	if ( *pool != NULL ) {
+		if ( (*pool)->windows != NULL ) {
+			for ( i = 0; i < (*pool)->n_windows; i++ ) {
+				window = &((*pool)->windows[i]);
+
+				if ( window->running ) {
+					pthread_mutex_lock(&(window->mutex));
+					window->stop = true;
+					pthread_cond_broadcast(&(window->cond));
+					pthread_mutex_unlock(&(window->mutex));
+					pthread_join(window->thread, NULL);
+				}
+
+				pthread_mutex_destroy(&(window->mutex));
+				pthread_cond_destroy(&(window->cond));
+				photon_gn_free(&(window->gn));
+				free(window->photons);
+			}
+
+			free((*pool)->windows);
+		}
+
+		free(*pool);
+		*pool = NULL;
+	}
+}
+
+static void photon_gn_window_finish(photon_gn_window_t *window, 
+		FILE *stream_out) {
+/* Wait for the window to be computed and write its row, if it has one. */
+	pthread_mutex_lock(&(window->mutex));
+	while ( window->state == PHOTON_GN_WINDOW_QUEUED ) {
+		pthread_cond_wait(&(window->cond), &(window->mutex));
+	}
+	pthread_mutex_unlock(&(window->mutex));
+
+	if ( window->state == PHOTON_GN_WINDOW_DONE ) {
+		if ( stream_out != NULL ) {
+			fprintf(stream_out, "%lld,%lld,", window->lower, window->upper);
+			photon_gn_fprintf_counts(stream_out, window->gn);
+		}
+
+		window->state = PHOTON_GN_WINDOW_IDLE;
+	}
+}
+
+photon_gn_window_t *photon_gn_pool_next(photon_gn_pool_t *pool, 
+		FILE *stream_out) {
+/* Hand out the worker for the next window, once its last window has been 
+ * written.
+ */
+	photon_gn_window_t *window = &(pool->windows[
+			pool->next % pool->n_windows]);
+
+	photon_gn_window_finish(window, stream_out);
+	window->n_photons = 0;
+
+	return(window);
+}
+
+int photon_gn_window_push(photon_gn_window_t *window, 
+		photon_t const *photon) {
+	photon_t *photons;
+
+	if ( window->n_photons == window->capacity ) {
+		photons = (photon_t *)realloc(window->photons,
+				sizeof(photon_t)*(window->capacity ? 
+					2*window->capacity : 1024));
+
+		if ( photons == NULL ) {
+			error("Could not allocate photons for the window.\n");
+			return(PC_ERROR_MEM);
+		}
+
+		window->photons = photons;
+		window->capacity = window->capacity ? 2*window->capacity : 1024;
+	}
+
+	window->photons[window->n_photons++] = *photon;
+
+	return(PC_SUCCESS);
+}
+
+void photon_gn_pool_submit(photon_gn_pool_t *pool, 
+		photon_gn_window_t *window, 
+		long long const lower, long long const upper) {
+	window->lower = lower;
+	window->upper = upper;
+
+	pthread_mutex_lock(&(window->mutex));
+	window->state = PHOTON_GN_WINDOW_QUEUED;
+	pthread_cond_broadcast(&(window->cond));
+	pthread_mutex_unlock(&(window->mutex));
+
+	pool->next++;
+}
+
+void photon_gn_pool_flush(photon_gn_pool_t *pool, FILE *stream_out) {
+/* Write out the windows still outstanding, oldest first. */
+	unsigned int i;
+
+	for ( i = 0; i < pool->n_windows; i++ ) {
+		photon_gn_window_finish(&(pool->windows[
+				(pool->next + i) % pool->n_windows]), stream_out);
+	}
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PHOTON_GN_POOL_H_
+#define PHOTON_GN_POOL_H_
+
+#include <stdio.h>
+#include <pthread.h>
+
+#include "photon_gn.h"
+
+#define PHOTON_GN_WINDOW_IDLE 0
+#define PHOTON_GN_WINDOW_QUEUED 1
+#define PHOTON_GN_WINDOW_DONE 2
+
+/*
+ * One worker of the pool: its own gn, the photons of the window it was last
+ * handed, and the thread which computes it.
+ */
+typedef struct {
+	photon_gn_t *gn;
+
+	photon_t *photons;
+	size_t n_photons;
+	size_t capacity;
+
+	long long lower;
+	long long upper;
+
+	int state;
+	int stop;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+
+	pthread_t thread;
+	int running;
+} photon_gn_window_t;
+
+typedef struct {
+	unsigned int n_windows;
+	unsigned long long next;
+	photon_gn_window_t *windows;
+} photon_gn_pool_t;
+
+photon_gn_pool_t *photon_gn_pool_alloc(unsigned int const n_windows,
+		int const mode, int const order, 
+		int const channels, size_t const queue_size,
+		int const time_scale, limits_t const *time_limits, 
+		limits_t const *pulse_limits,
+		unsigned int const n_tuples, unsigned int const *tuples);
+int photon_gn_pool_start(photon_gn_pool_t *pool);
+void photon_gn_pool_free(photon_gn_pool_t **pool);
+
+photon_gn_window_t *photon_gn_pool_next(photon_gn_pool_t *pool, 
+		FILE *stream_out);
+int photon_gn_window_push(photon_gn_window_t *window, 
+		photon_t const *photon);
+void photon_gn_pool_submit(photon_gn_pool_t *pool, 
+		photon_gn_window_t *window, 
+		long long const lower, long long const upper);
+void photon_gn_pool_flush(photon_gn_pool_t *pool, FILE *stream_out);
+
+#endif
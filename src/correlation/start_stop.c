@@ -45,6 +45,7 @@ int correlate_start_stop(FILE *stream_in, FILE *stream_out,
 		pc_options_t const *options) {
 	int valid = 0;
 	photon_t photon;
+	photon_next_t next;
 
 	unsigned long long record_number = 0;
 
@@ -55,6 +56,12 @@ int correlate_start_stop(FILE *stream_in, FILE *stream_out,
 		return(PC_ERROR_MODE);
 	}
 
+	next = photon_next_select(options->mode, options->format);
+
+	if ( next == NULL ) {
+		return(PC_ERROR_MODE);
+	}
+
 	correlation = correlation_alloc(options->mode, options->order);
 
 	if ( correlation == NULL ) {
@@ -65,7 +72,7 @@ int correlate_start_stop(FILE *stream_in, FILE *stream_out,
 
 	debug("Correlating in start-stop mode.\n");
 
-	while ( t2_fscanf(stream_in, &photon) == PC_SUCCESS ) {
+	while ( next(stream_in, &photon) == PC_SUCCESS ) {
 		if ( photon.t2.channel == 0 ) {
 			valid = 1;
 			correlation_set_index(correlation, 0, &photon);
@@ -0,0 +1,255 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "sweep.h"
+#include "../error.h"
+
+/*
+ * For a second-order t2 correlation, the general correlator enumerates the
+ * offsets and permutations of each block, copies the photons into a 
+ * correlation, and hands that to the histogram, which rebuilds the channels
+ * and values before finding the bin. Here there is only ever one pair and 
+ * one dimension, so each new photon instead walks back through the photons 
+ * still within the maximum distance of it, and increments the bins of both 
+ * orderings of each pair directly.
+ *
+ * Photons are expected in time order, as for the correlator, so a photon 
+ * which is too far behind the newest one is too far behind all that follow, 
+ * and can be dropped from the window. Every pair is counted as its second 
+ * photon arrives, so there is nothing left to do at the end of the stream.
+ */
+static int sweep_resize(sweep_t *sweep, size_t const capacity) {
+	size_t i;
+	long long *time;
+	unsigned int *channel;
+
+	time = (long long *)malloc(sizeof(long long)*capacity);
+	channel = (unsigned int *)malloc(sizeof(unsigned int)*capacity);
+
+	if ( time == NULL || channel == NULL ) {
+		free(time);
+		free(channel);
+		return(PC_ERROR_MEM);
+	}
+
+	for ( i = 0; i < sweep->size; i++ ) {
+		time[i] = sweep->time[(sweep->left + i) & (sweep->capacity - 1)];
+		channel[i] = sweep->channel[(sweep->left + i) & (sweep->capacity - 1)];
+	}
+
+	free(sweep->time);
+	free(sweep->channel);
+
+	sweep->time = time;
+	sweep->channel = channel;
+	sweep->capacity = capacity;
+	sweep->left = 0;
+
+	return(PC_SUCCESS);
+}
+
+sweep_t *sweep_alloc(unsigned int const channels, size_t const queue_size,
+		long long const min_time_distance, long long const max_time_distance) {
+	sweep_t *sweep = NULL;
+	size_t capacity = 1;
+
+	sweep = (sweep_t *)malloc(sizeof(sweep_t));
+
+	if ( sweep == NULL ) {
+		return(sweep);
+	}
+
+	sweep->channels = channels;
+	sweep->min_time_distance = min_time_distance;
+	sweep->max_time_distance = max_time_distance;
+
+	sweep->capacity = 0;
+	sweep->left = 0;
+	sweep->size = 0;
+	sweep->pushed = 0;
+	front_limit_init(&(sweep->limit));
+	sweep->time = NULL;
+	sweep->channel = NULL;
+
+	/* Keep the capacity a power of two, so wrapping is a mask. */
+	while ( capacity < queue_size ) {
+		capacity *= 2;
+	}
+
+	if ( sweep_resize(sweep, capacity) != PC_SUCCESS ) {
+		sweep_free(&sweep);
+		return(sweep);
+	}
+
+	return(sweep);
+}
+
+void sweep_init(sweep_t *sweep) {
+	sweep->left = 0;
+	sweep->size = 0;
+	sweep->pushed = 0;
+	front_limit_init(&(sweep->limit));
+}
+
+void sweep_set_limit(sweep_t *sweep, unsigned long long const limit) {
+/* Only count pairs whose earlier photon is among the first limit pushed. */
+	front_limit_set(&(sweep->limit), limit);
+}
+
+void sweep_free(sweep_t **sweep) {
+	if ( *sweep != NULL ) {
+		free((*sweep)->time);
+		free((*sweep)->channel);
+		free(*sweep);
+		*sweep = NULL;
+	}
+}
+
+int sweep_push(sweep_t *sweep, histogram_gn_t *hist, photon_t const *photon) {
+	size_t i;
+	size_t index;
+	size_t start;
+	size_t const mask = sweep->capacity - 1;
+	long long distance;
+	double bin;
+	double mirror;
+	long long const time = photon->t2.time;
+	unsigned int const channel = photon->t2.channel;
+	limits_t const *limits = &(hist->edges[0]->limits);
+	double const span = limits->upper - limits->lower;
+	double const bins = limits->bins;
+	unsigned long long ** const counts = hist->counts;
+	int const * const map = hist->histogram_map;
+	int histogram_index;
+	int mirror_histogram;
+
+	if ( channel >= sweep->channels || ! hist->channel_selected[channel] ) {
+		front_limit_push(&(sweep->limit), false);
+
+		/* Photons on unselected channels are simply left out. */
+		if ( channel < sweep->channels ) {
+			return(PC_SUCCESS);
+		}
+
+		error("Invalid histogram index requested for channel %u "
+				"(limit %u). Check that you have specified the correct "
+				"number of channels.\n", 
+				channel, sweep->channels);
+
+		return(PC_ERROR_INDEX);
+	}
+
+	while ( sweep->size > 0 && 
+			time - sweep->time[sweep->left] >= sweep->max_time_distance ) {
+		sweep->left = (sweep->left + 1) & mask;
+		sweep->size--;
+	}
+
+	/* The bins are found as in edges_index_linear, so that the counts match
+	 * those of the general correlator exactly. Pairs which fall outside of
+	 * the histogram are simply not counted.
+	 */
+	start = sweep->size;
+	if ( sweep->limit.limited ) {
+		if ( sweep->pushed - sweep->size >= sweep->limit.fronts ) {
+			start = 0;
+		} else if ( sweep->limit.fronts - (sweep->pushed - sweep->size) 
+				< start ) {
+			start = sweep->limit.fronts - (sweep->pushed - sweep->size);
+		}
+	}
+
+	for ( i = start; i > 0; i-- ) {
+		index = (sweep->left + i - 1) & mask;
+		distance = time - sweep->time[index];
+
+		if ( distance < sweep->min_time_distance ) {
+			continue;
+		}
+
+		histogram_index = map[sweep->channel[index]*sweep->channels + channel];
+		mirror_histogram = map[channel*sweep->channels + sweep->channel[index]];
+
+		if ( histogram_index < 0 && mirror_histogram < 0 ) {
+			continue;
+		}
+
+		bin = floor((distance - limits->lower)/span*bins);
+		mirror = floor((-distance - limits->lower)/span*bins);
+
+		if ( hist->symmetric ) {
+			/* Count the pair with the earlier photon first, and leave the
+			 * other ordering to the histogram. Mostly the mirror image 
+			 * lands in the reflected bin, and the count alone suffices. */
+			if ( bin >= 0 && bin < bins && mirror == bins - 1 - bin ) {
+				counts[histogram_index][(size_t)bin]++;
+				continue;
+			}
+
+			histogram_gn_increment_symmetric(hist, histogram_index,
+					bin >= 0 && bin < bins ? (long long)bin : -1,
+					mirror >= 0 && mirror < bins ? (long long)mirror : -1);
+			continue;
+		}
+
+		if ( histogram_index >= 0 && bin >= 0 && bin < bins ) {
+			counts[histogram_index][(size_t)bin]++;
+		}
+
+		if ( mirror_histogram >= 0 && mirror >= 0 && mirror < bins ) {
+			counts[mirror_histogram][(size_t)mirror]++;
+		}
+	}
+
+	if ( sweep->size == sweep->capacity ) {
+		warn("Queue needs to be expanded. It may be worthwhile to "
+				"perform this at the start of the calculation instead by "
+				"passing --queue-size.\n");
+
+		if ( sweep_resize(sweep, sweep->capacity*2) != PC_SUCCESS ) {
+			error("Could not resize the queue after an overflow.\n");
+			return(PC_ERROR_MEM);
+		}
+	}
+
+	index = (sweep->left + sweep->size) & (sweep->capacity - 1);
+	sweep->time[index] = time;
+	sweep->channel[index] = channel;
+	sweep->size++;
+	sweep->pushed++;
+	front_limit_push(&(sweep->limit), true);
+
+	return(PC_SUCCESS);
+}
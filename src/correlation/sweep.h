@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef CORRELATION_SWEEP_H_
+#define CORRELATION_SWEEP_H_
+
+#include <stddef.h>
+
+#include "../photon/photon.h"
+#include "../histogram/histogram_gn.h"
+#include "front_limit.h"
+
+/*
+ * A sliding window of recent t2 photons, stored as one ring of times and 
+ * one of channels, used to histogram g2 directly.
+ */
+typedef struct {
+	unsigned int channels;
+
+	long long min_time_distance;
+	long long max_time_distance;
+
+	size_t capacity;
+	size_t left;
+	size_t size;
+
+	unsigned long long pushed;
+	front_limit_t limit;
+
+	long long *time;
+	unsigned int *channel;
+} sweep_t;
+
+sweep_t *sweep_alloc(unsigned int const channels, size_t const queue_size,
+		long long const min_time_distance, long long const max_time_distance);
+void sweep_init(sweep_t *sweep);
+void sweep_set_limit(sweep_t *sweep, unsigned long long const limit);
+void sweep_free(sweep_t **sweep);
+
+int sweep_push(sweep_t *sweep, histogram_gn_t *hist, photon_t const *photon);
+
+#endif
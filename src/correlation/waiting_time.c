@@ -42,7 +42,7 @@ int waiting_time(FILE *stream_in, FILE *stream_out,
 	photon_stream_t *photons = NULL;
 	waiting_time_t *wt = NULL;
 
-	photons = photon_stream_alloc(options->mode);
+	photons = photon_stream_alloc(options->mode, options->format);
 	wt = waiting_time_alloc(options->mode);
 
 	if ( photons == NULL || wt == NULL ) {
@@ -63,10 +63,31 @@ void stream_close(FILE *stream, FILE *default_stream) {
 	}
 }
 
+/*
+ * Each program reads a single input stream, so it can share one large static
+ * buffer. Reading in large blocks keeps the number of system calls small when
+ * parsing text photons. The same holds for the main output stream, which 
+ * receives one small write per record (see output.c).
+ */
+static char stream_in_buffer[STREAM_IN_BUFFER_SIZE];
+static char stream_out_buffer[STREAM_OUT_BUFFER_SIZE];
+
 int streams_open(FILE **stream_in, char *in_filename,
 		FILE **stream_out, char *out_filename) {
-	return( stream_open(stream_in, stdin, in_filename, "r") +
-			stream_open(stream_out, stdout, out_filename, "w") );
+	int result = stream_open(stream_in, stdin, in_filename, "r") +
+			stream_open(stream_out, stdout, out_filename, "w");
+
+	if ( *stream_in != NULL ) {
+		setvbuf(*stream_in, stream_in_buffer, _IOFBF, 
+				STREAM_IN_BUFFER_SIZE);
+	}
+
+	if ( *stream_out != NULL ) {
+		setvbuf(*stream_out, stream_out_buffer, _IOFBF,
+				STREAM_OUT_BUFFER_SIZE);
+	}
+
+	return(result);
 }
 
 void streams_close(FILE *stream_in, FILE *stream_out) {
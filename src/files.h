@@ -34,6 +34,12 @@
 
 #include <stdio.h>
 
+/* Incoming data are read from the system in blocks of this size. */
+#define STREAM_IN_BUFFER_SIZE (4*1024*1024)
+
+/* Outgoing data are handed to the system in blocks of this size. */
+#define STREAM_OUT_BUFFER_SIZE (4*1024*1024)
+
 int stream_open(FILE **stream, FILE *default_stream, 
 		char *filename, char *mode);
 void stream_close(FILE *stream, FILE *default_stream);
@@ -47,7 +47,7 @@ int flid(FILE *stream_in, FILE *stream_out, pc_options_t const *options) {
 	}
 
 	if ( status == PC_SUCCESS ) {
-		photon_stream = photon_stream_alloc(MODE_T3);
+		photon_stream = photon_stream_alloc(MODE_T3, options->format);
 		flid = flid_alloc(&(options->time_limits), 
 				&(options->intensity_limits));
 
@@ -0,0 +1,79 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "error.h"
+#include "formats.h"
+
+/*
+ * Photons can be stored in several ways. The default is the comma-delimited
+ * ascii format described in the README, but for large data sets the cost of
+ * parsing the text dominates the calculation. The binary format stores the
+ * same fields as packed little-endian records, which can be read without any
+ * parsing at all. Raw PicoQuant files (ptu, pt2, pt3, ht2, ht3) can also be
+ * read directly, but not written. For archiving, the compressed format stores
+ * blocks of delta-encoded photons with an index; it is written only by 
+ * photons, but can be read by every program.
+ */
+int format_parse(int *format, char const *format_string) {
+	if ( format_string == NULL ) {
+		*format = FORMAT_TEXT;
+		return(PC_SUCCESS);
+	}
+
+	if ( ! strcmp("text", format_string) ) {
+		debug("Found format text.\n");
+		*format = FORMAT_TEXT;
+		return(PC_SUCCESS);
+	} else if ( ! strcmp("binary", format_string) ) {
+		debug("Found format binary.\n");
+		*format = FORMAT_BINARY;
+		return(PC_SUCCESS);
+	} else if ( ! strcmp("picoquant", format_string) ) {
+		debug("Found format picoquant.\n");
+		*format = FORMAT_PICOQUANT;
+		return(PC_SUCCESS);
+	} else if ( ! strcmp("compressed", format_string) ) {
+		debug("Found format compressed.\n");
+		*format = FORMAT_COMPRESSED;
+		return(PC_SUCCESS);
+	} else {
+		error("Format not recognized: %s.\n", format_string);
+		*format = FORMAT_UNKNOWN;
+		return(PC_ERROR_OPTIONS);
+	}
+}
+
+int format_writable(int const format) {
+	return( format == FORMAT_TEXT || format == FORMAT_BINARY );
+}
@@ -43,6 +43,8 @@
 #include "statistics/bin_intensity.h"
 #include "statistics/number.h"
 #include "correlation/photon_gn.h"
+#include "correlation/photon_gn_pool.h"
+#include "correlation/photon_gn_parallel.h"
 
 /* 
  * For correlation we typically need to join several operations together.
@@ -101,11 +103,19 @@ int gn_run(program_options_t *program_options, int const argc,
 
 int gn(FILE *stream_in, FILE *stream_out, pc_options_t const *options) {
 	int result = PC_SUCCESS;
+	int status;
 
 	long long photon_number = 0;
 
+	photon_t batch[PHOTON_STREAM_BATCH_SIZE];
+	size_t n_photons;
+	size_t i;
+
 	photon_stream_t *photon_stream = NULL;
 	photon_gn_t *gn = NULL;
+	photon_gn_parallel_t *parallel = NULL;
+	photon_gn_pool_t *pool = NULL;
+	photon_gn_window_t *window = NULL;
 	intensity_photon_t *count_all = NULL;
 	intensity_photon_t *intensity = NULL;
 	photon_number_t *number = NULL;
@@ -139,12 +149,25 @@ int gn(FILE *stream_in, FILE *stream_out, pc_options_t const *options) {
 		}
 	}
 
+	if ( result == PC_SUCCESS && options->time_scale != SCALE_LINEAR ) {
+		if ( options->mode != MODE_T2 || options->order != 2 ) {
+			error("Only t2 g2 can be calculated on a non-linear "
+					"time axis.\n");
+			result = PC_ERROR_OPTIONS;
+		} else if ( options->time_limits.lower <= 0 ) {
+			error("A logarithmic time axis must start above 0.\n");
+			result = PC_ERROR_OPTIONS;
+		}
+	}
+
 	if ( result == PC_SUCCESS ) {
 		debug("Allocating memory.\n");
-		photon_stream = photon_stream_alloc(options->mode);
+		photon_stream = photon_stream_alloc(options->mode, options->format);
 		gn = photon_gn_alloc(options->mode, options->order,
 				options->channels, options->queue_size,
-				&(options->time_limits), &(options->pulse_limits));
+				options->time_scale, &(options->time_limits), 
+				&(options->pulse_limits),
+				options->n_pairs, options->pairs);
 		count_all = intensity_photon_alloc(options->channels, options->mode);
 		intensity = intensity_photon_alloc(options->channels, options->mode);
 		number = photon_number_alloc(options->channels * 64);
@@ -163,6 +186,41 @@ int gn(FILE *stream_in, FILE *stream_out, pc_options_t const *options) {
 		}
 	}
 
+	if ( result == PC_SUCCESS && options->threads > 1 && 
+			options->window_width != 0 ) {
+		/* Windows are independent, so compute several at once. */
+		pool = photon_gn_pool_alloc(options->threads,
+				options->mode, options->order,
+				options->channels, options->queue_size,
+				options->time_scale, &(options->time_limits), 
+				&(options->pulse_limits),
+				options->n_pairs, options->pairs);
+
+		if ( pool == NULL ) {
+			result = PC_ERROR_MEM;
+		} else {
+			result = photon_gn_pool_start(pool);
+		}
+	} else if ( result == PC_SUCCESS && options->threads > 1 ) {
+		/* Each thread needs its own gn. The photons of each window are
+		 * collected in segments and split between them. */
+		if ( ! photon_gn_can_limit(gn) ) {
+			warn("This mode and order cannot be split between threads, "
+					"using only one.\n");
+		} else {
+			parallel = photon_gn_parallel_alloc(options->threads, 
+					options->mode, options->order,
+					options->channels, options->queue_size,
+					options->time_scale, &(options->time_limits), 
+					&(options->pulse_limits),
+					options->n_pairs, options->pairs);
+
+			if ( parallel == NULL ) {
+				result = PC_ERROR_MEM;
+			}
+		}
+	}
+
 	if ( result == PC_SUCCESS ) {
 		debug("Initializing intensity\n");
 		intensity_photon_init(count_all,
@@ -171,12 +229,21 @@ int gn(FILE *stream_in, FILE *stream_out, pc_options_t const *options) {
 				false, 0,
 				false, 0);
 
-		photon_stream_init(photon_stream, stream_in);
+		result = photon_stream_init(photon_stream, stream_in);
 
-		if ( options->window_width == 0 ) {
+		if ( options->window_width == 0 &&
+				! options->set_start && ! options->set_stop ) {
 			/* Perform a single calculation */
 			photon_stream_set_unwindowed(photon_stream);
 
+			bin_width = options->bin_width ? options->bin_width :
+					DEFAULT_BIN_WIDTH(options->mode);
+		} else if ( options->window_width == 0 ) {
+			/* A single calculation, limited to the run. */
+			photon_stream_set_bounded(photon_stream,
+					options->set_start, options->start,
+					options->set_stop, options->stop);
+
 			bin_width = options->bin_width ? options->bin_width :
 					DEFAULT_BIN_WIDTH(options->mode);
 		} else {
@@ -189,6 +256,11 @@ int gn(FILE *stream_in, FILE *stream_out, pc_options_t const *options) {
 					options->window_width;
 		}
 
+		if ( result == PC_SUCCESS && options->read_ahead &&
+				photon_stream_read_ahead(photon_stream) != PC_SUCCESS ) {
+			warn("Could not start reading ahead, continuing without.\n");
+		}
+
 		intensity_photon_init(intensity,
 				false,
 				bin_width,
@@ -289,7 +361,11 @@ int gn(FILE *stream_in, FILE *stream_out, pc_options_t const *options) {
 
 		debug("Starting the calculation.\n");
 		while ( result == PC_SUCCESS && ! photon_stream_eof(photon_stream) ) {
-			photon_gn_init(gn);
+			if ( pool != NULL ) {
+				window = photon_gn_pool_next(pool, gn_file);
+			} else {
+				photon_gn_init(gn);
+			}
 
 			if ( options->window_width == 0 ) {
 				photon_number_init(number, false, 0, false, 0);
@@ -302,27 +378,60 @@ int gn(FILE *stream_in, FILE *stream_out, pc_options_t const *options) {
 			debug("-----------Working on (%lld, %lld)-------------\n", 
 					photon_stream->window.lower,
 					photon_stream->window.upper);
-			while ( photon_stream_next_photon(photon_stream) == PC_SUCCESS ) {
-				pc_status_print("gn", photon_number++, options);
+			if ( parallel != NULL ) {
+				photon_gn_parallel_init(parallel);
+			}
+
+			do {
+				status = photon_stream_next_batch(photon_stream, 
+						batch, PHOTON_STREAM_BATCH_SIZE, &n_photons);
 
-				photon_gn_push(gn, &(photon_stream->photon));
-				intensity_photon_push(count_all, &(photon_stream->photon));
-				intensity_photon_push(intensity, &(photon_stream->photon));
+				if ( parallel != NULL ) {
+					result = photon_gn_parallel_push(parallel, gn, 
+							batch, n_photons);
 
-				while ( intensity_photon_next(intensity) == PC_SUCCESS ) {
-					intensity_photon_fprintf(intensity_file, intensity);
+					if ( result != PC_SUCCESS ) {
+						break;
+					}
+				} else if ( pool == NULL ) {
+					photon_gn_push_batch(gn, batch, n_photons);
 				}
 
-				if ( options->mode == MODE_T3 ) {
-					photon_number_push(number, &(photon_stream->photon));
+				for ( i = 0; i < n_photons; i++ ) {
+					pc_status_print("gn", photon_number++, options);
+
+					if ( pool != NULL ) {
+						result = photon_gn_window_push(window, &batch[i]);
+					}
+
+					intensity_photon_push(count_all, &batch[i]);
+					intensity_photon_push(intensity, &batch[i]);
+
+					while ( intensity_photon_next(intensity) == PC_SUCCESS ) {
+						intensity_photon_fprintf(intensity_file, intensity);
+					}
+
+					if ( options->mode == MODE_T3 ) {
+						photon_number_push(number, &batch[i]);
+					}
 				}
-			}
+			} while ( status == PC_SUCCESS );
 	
 			debug("Window over.\n");
 
-			photon_gn_flush(gn);
+			if ( pool != NULL ) {
+				if ( result == PC_SUCCESS ) {
+					photon_gn_pool_submit(pool, window,
+							photon_stream->window.lower,
+							photon_stream->window.upper);
+				}
+			} else if ( parallel == NULL ) {
+				photon_gn_flush(gn);
+			} else if ( result == PC_SUCCESS ) {
+				result = photon_gn_parallel_flush(parallel, gn);
+			}
 
-			if ( gn_file != NULL ) {
+			if ( gn_file != NULL && pool == NULL ) {
 				if ( options->window_width == 0 ) {
 					photon_gn_fprintf(gn_file, gn);
 				} else {
@@ -348,6 +457,10 @@ int gn(FILE *stream_in, FILE *stream_out, pc_options_t const *options) {
 			photon_stream_next_window(photon_stream);
 		}
 
+		if ( pool != NULL ) {
+			photon_gn_pool_flush(pool, gn_file);
+		}
+
 		number_file != NULL ? fclose(number_file) : 0;
 		gn_file != NULL ? fclose(gn_file) : 0;
 
@@ -366,6 +479,9 @@ int gn(FILE *stream_in, FILE *stream_out, pc_options_t const *options) {
 
 	photon_stream_free(&photon_stream);
 	photon_gn_free(&gn);
+	photon_gn_pool_free(&pool);
+
+	photon_gn_parallel_free(&parallel);
 	intensity_photon_free(&count_all);
 	intensity_photon_free(&intensity);
 	photon_number_free(&number);
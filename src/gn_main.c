@@ -53,10 +53,14 @@ int main(int argc, char *argv[]) {
 "    normalized correlation.\n",
 		{OPT_VERBOSE, OPT_HELP, OPT_VERSION, 
 			OPT_FILE_IN, OPT_FILE_OUT, 
+			OPT_FORMAT, OPT_READ_AHEAD, OPT_THREADS,
+			OPT_PAIRS,
 			OPT_MODE, OPT_CHANNELS, OPT_ORDER, 
 			OPT_QUEUE_SIZE, 
 			OPT_WINDOW_WIDTH,
+			OPT_START, OPT_STOP,
 			OPT_TIME, OPT_PULSE,
+			OPT_TIME_SCALE,
 			OPT_BIN_WIDTH,
 			OPT_PRINT_EVERY,
 			OPT_EOF}};
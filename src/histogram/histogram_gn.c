@@ -37,11 +37,129 @@
 #include "edges.h"
 #include "../modes.h"
 #include "../error.h"
+#include "../output.h"
+#include "../types.h"
+
+static unsigned long long **histogram_gn_counts_alloc(
+		histogram_gn_t const *hist) {
+	int i;
+	unsigned long long **counts;
+
+	counts = (unsigned long long **)malloc(
+			sizeof(unsigned long long *)*hist->n_histograms);
+
+	if ( counts == NULL ) {
+		return(counts);
+	}
+
+	for ( i = 0; i < hist->n_histograms; i++ ) {
+		counts[i] = (unsigned long long *)malloc(
+				sizeof(unsigned long long)*hist->n_bins);
+	}
+
+	for ( i = 0; i < hist->n_histograms; i++ ) {
+		if ( counts[i] == NULL ) {
+			for ( i = 0; i < hist->n_histograms; i++ ) {
+				free(counts[i]);
+			}
+
+			free(counts);
+			return(NULL);
+		}
+	}
+
+	return(counts);
+}
+
+static void histogram_gn_counts_free(unsigned long long ***counts, 
+		int const n_histograms) {
+	int i;
+
+	if ( *counts != NULL ) {
+		for ( i = 0; i < n_histograms; i++ ) {
+			free((*counts)[i]);
+		}
+
+		free(*counts);
+		*counts = NULL;
+	}
+}
+
+static void histogram_gn_counts_zero(histogram_gn_t const *hist,
+		unsigned long long **counts) {
+	int i;
+
+	for ( i = 0; i < hist->n_histograms; i++ ) {
+		memset(counts[i], 0, sizeof(unsigned long long)*hist->n_bins); 
+	}
+}
+
+static int histogram_gn_select(histogram_gn_t *hist, 
+		unsigned int const n_tuples, unsigned int const *tuples) {
+/* Number the selected tuples of channels in the order they are printed. 
+ * With no tuples given, every tuple is selected.
+ */
+	int i;
+	unsigned int j;
+	int index;
+
+	hist->n_combinations = pow_int(hist->channels, hist->order);
+	hist->histogram_map = (int *)malloc(sizeof(int)*hist->n_combinations);
+	hist->histogram_combination = (int *)malloc(
+			sizeof(int)*hist->n_combinations);
+	hist->channel_selected = (int *)malloc(sizeof(int)*hist->channels);
+
+	if ( hist->histogram_map == NULL || 
+			hist->histogram_combination == NULL ||
+			hist->channel_selected == NULL ) {
+		return(PC_ERROR_MEM);
+	}
+
+	for ( i = 0; i < hist->n_combinations; i++ ) {
+		hist->histogram_map[i] = ( tuples == NULL );
+	}
+
+	for ( i = 0; i < hist->channels; i++ ) {
+		hist->channel_selected[i] = ( tuples == NULL );
+	}
+
+	for ( j = 0; tuples != NULL && j < n_tuples; j++ ) {
+		index = 0;
+
+		for ( i = 0; i < hist->order; i++ ) {
+			index = index*hist->channels + tuples[j*hist->order + i];
+			hist->channel_selected[tuples[j*hist->order + i]] = true;
+		}
+
+		if ( hist->histogram_map[index] ) {
+			warn("Duplicate selection of channel tuple %u.\n", j);
+		}
+
+		hist->histogram_map[index] = true;
+	}
+
+	hist->n_histograms = 0;
+
+	for ( i = 0; i < hist->n_combinations; i++ ) {
+		if ( hist->histogram_map[i] ) {
+			hist->histogram_combination[hist->n_histograms] = i;
+			hist->histogram_map[i] = hist->n_histograms++;
+		} else {
+			hist->histogram_map[i] = -1;
+		}
+	}
+
+	debug("Selected %d of %d histograms.\n", 
+			hist->n_histograms, hist->n_combinations);
+
+	return(PC_SUCCESS);
+}
 
 histogram_gn_t *histogram_gn_alloc(int const mode, unsigned int const order,
 		unsigned int const channels, 
 		int const time_scale, limits_t const *time_limits,
-		int const pulse_scale, limits_t const *pulse_limits) {
+		int const pulse_scale, limits_t const *pulse_limits,
+		unsigned int const n_tuples, unsigned int const *tuples) {
 	int i;
 	histogram_gn_t *hist = NULL;
 
@@ -55,6 +173,13 @@ histogram_gn_t *histogram_gn_alloc(int const mode, unsigned int const order,
 	hist->order = order;
 	hist->mode = mode;
 
+	hist->counts = NULL;
+	hist->histogram_map = NULL;
+	hist->histogram_combination = NULL;
+	hist->channel_selected = NULL;
+	hist->symmetric = false;
+	hist->direct = NULL;
+
 	hist->time_scale = time_scale;
 	hist->pulse_scale = pulse_scale;
 
@@ -153,10 +278,13 @@ histogram_gn_t *histogram_gn_alloc(int const mode, unsigned int const order,
 	}
 
 	debug("Histogram has %zu bins.\n", hist->n_bins);
-	hist->n_histograms = pow_int(hist->channels, hist->order);
+	if ( histogram_gn_select(hist, n_tuples, tuples) != PC_SUCCESS ) {
+		error("Could not allocate the histogram map.\n");
+		histogram_gn_free(&hist);
+		return(hist);
+	}
 
-	hist->counts = (unsigned long long **)malloc(
-			sizeof(unsigned long long *)*hist->n_histograms);
+	hist->counts = histogram_gn_counts_alloc(hist);
 
 	if ( hist->counts == NULL ) {
 		error("Could not allocate histogram bins.\n");
@@ -164,16 +292,6 @@ histogram_gn_t *histogram_gn_alloc(int const mode, unsigned int const order,
 		return(hist);
 	}
 
-	for ( i = 0; i < hist->n_histograms; i++ ) {
-		hist->counts[i] = (unsigned long long *)malloc(
-				sizeof(unsigned long long)*hist->n_bins);
-		if ( hist->counts[i] == NULL ) {
-			error("Could not allocate histogram bins.\n");
-			histogram_gn_free(&hist);
-			return(hist);
-		}
-	}
-
 	hist->channels_vector = combination_alloc(hist->order, hist->channels);
 	hist->values_vector = values_vector_alloc(hist->dimensions);
 
@@ -194,13 +312,13 @@ histogram_gn_t *histogram_gn_alloc(int const mode, unsigned int const order,
 }
 
 void histogram_gn_init(histogram_gn_t *hist) {
-	int i;
-
 	values_vector_init(hist->values_vector);
 	combination_init(hist->channels_vector);
 
-	for ( i = 0; i < hist->n_histograms; i++ ) {
-		memset(hist->counts[i], 0, sizeof(unsigned long long)*hist->n_bins); 
+	histogram_gn_counts_zero(hist, hist->counts);
+
+	if ( hist->symmetric ) {
+		histogram_gn_counts_zero(hist, hist->direct);
 	}
 }
 
@@ -212,13 +330,11 @@ void histogram_gn_free(histogram_gn_t **hist) {
 		values_vector_free(&((*hist)->values_vector));
 		edge_indices_free(&((*hist)->edge_indices));
 
-		if ( (*hist)->counts != NULL ) {
-			for ( i = 0; i < (*hist)->n_histograms; i++ ) {
-				free((*hist)->counts[i]);
-			}
-	
-			free((*hist)->counts);
-		} 
+		histogram_gn_counts_free(&((*hist)->counts), (*hist)->n_histograms);
+		histogram_gn_counts_free(&((*hist)->direct), (*hist)->n_histograms);
+		free((*hist)->histogram_map);
+		free((*hist)->histogram_combination);
+		free((*hist)->channel_selected);
 
 		if ( (*hist)->edges != NULL ) {
 			for ( i = 0; i < (*hist)->dimensions; i++ ) {
@@ -233,11 +349,93 @@ void histogram_gn_free(histogram_gn_t **hist) {
 	}
 }
 
+int histogram_gn_can_mirror(histogram_gn_t const *hist) {
+/* Swapping the photons of a second-order correlation negates all of its 
+ * values, so when the bins are linear and symmetric about zero the counts 
+ * of one ordering determine those of the other. At higher orders the 
+ * permuted values are differences of the original ones, which cannot be
+ * recovered from the binned counts.
+ */
+	int i;
+
+	if ( hist->order != 2 ) {
+		return(false);
+	}
+
+	/* The mirror image of each histogram must be kept as well. */
+	for ( i = 0; i < hist->n_histograms; i++ ) {
+		if ( histogram_gn_mirror_histogram(hist, i) < 0 ) {
+			return(false);
+		}
+	}
+
+	for ( i = 0; i < hist->dimensions; i++ ) {
+		if ( hist->edges[i]->scale != SCALE_LINEAR ||
+				hist->edges[i]->limits.upper <= 0 ||
+				hist->edges[i]->limits.lower != -hist->edges[i]->limits.upper ) {
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+int histogram_gn_set_symmetric(histogram_gn_t *hist) {
+/* Count only one ordering of each pair from now on, and rebuild the other
+ * when the counts are read. 
+ */
+	if ( ! histogram_gn_can_mirror(hist) ) {
+		error("Histogram cannot be made symmetric.\n");
+		return(PC_ERROR_OPTIONS);
+	}
+
+	hist->direct = histogram_gn_counts_alloc(hist);
+
+	if ( hist->direct == NULL ) {
+		error("Could not allocate histogram bins.\n");
+		return(PC_ERROR_MEM);
+	}
+
+	hist->symmetric = true;
+	histogram_gn_counts_zero(hist, hist->direct);
+
+	return(PC_SUCCESS);
+}
+
+int histogram_gn_mirror_histogram(histogram_gn_t const *hist,
+		int const histogram_index) {
+/* The histogram of the pair with its channels swapped. */
+	int const index = hist->histogram_combination[histogram_index];
+
+	return(hist->histogram_map[(index % hist->channels)*hist->channels + 
+			index/hist->channels]);
+}
+
+static void histogram_gn_bin_error(histogram_gn_t const *hist, 
+		long long const bin_index) {
+	int i;
+
+	error("Invalid bin index requested: %lld (limit %zu). "
+			"Check that the limits given are valid.\n",
+			bin_index, hist->n_bins);
+	fprintf(stderr, "Values vector which caused the invalid bin: (");
+	for ( i = 0; i < hist->values_vector->length; i++ ) {
+		fprintf(stderr, "%lld", hist->values_vector->values[i]);
+		if ( i+1 != hist->values_vector->length ) {
+			fprintf(stderr, ", ");
+		}
+	}
+
+	fprintf(stderr, ")\n");
+	fflush(stderr);
+}
+
 int histogram_gn_increment(histogram_gn_t *hist, 
 		correlation_t const *correlation) {
 	int i;
 	int histogram_index;
 	int bin_index;
+	long long mirror_index;
 
 	if ( correlation->order != hist->order ) {
 		error("Order of correlation does not match histogram: %d vs. %d\n",
@@ -248,33 +446,44 @@ int histogram_gn_increment(histogram_gn_t *hist,
 	hist->build_values(correlation, hist->values_vector);
 
 	histogram_index = combination_index(hist->channels_vector);
-	bin_index = values_vector_index(hist->values_vector, hist->edges);
 
-	if ( histogram_index < 0 || histogram_index >= hist->n_histograms ) {
+	if ( histogram_index < 0 || histogram_index >= hist->n_combinations ) {
 		error("Invalid histogram index requested: %d (limit %d). "
 				"Check that you have specified the correct number of "
 				"channels.\nFailed for channels:\n", 
-				histogram_index, hist->n_histograms);
+				histogram_index, hist->n_combinations);
 		combination_fprintf(stderr, hist->channels_vector);
 		return(PC_ERROR_INDEX);
 	}
 
+	histogram_index = hist->histogram_map[histogram_index];
+
+	if ( histogram_index < 0 ) {
+		return(PC_SUCCESS);
+	}
+
+	bin_index = values_vector_index(hist->values_vector, hist->edges);
+
 	if ( bin_index < 0 || bin_index >= hist->n_bins ) {
-		error("Invalid bin index requested: %d (limit %d). "
-				"Check that the limits given are valid.\n",
-				bin_index, hist->n_bins);
-		fprintf(stderr, "Values vector which caused the invalid bin: (");
+		histogram_gn_bin_error(hist, bin_index);
+		return(PC_ERROR_INDEX);
+	}
+
+	if ( hist->symmetric ) {
+		/* Find the bin of the other ordering, as if it had been given. */
 		for ( i = 0; i < hist->values_vector->length; i++ ) {
-			fprintf(stderr, "%lld", hist->values_vector->values[i]);
-			if ( i+1 != hist->values_vector->length ) {
-				fprintf(stderr, ", ");
-			}
+			hist->values_vector->values[i] = -hist->values_vector->values[i];
 		}
 
-		fprintf(stderr, ")\n");
-		fflush(stderr);
+		mirror_index = values_vector_index(hist->values_vector, hist->edges);
 
-		return(PC_ERROR_INDEX);
+		if ( mirror_index < 0 || mirror_index >= hist->n_bins ) {
+			histogram_gn_bin_error(hist, mirror_index);
+			return(PC_ERROR_INDEX);
+		}
+
+		return(histogram_gn_increment_symmetric(hist, histogram_index, 
+				bin_index, mirror_index));
 	}
 
 	debug("Incrementing histogram %d, bin %d\n", histogram_index, bin_index);
@@ -283,12 +492,44 @@ int histogram_gn_increment(histogram_gn_t *hist,
 	return(PC_SUCCESS);
 }
 
+int histogram_gn_increment_symmetric(histogram_gn_t *hist,
+		int const histogram_index, long long const bin_index, 
+		long long const mirror_index) {
+/* Count a pair given in its canonical ordering, along with the bin its 
+ * mirror image falls in. Usually that is the reflection of the bin of the
+ * pair, and the one count stands for both orderings. Values on a bin edge 
+ * reflect onto the neighboring bin instead, so those pairs are counted 
+ * directly in both orderings. Either index may be out of range, in which 
+ * case that ordering is not counted.
+ */
+	long long const n_bins = hist->n_bins;
+	int const valid = bin_index >= 0 && bin_index < n_bins;
+	int const mirror_valid = mirror_index >= 0 && mirror_index < n_bins;
+
+	if ( valid && mirror_valid && mirror_index == n_bins - 1 - bin_index ) {
+		hist->counts[histogram_index][bin_index]++;
+		return(PC_SUCCESS);
+	}
+
+	if ( valid ) {
+		hist->direct[histogram_index][bin_index]++;
+	}
+
+	if ( mirror_valid ) {
+		hist->direct[histogram_gn_mirror_histogram(hist, histogram_index)][
+				mirror_index]++;
+	}
+
+	return(PC_SUCCESS);
+}
+
 /* Combine the counts from one histogram with another. */
 int histogram_gn_update(histogram_gn_t *dst, histogram_gn_t const *src) {
 	size_t i, j;
 
 	if ( src->n_histograms != dst->n_histograms ||
-			src->n_bins != dst->n_bins ) {
+			src->n_bins != dst->n_bins || 
+			src->symmetric != dst->symmetric ) {
 		error("Attempting to add two histograms of unequal size.\n");
 		return(PC_ERROR_INDEX);
 	}
@@ -297,10 +538,27 @@ int histogram_gn_update(histogram_gn_t *dst, histogram_gn_t const *src) {
 		for ( j = 0; j < dst->n_bins; j++ ) {
 			dst->counts[i][j] += src->counts[i][j];
 		}
+
+		for ( j = 0; dst->symmetric && j < dst->n_bins; j++ ) {
+			dst->direct[i][j] += src->direct[i][j];
+		}
 	}
 
 	return(PC_SUCCESS);
 }
+
+unsigned long long histogram_gn_count(histogram_gn_t const *hist,
+		int const histogram_index, size_t const bin_index) {
+/* The count of a bin, with the mirrored ordering rebuilt in symmetric mode. */
+	if ( ! hist->symmetric ) {
+		return(hist->counts[histogram_index][bin_index]);
+	}
+
+	return(hist->counts[histogram_index][bin_index] + 
+			hist->counts[histogram_gn_mirror_histogram(hist, histogram_index)][
+				hist->n_bins - 1 - bin_index] +
+			hist->direct[histogram_index][bin_index]);
+}
 			
 int histogram_gn_fprintf(FILE *stream_out, histogram_gn_t *hist) {
 /* Cycle through the combinations of channels, and for each combination
@@ -310,16 +568,18 @@ int histogram_gn_fprintf(FILE *stream_out, histogram_gn_t *hist) {
 	int histogram_index;
 	int channel_index;
 	int bin_index;
+	output_t output;
 
+	output_init(&output, stream_out);
 	combination_init(hist->channels_vector);
 	
 	while ( combination_next(hist->channels_vector) == PC_SUCCESS ) {
 		bin_index = -1;
-		histogram_index = combination_index(hist->channels_vector);
+		histogram_index = hist->histogram_map[
+				combination_index(hist->channels_vector)];
 
-		if ( histogram_index >= hist->n_histograms ) {
-			error("Trying to print a histogram which does not exist.\n");
-			return(PC_ERROR_INDEX);
+		if ( histogram_index < 0 ) {
+			continue;
 		}
 
 		edge_indices_init(hist->edge_indices, hist->edges);
@@ -337,28 +597,42 @@ int histogram_gn_fprintf(FILE *stream_out, histogram_gn_t *hist) {
 
 			channel_index = 0;
 
-			fprintf(stream_out, "%u", 
-					hist->channels_vector->values[channel_index++]);
+			if ( output_unsigned(&output, 
+					hist->channels_vector->values[channel_index++]) 
+					!= PC_SUCCESS ) {
+				return(PC_ERROR_IO);
+			}
 
 			for ( i = 0; i < hist->dimensions; i++ ) {
-				if ( hist->edges[i]->print_label ) {
-					fprintf(stream_out, ",%u",
-							hist->channels_vector->values[channel_index++]);
+				if ( hist->edges[i]->print_label && 
+						( output_char(&output, ',') != PC_SUCCESS ||
+						  output_unsigned(&output,
+							hist->channels_vector->values[channel_index++])
+							!= PC_SUCCESS ) ) {
+					return(PC_ERROR_IO);
 				}
 
-				fprintf(stream_out, ",%.2lf,%.2lf",
-						hist->edges[i]->bin_edges[
-							hist->edge_indices->values[i]],
-						hist->edges[i]->bin_edges[
-							hist->edge_indices->values[i]+1]);
+				if ( output_char(&output, ',') != PC_SUCCESS ||
+						output_double(&output, hist->edges[i]->bin_edges[
+							hist->edge_indices->values[i]]) != PC_SUCCESS ||
+						output_char(&output, ',') != PC_SUCCESS ||
+						output_double(&output, hist->edges[i]->bin_edges[
+							hist->edge_indices->values[i]+1]) 
+							!= PC_SUCCESS ) {
+					return(PC_ERROR_IO);
+				}
 			}
 
-			fprintf(stream_out, ",%llu\n",
-					hist->counts[histogram_index][bin_index]);
+			if ( output_char(&output, ',') != PC_SUCCESS ||
+					output_unsigned(&output, histogram_gn_count(hist, 
+						histogram_index, bin_index)) != PC_SUCCESS ||
+					output_char(&output, '\n') != PC_SUCCESS ) {
+				return(PC_ERROR_IO);
+			}
 		}
 	}
 
-	return(PC_SUCCESS);
+	return(output_flush(&output));
 }
 
 int histogram_gn_fprintf_bins(FILE *stream_out, histogram_gn_t const *hist,
@@ -379,6 +653,11 @@ int histogram_gn_fprintf_bins(FILE *stream_out, histogram_gn_t const *hist,
 	
 	j = 0;
 	while ( combination_next(hist->channels_vector) == PC_SUCCESS ) {
+		if ( hist->histogram_map[
+				combination_index(hist->channels_vector)] < 0 ) {
+			continue;
+		}
+
 		/* Since we do not have a way to check that there is another correlation
 		   after this one, only print a comma at the beginning of a correlation.
 		   This means we need to keep track of _not_ being the first 
@@ -419,6 +698,11 @@ int histogram_gn_fprintf_bins(FILE *stream_out, histogram_gn_t const *hist,
 	
 			j = 0;
 			while ( combination_next(hist->channels_vector) == PC_SUCCESS ) {
+				if ( hist->histogram_map[
+						combination_index(hist->channels_vector)] < 0 ) {
+					continue;
+				}
+
 				if ( j++ != 0 ) {
 					fprintf(stream_out, ",");
 				}
@@ -504,7 +788,7 @@ int histogram_gn_fprintf_counts(FILE *stream_out, histogram_gn_t const *hist) {
 			histogram_index++ ) {
 		for ( bin_index = 0; bin_index < hist->n_bins; bin_index++ ) {
 			fprintf(stream_out, "%llu",
-					hist->counts[histogram_index][bin_index]);
+					histogram_gn_count(hist, histogram_index, bin_index));
 			if ( ! ( histogram_index+1 == hist->n_histograms && 
 						bin_index+1 == hist->n_bins) ) {
 				fprintf(stream_out, ",");
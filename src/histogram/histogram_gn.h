@@ -47,6 +47,15 @@ typedef struct _histogram_gn_t {
 	size_t n_bins;
 	int n_histograms;
 
+	/* Only the histograms of the selected channel tuples are kept. The map
+	 * takes the index of a tuple among all of them (as combination_index)
+	 * to its histogram, or -1 if it was not selected.
+	 */
+	int n_combinations;
+	int *histogram_map;
+	int *histogram_combination;
+	int *channel_selected;
+
 	int time_scale;
 	int pulse_scale;
 
@@ -54,6 +63,15 @@ typedef struct _histogram_gn_t {
 
 	unsigned long long **counts;
 
+	/* In symmetric mode, counts holds each pair of second order once, in 
+	 * its canonical ordering, and the other ordering is rebuilt from the 
+	 * reflected bin of the mirrored histogram when the counts are read. A
+	 * pair whose mirror image does not land in the reflected bin, as for 
+	 * values on a bin edge, is counted in both orderings in direct instead.
+	 */
+	int symmetric;
+	unsigned long long **direct;
+
 	combination_t *channels_vector;
 	values_vector_t *values_vector;
 	edge_indices_t *edge_indices;
@@ -68,13 +86,24 @@ typedef struct _histogram_gn_t {
 histogram_gn_t *histogram_gn_alloc(int const mode, unsigned int const order,
 		unsigned int const channels,
 		int const time_scale, limits_t const *time_limits,
-		int const pulse_scale, limits_t const *pulse_limits);
+		int const pulse_scale, limits_t const *pulse_limits,
+		unsigned int const n_tuples, unsigned int const *tuples);
 void histogram_gn_init(histogram_gn_t *hist);
 void histogram_gn_free(histogram_gn_t **hist);
 
+int histogram_gn_can_mirror(histogram_gn_t const *hist);
+int histogram_gn_set_symmetric(histogram_gn_t *hist);
+int histogram_gn_mirror_histogram(histogram_gn_t const *hist,
+		int const histogram_index);
+
 int histogram_gn_increment(histogram_gn_t *hist, 
 		correlation_t const *correlation);
+int histogram_gn_increment_symmetric(histogram_gn_t *hist,
+		int const histogram_index, long long const bin_index, 
+		long long const mirror_index);
 int histogram_gn_update(histogram_gn_t *dst, histogram_gn_t const *src);
+unsigned long long histogram_gn_count(histogram_gn_t const *hist,
+		int const histogram_index, size_t const bin_index);
 
 int histogram_gn_fprintf(FILE *stream_out, histogram_gn_t *hist);
 int histogram_gn_fprintf_bins(FILE *stream_out, histogram_gn_t const *hist,
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+
+#include "lifetime.h"
+#include "../error.h"
+#include "../types.h"
+
+/*
+ * A first-order t3 histogram needs only the channel and arrival time of 
+ * each photon, so rather than passing through the correlator queue and the
+ * values vector, each photon is binned as it arrives. The bins are found
+ * as in edges_index_linear, so that the counts match those of the general
+ * path, but for bins of whole picoseconds the floating-point division is 
+ * only needed for photons exactly on a bin edge. Photons outside the 
+ * histogram are skipped silently.
+ */
+lifetime_t *lifetime_alloc(limits_t const *limits, 
+		long long const min_time_distance, long long const max_time_distance) {
+	lifetime_t *lifetime = NULL;
+	long long span;
+
+	lifetime = (lifetime_t *)malloc(sizeof(lifetime_t));
+
+	if ( lifetime == NULL ) {
+		return(lifetime);
+	}
+
+	memcpy(&(lifetime->limits), limits, sizeof(limits_t));
+	lifetime->min_time_distance = min_time_distance;
+	lifetime->max_time_distance = max_time_distance;
+
+	span = (long long)(limits->upper - limits->lower);
+	lifetime->lower = (long long)limits->lower;
+	lifetime->integer = limits->bins > 0 && span > 0 &&
+			lifetime->lower == limits->lower &&
+			(double)span == limits->upper - limits->lower &&
+			span % (long long)limits->bins == 0;
+	lifetime->width = lifetime->integer ? span/(long long)limits->bins : 0;
+
+	debug("Lifetime bins are %s.\n", 
+			lifetime->integer ? "integers" : "not integers");
+
+	lifetime_init(lifetime);
+
+	return(lifetime);
+}
+
+void lifetime_init(lifetime_t *lifetime) {
+	front_limit_init(&(lifetime->limit));
+}
+
+void lifetime_set_limit(lifetime_t *lifetime, unsigned long long const limit) {
+/* Only count the first limit photons pushed since the last init. */
+	front_limit_set(&(lifetime->limit), limit);
+}
+
+void lifetime_free(lifetime_t **lifetime) {
+	if ( *lifetime != NULL ) {
+		free(*lifetime);
+		*lifetime = NULL;
+	}
+}
+
+int lifetime_push(lifetime_t *lifetime, histogram_gn_t *hist, 
+		photon_t const *photon) {
+	return(lifetime_push_batch(lifetime, hist, photon, 1));
+}
+
+int lifetime_push_batch(lifetime_t *lifetime, histogram_gn_t *hist,
+		photon_t const *photons, size_t const n_photons) {
+	size_t i;
+	long long time;
+	long long offset;
+	long long index;
+	unsigned int channel;
+	limits_t const *limits = &(lifetime->limits);
+	double const span = limits->upper - limits->lower;
+	double const bins = limits->bins;
+	long long const n_bins = hist->n_bins;
+	long long const min_time_distance = lifetime->min_time_distance;
+	long long const max_time_distance = lifetime->max_time_distance;
+	int result = PC_SUCCESS;
+
+	for ( i = 0; i < n_photons; i++ ) {
+		channel = photons[i].t3.channel;
+		time = photons[i].t3.time;
+
+		if ( channel >= hist->channels ) {
+			error("Invalid histogram index requested for channel %u "
+					"(limit %u). Check that you have specified the correct "
+					"number of channels.\n", 
+					channel, hist->channels);
+			front_limit_push(&(lifetime->limit), false);
+			result = PC_ERROR_INDEX;
+			continue;
+		}
+
+		if ( ! front_limit_push(&(lifetime->limit), true) ) {
+			continue;
+		}
+
+		if ( ! hist->channel_selected[channel] ||
+				( min_time_distance != 0 && 
+					llabs(time) < min_time_distance ) ||
+				( max_time_distance != 0 &&
+					llabs(time) >= max_time_distance ) ) {
+			continue;
+		}
+
+		if ( lifetime->integer ) {
+			offset = time - lifetime->lower;
+
+			if ( offset < 0 ) {
+				continue;
+			}
+
+			index = offset/lifetime->width;
+
+			/* On a bin edge the floating-point form may round down to the 
+			 * bin below, so use it there to get the same answer. */
+			if ( offset % lifetime->width == 0 ) {
+				index = (int)floor((time - limits->lower)/span*bins);
+			}
+		} else {
+			index = (int)floor((time - limits->lower)/span*bins);
+		}
+
+		if ( index >= 0 && index < n_bins ) {
+			hist->counts[hist->histogram_map[channel]][index]++;
+		}
+	}
+
+	return(result);
+}
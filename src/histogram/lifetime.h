@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef HISTOGRAM_LIFETIME_H_
+#define HISTOGRAM_LIFETIME_H_
+
+#include <stddef.h>
+
+#include "../limits.h"
+#include "../photon/photon.h"
+#include "histogram_gn.h"
+#include "../correlation/front_limit.h"
+
+/*
+ * Histograms the arrival times of t3 photons after their sync pulses, the 
+ * first-order t3 correlation. Nothing needs to be queued, so the photons
+ * go straight into the counts of a histogram_gn_t.
+ */
+typedef struct {
+	limits_t limits;
+
+	long long min_time_distance;
+	long long max_time_distance;
+
+	/* When the bins are a whole number of picoseconds wide, they are
+	 * found by integer division. */
+	int integer;
+	long long lower;
+	long long width;
+
+	front_limit_t limit;
+} lifetime_t;
+
+lifetime_t *lifetime_alloc(limits_t const *limits, 
+		long long const min_time_distance, long long const max_time_distance);
+void lifetime_init(lifetime_t *lifetime);
+void lifetime_set_limit(lifetime_t *lifetime, unsigned long long const limit);
+void lifetime_free(lifetime_t **lifetime);
+
+int lifetime_push(lifetime_t *lifetime, histogram_gn_t *hist, 
+		photon_t const *photon);
+int lifetime_push_batch(lifetime_t *lifetime, histogram_gn_t *hist,
+		photon_t const *photons, size_t const n_photons);
+
+#endif
@@ -100,7 +100,8 @@ int histogram_photon(FILE *stream_in, FILE *stream_out,
 	hist = histogram_gn_alloc(options->mode, options->order,
 			options->channels, 
 			options->time_scale, &(options->time_limits),
-			options->pulse_scale, &(options->pulse_limits));
+			options->pulse_scale, &(options->pulse_limits),
+			0, NULL);
 	correlation = correlation_alloc(options->mode, options->order);
 
 	if ( hist == NULL || correlation == NULL ) {
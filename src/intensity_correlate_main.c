@@ -62,9 +62,15 @@ int main(int argc, char *argv[]) {
 "\n"
 "For all correlators, the output is the same as photon_histogram:\n"
 "      (channel 0, channel 1, bin left, bin right, counts)\n"
-"except that counts are calculated as double-precision floats.",
+"except that counts are calculated as double-precision floats.\n"
+"\n"
+"For order 3, each level correlates the newest value of channel 0 with\n"
+"channels 1 and 2 at every pair of delays held in its registers, and\n"
+"each row of the output gives the bins of both delays:\n"
+"      (channel 0, channel 1, channel 2, bin 1 left, bin 1 right,\n"
+"       bin 2 left, bin 2 right, counts)",
 		{OPT_VERBOSE, OPT_HELP, OPT_VERSION,
-			OPT_FILE_IN, OPT_FILE_OUT,
+			OPT_FILE_IN, OPT_FILE_OUT, OPT_THREADS,
 			OPT_CHANNELS, OPT_ORDER,
 			OPT_TIME_SCALE,
 			OPT_BINNING, OPT_REGISTERS, OPT_DEPTH,
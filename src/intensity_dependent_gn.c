@@ -47,7 +47,7 @@ int intensity_dependent_gn(FILE *stream_in, FILE *stream_out,
 		return(PC_ERROR_OPTIONS);
 	}
 
-	photons = photon_stream_alloc(options->mode);
+	photons = photon_stream_alloc(options->mode, options->format);
 	idgn = idgn_alloc(options->mode, options->order, options->channels,
 			options->queue_size,
 			&(options->time_limits), &(options->pulse_limits),
@@ -121,7 +121,7 @@ idgn_t *idgn_alloc(int const mode, int const order, int const channels,
 			for ( i = 0; idgn != NULL && i < idgn->intensity_bins; i++ ) {
 				idgn->gns[i] = photon_gn_alloc(mode, order,
 						channels, queue_size,
-						time_limits, pulse_limits);
+						SCALE_LINEAR, time_limits, pulse_limits, 0, NULL);
 
 				if ( idgn->gns[i] == NULL ) {
 					idgn_free(&idgn);
@@ -55,6 +55,7 @@ int main(int argc, char *argv[]) {
 		{OPT_HELP, OPT_VERBOSE, OPT_VERSION,
 			OPT_PRINT_EVERY,
 			OPT_FILE_IN, OPT_FILE_OUT,
+			OPT_FORMAT,
 			OPT_START, OPT_STOP,
 			OPT_MODE, OPT_CHANNELS,
 			OPT_BIN_WIDTH, OPT_COUNT_ALL,
@@ -62,6 +62,7 @@ int main(int argc, char *argv[]) {
 "whether the kinetics are successive or parallel.",
 		{OPT_VERBOSE, OPT_HELP, OPT_VERSION,
 			OPT_FILE_IN, OPT_FILE_OUT,
+			OPT_FORMAT, OPT_FORMAT_OUT,
 			OPT_QUEUE_SIZE, 
 			OPT_CORRELATE_SUCCESSIVE,
 			OPT_EOF}};
@@ -41,6 +41,7 @@
 #include "files.h"
 #include "limits.h"
 #include "modes.h"
+#include "formats.h"
 
 /* 
  * Since there are many small programs which comprise this package, and many
@@ -55,9 +56,9 @@
 
 /*
 Currently used:
-aAbBcCdDeEfFgGhHiIjJkKmMnNoOpPRsSqQuUvVwWxXyYzZ
+aAbBcCdDeEfFgGhHiIjJkKlLmMnNoOpPqQrRsStTuUvVwWxXyYzZ
 Remaining:
-lLqQrtT
+
 */
 
 static pc_option_t pc_options_all[] = {
@@ -242,6 +243,31 @@ static pc_option_t pc_options_all[] = {
 			"considered for calculation."},
 	{'N', "N:", "time-threshold",
 			"The time dividing early and late arrivals, in ps."},
+	{'t', "t:", "format",
+			"The format of the incoming photons, one of:\n"
+			"      text: comma-delimited ascii (default)\n"
+			"    binary: packed little-endian records\n"
+			" picoquant: raw ptu, pt2, pt3, ht2 or ht3 file\n"
+			"            (input only)\n"
+			"compressed: delta-encoded blocks, for archiving\n"
+			"            (written only by photons)"},
+	{'T', "T:", "format-out",
+			"The format of the outgoing photons, as for\n"
+			"--format. By default, this is the same as the\n"
+			"format of the incoming photons."},
+	{'r', "r", "read-ahead",
+			"Read and decode the incoming photons in a\n"
+			"separate thread, so that reading overlaps with\n"
+			"the calculation."},
+	{'l', "l:", "threads",
+			"The number of threads to split the calculation\n"
+			"over. By default, this is 1."},
+	{'L', "L:", "pairs",
+			"Only calculate the correlations between the given\n"
+			"channels, as a semicolon-delimited list of tuples\n"
+			"of comma-delimited channels, one per order of\n"
+			"the correlation (e.g. \"0,1;1,0\" for g2). Photons\n"
+			"on channels in none of the tuples are dropped."},
 	};
 
 
@@ -255,6 +281,11 @@ static struct option pc_options_long[] = {
 	{"file-out", required_argument, 0, 'o'},
 
 	{"mode", required_argument, 0, 'm'},
+	{"format", required_argument, 0, 't'},
+	{"format-out", required_argument, 0, 'T'},
+	{"read-ahead", no_argument, 0, 'r'},
+	{"threads", required_argument, 0, 'l'},
+	{"pairs", required_argument, 0, 'L'},
 	{"channels", required_argument, 0, 'c'},
 	{"order", required_argument, 0, 'g'},
 
@@ -344,6 +375,8 @@ void pc_options_free(pc_options_t **options) {
 		free((*options)->filename_in);
 		free((*options)->filename_out);
 		free((*options)->mode_string);
+		free((*options)->format_string);
+		free((*options)->format_out_string);
 		free((*options)->time_string);
 		free((*options)->pulse_string);
 		free((*options)->time_scale_string);
@@ -353,6 +386,8 @@ void pc_options_free(pc_options_t **options) {
 		free((*options)->pulse_offsets_string);
 		free((*options)->pulse_offsets);
 		free((*options)->convert_string);
+		free((*options)->pairs_string);
+		free((*options)->pairs);
 		free(*options);
 		*options = NULL;
 	}
@@ -369,6 +404,13 @@ void pc_options_default(pc_options_t *options) {
 	options->mode_string = NULL;
 	options->mode = MODE_UNKNOWN;
 
+	options->format_string = NULL;
+	options->format = FORMAT_TEXT;
+	options->format_out_string = NULL;
+	options->format_out = FORMAT_TEXT;
+	options->read_ahead = false;
+	options->threads = 1;
+
 	options->channels = 2;
 	options->order = 2;
 	
@@ -423,6 +465,11 @@ void pc_options_default(pc_options_t *options) {
 
 	options->exact_normalization = false;
 
+	options->select_pairs = false;
+	options->pairs_string = NULL;
+	options->n_pairs = 0;
+	options->pairs = NULL;
+
 	options->repetition_rate = 0;
 	options->time_origin = 0;
 	options->convert_string = NULL;
@@ -456,6 +503,13 @@ int pc_options_valid(pc_options_t const *options) {
 		return(false);
 	}
 
+	if ( pc_options_has_option(options, OPT_THREADS) 
+			&& options->threads < 1 ) {
+		error("Must have at least 1 thread (%u specified).\n", 
+				options->threads);
+		return(false);
+	}
+
 	if ( pc_options_has_option(options, OPT_ORDER) && options->order < 1 ) {
 		error("Order of correlation/histogram must be at least 1 (%d "
 				"specified).", options->order);
@@ -468,6 +522,14 @@ int pc_options_valid(pc_options_t const *options) {
 		return(false);
 	}
 
+	if ( pc_options_has_option(options, OPT_FORMAT) &&
+			(options->format == FORMAT_UNKNOWN ||
+			 options->format_out == FORMAT_UNKNOWN) ) {
+		error("Invalid format: %d (out: %d)\n", 
+				options->format, options->format_out);
+		return(false);
+	}
+
 	if ( pc_options_has_option(options, OPT_TIME_SCALE) &&
 			options->time_scale == SCALE_UNKNOWN ) {
 		error("Unknown time scale.\n");
@@ -481,6 +543,7 @@ int pc_options_valid(pc_options_t const *options) {
 	}
 
 	if ( pc_options_has_option(options, OPT_TIME) &&
+			pc_options_requires_time_limits(options) &&
 			! limits_valid(&(options->time_limits)) ) {
 		error("Invalid time limits.\n");
 		return(false);
@@ -563,6 +626,12 @@ int pc_options_parse(pc_options_t *options,
 			case 'm':
 				options->mode_string = strdup(optarg);
 				break;
+			case 't':
+				options->format_string = strdup(optarg);
+				break;
+			case 'T':
+				options->format_out_string = strdup(optarg);
+				break;
 			case 'c':
 				options->channels = strtol(optarg, NULL, 10);
 				break;
@@ -596,6 +665,16 @@ int pc_options_parse(pc_options_t *options,
 			case 'P':
 				options->positive_only = true;
 				break;
+			case 'r':
+				options->read_ahead = true;
+				break;
+			case 'l':
+				options->threads = strtoul(optarg, NULL, 10);
+				break;
+			case 'L':
+				options->select_pairs = true;
+				options->pairs_string = strdup(optarg);
+				break;
 			case 'w':
 				options->bin_width = strtoull(optarg, NULL, 10);
 				break;
@@ -708,6 +787,11 @@ int pc_options_parse(pc_options_t *options,
 		return(PC_ERROR_OPTIONS);
 	}
 
+	if ( pc_options_has_option(options, OPT_FORMAT) &&
+			pc_options_parse_format(options) != PC_SUCCESS ) {
+		return(PC_ERROR_OPTIONS);
+	}
+
 	if ( pc_options_has_option(options, OPT_TIME_SCALE) &&
 			pc_options_parse_time_scale(options) != PC_SUCCESS ) {
 		return(PC_ERROR_OPTIONS);
@@ -719,6 +803,7 @@ int pc_options_parse(pc_options_t *options,
 	}
 
 	if ( pc_options_has_option(options, OPT_TIME) &&
+			pc_options_requires_time_limits(options) &&
 			pc_options_parse_time_limits(options) != PC_SUCCESS ) {
 		return(PC_ERROR_OPTIONS);
 	}
@@ -760,6 +845,11 @@ int pc_options_parse(pc_options_t *options,
 		return(PC_ERROR_OPTIONS);
 	}
 
+	if ( pc_options_has_option(options, OPT_PAIRS) &&
+			pc_options_parse_pairs(options) != PC_SUCCESS ) {
+		return(PC_ERROR_OPTIONS);
+	}
+
 	return(PC_SUCCESS);
 }
 
@@ -768,6 +858,25 @@ int pc_options_parse_mode(pc_options_t *options) {
 	return(mode_parse(&(options->mode), options->mode_string));
 }
 
+int pc_options_parse_format(pc_options_t *options) {
+	int result = format_parse(&(options->format), options->format_string);
+
+	/* Photons go out in the same format they came in, unless told
+	 * otherwise or that format can only be read.
+	 */
+	if ( result == PC_SUCCESS ) {
+		if ( options->format_out_string == NULL ) {
+			options->format_out = format_writable(options->format) ?
+					options->format : FORMAT_TEXT;
+		} else {
+			result = format_parse(&(options->format_out),
+					options->format_out_string);
+		}
+	}
+
+	return(result);
+}
+
 int pc_options_parse_time_scale(pc_options_t *options) {
 	return(scale_parse(&(options->time_scale), options->time_scale_string));
 }
@@ -776,6 +885,13 @@ int pc_options_parse_pulse_scale(pc_options_t *options) {
 	return(scale_parse(&(options->pulse_scale), options->pulse_scale_string));
 }
 
+int pc_options_requires_time_limits(pc_options_t const *options) {
+/* The multi-tau correlators choose their own lags, and only use time limits
+ * when asked for a linear correlation instead. */
+	return( options->time_string != NULL ||
+			! pc_options_has_option(options, OPT_BINNING) );
+}
+
 int pc_options_parse_time_limits(pc_options_t *options) {
 	return(limits_parse(&(options->time_limits), options->time_string));
 }
@@ -818,6 +934,10 @@ int pc_options_parse_convert(pc_options_t *options) {
 	return(mode_parse(&(options->convert), options->convert_string));
 }
 
+int pc_options_parse_pairs(pc_options_t *options) {
+	return(pairs_parse(options));
+}
+
 char const* pc_options_string(pc_options_t const *options) {
 	return(&(options->string[0]));
 }
@@ -906,6 +1026,12 @@ int pc_options_fprintf(FILE *stream_out, pc_options_t const *options) {
 	fprintf(stream_out, "filename_out = %s\n", options->filename_out);
 	fprintf(stream_out, "mode = %d (%s)\n", 
 			options->mode, options->mode_string);
+	fprintf(stream_out, "format = %d (%s)\n", 
+			options->format, options->format_string);
+	fprintf(stream_out, "format_out = %d (%s)\n", 
+			options->format_out, options->format_out_string);
+	fprintf(stream_out, "read_ahead = %d\n", options->read_ahead);
+	fprintf(stream_out, "threads = %u\n", options->threads);
 	fprintf(stream_out, "channels = %d\n", options->channels);
 	fprintf(stream_out, "order = %d\n", options->order);
 	fprintf(stream_out, "print_every = %d\n", options->print_every);
@@ -993,6 +1119,15 @@ int pc_options_fprintf(FILE *stream_out, pc_options_t const *options) {
 	fprintf(stream_out, "exact_normalization = %d\n", 
 			options->exact_normalization);
 
+	fprintf(stream_out, "pairs = ");
+	for ( i = 0; i < options->n_pairs*options->order; i++ ) {
+		fprintf(stream_out, "%u", options->pairs[i]);
+		if ( i + 1 != options->n_pairs*options->order ) {
+			fprintf(stream_out, (i+1) % options->order ? "," : ";");
+		}
+	}
+	fprintf(stream_out, "(%s)\n", options->pairs_string);
+
 	fprintf(stream_out, "repetition_rate = %lf\n", options->repetition_rate);
 	fprintf(stream_out, "convert = %d (%s)\n", 
 			options->convert, options->convert_string);
@@ -1094,3 +1229,74 @@ int suppress_valid(pc_options_t const *options) {
 	return(options->suppressed_channels != NULL);
 }
 
+int pairs_parse(pc_options_t *options) {
+/* The tuples are separated by semicolons, and the channels within each by
+ * commas, e.g. 0,1;2,3. Each tuple must have one channel per order. 
+ */
+	char const *c;
+	char *end;
+	long channel;
+	int i;
+	size_t n_tuples = 1;
+
+	if ( ! options->select_pairs ) {
+		return(PC_SUCCESS);
+	}
+
+	for ( c = options->pairs_string; *c != '\0'; c++ ) {
+		if ( *c == ';' ) {
+			n_tuples++;
+		}
+	}
+
+	options->pairs = (unsigned int *)malloc(
+			sizeof(unsigned int)*options->order*n_tuples);
+
+	if ( options->pairs == NULL ) {
+		error("Could not allocate memory for the pairs.\n");
+		return(PC_ERROR_MEM);
+	}
+
+	options->n_pairs = 0;
+	c = options->pairs_string;
+
+	while ( true ) {
+		for ( i = 0; i < options->order; i++ ) {
+			channel = strtol(c, &end, 10);
+
+			if ( end == c || channel < 0 || channel >= options->channels ) {
+				error("Invalid channel in pairs: %s\n", c);
+				return(PC_ERROR_OPTIONS);
+			}
+
+			options->pairs[options->n_pairs*options->order + i] = channel;
+			c = end;
+
+			if ( i + 1 != options->order ) {
+				if ( *c != ',' ) {
+					error("Each of the pairs must have %d channels: %s\n",
+							options->order, options->pairs_string);
+					return(PC_ERROR_OPTIONS);
+				}
+
+				c++;
+			}
+		}
+
+		debug("Selected tuple %u\n", options->n_pairs);
+		options->n_pairs++;
+
+		if ( *c == '\0' ) {
+			break;
+		} else if ( *c != ';' ) {
+			error("Each of the pairs must have %d channels: %s\n",
+					options->order, options->pairs_string);
+			return(PC_ERROR_OPTIONS);
+		}
+
+		c++;
+	}
+
+	return(PC_SUCCESS);
+}
+
@@ -65,6 +65,13 @@ typedef struct {
 	char *mode_string;
 	int mode;
 
+	char *format_string;
+	int format;
+	char *format_out_string;
+	int format_out;
+	int read_ahead;
+	unsigned int threads;
+
 	int channels;
 	int order;
 
@@ -128,6 +135,11 @@ typedef struct {
 /* gn */
 	int exact_normalization;
 
+	int select_pairs;
+	char *pairs_string;
+	unsigned int n_pairs;
+	unsigned int *pairs;
+
 /* photons */
 	double repetition_rate;
 	long long time_origin;
@@ -182,6 +194,9 @@ enum { OPT_HELP, OPT_VERSION,
 		OPT_SYNC_CHANNEL, OPT_SYNC_DIVIDER,
 		OPT_THRESHOLD,
 		OPT_TIME_THRESHOLD,
+		OPT_FORMAT, OPT_FORMAT_OUT,
+		OPT_READ_AHEAD, OPT_THREADS,
+		OPT_PAIRS,
 		OPT_EOF };
 
 pc_options_t *pc_options_alloc(void);
@@ -195,8 +210,10 @@ int pc_options_parse(pc_options_t *options,
 		int const argc, char * const *argv);
 
 int pc_options_parse_mode(pc_options_t *options);
+int pc_options_parse_format(pc_options_t *options);
 int pc_options_parse_time_scale(pc_options_t *options);
 int pc_options_parse_pulse_scale(pc_options_t *options);
+int pc_options_requires_time_limits(pc_options_t const *options);
 int pc_options_parse_time_limits(pc_options_t *options);
 int pc_options_parse_pulse_limits(pc_options_t *options);
 int pc_options_parse_intensity_limits(pc_options_t *options);
@@ -204,6 +221,7 @@ int pc_options_parse_suppress(pc_options_t *options);
 int pc_options_parse_time_offsets(pc_options_t *options);
 int pc_options_parse_pulse_offsets(pc_options_t *options);
 int pc_options_parse_convert(pc_options_t *options);
+int pc_options_parse_pairs(pc_options_t *options);
 
 void pc_options_usage(pc_options_t const *options, 
 		int const argc, char * const *argv);
@@ -222,4 +240,6 @@ int offsets_valid(long long const *offsets);
 int suppress_parse(pc_options_t *options);
 int suppress_valid(pc_options_t const *options);
 
+int pairs_parse(pc_options_t *options);
+
 #endif
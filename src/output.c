@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "output.h"
+#include "error.h"
+
+/*
+ * Text output is the bulk of the work for programs such as photon_correlate,
+ * which may emit billions of records. Calling fprintf for every field means
+ * interpreting a format string and consulting the locale each time, so 
+ * instead each record is assembled in a local buffer, with integers converted
+ * by hand, and handed to stdio with a single fwrite. The output stream is 
+ * given a large buffer when it is opened (see streams_open), so the data 
+ * reach the system in large blocks.
+ *
+ * The text produced is identical to that of %c, %u/%llu, %lld and %.2lf.
+ * Doubles are rare (histogram edges) and are left to snprintf. Each call 
+ * returns the status of any write it made, so that a failure part of the 
+ * way through a long record is not lost.
+ */
+void output_init(output_t *output, FILE *stream_out) {
+	output->stream_out = stream_out;
+	output->position = output->buffer;
+}
+
+int output_flush(output_t *output) {
+	size_t length = output->position - output->buffer;
+
+	output->position = output->buffer;
+
+	if ( length > 0 && 
+			fwrite(output->buffer, 1, length, output->stream_out) != length ) {
+		return(PC_ERROR_IO);
+	}
+
+	return( ! ferror(output->stream_out) ? PC_SUCCESS : PC_ERROR_IO );
+}
+
+static inline int output_reserve(output_t *output, size_t const size) {
+	if ( (size_t)(output->buffer + OUTPUT_BUFFER_SIZE - output->position) 
+			< size ) {
+		return(output_flush(output));
+	}
+
+	return(PC_SUCCESS);
+}
+
+int output_char(output_t *output, char const c) {
+	int result = output_reserve(output, 1);
+
+	*(output->position++) = c;
+
+	return(result);
+}
+
+int output_unsigned(output_t *output, unsigned long long const value) {
+	char digits[OUTPUT_INTEGER_SIZE];
+	char *digit = digits + OUTPUT_INTEGER_SIZE;
+	unsigned long long remaining = value;
+	int result;
+
+	result = output_reserve(output, OUTPUT_INTEGER_SIZE);
+
+	do {
+		*(--digit) = '0' + (char)(remaining % 10);
+		remaining /= 10;
+	} while ( remaining > 0 );
+
+	while ( digit < digits + OUTPUT_INTEGER_SIZE ) {
+		*(output->position++) = *(digit++);
+	}
+
+	return(result);
+}
+
+int output_long_long(output_t *output, long long const value) {
+	if ( value < 0 ) {
+		if ( output_char(output, '-') != PC_SUCCESS ) {
+			return(PC_ERROR_IO);
+		}
+
+		/* Negate as unsigned, so LLONG_MIN does not overflow. */
+		return(output_unsigned(output, -(unsigned long long)value));
+	} else {
+		return(output_unsigned(output, (unsigned long long)value));
+	}
+}
+
+int output_double(output_t *output, double const value) {
+	int length;
+	int result;
+
+	result = output_reserve(output, OUTPUT_DOUBLE_SIZE);
+
+	length = snprintf(output->position, OUTPUT_DOUBLE_SIZE, "%.2lf", value);
+
+	if ( length > 0 ) {
+		output->position += length < OUTPUT_DOUBLE_SIZE ? 
+				length : OUTPUT_DOUBLE_SIZE - 1;
+	}
+
+	return(result);
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "binary.h"
+
+/*
+ * Binary photon records are always stored little-endian, so that files can be
+ * moved between machines freely. These routines do the byte shuffling 
+ * explicitly rather than relying on the layout of the host.
+ */
+void binary_pack_uint32(unsigned char *buffer, uint32_t const value) {
+	int i;
+
+	for ( i = 0; i < 4; i++ ) {
+		buffer[i] = (unsigned char)(value >> (8*i));
+	}
+}
+
+void binary_pack_int64(unsigned char *buffer, int64_t const value) {
+	int i;
+	uint64_t bits = (uint64_t)value;
+
+	for ( i = 0; i < 8; i++ ) {
+		buffer[i] = (unsigned char)(bits >> (8*i));
+	}
+}
+
+uint32_t binary_unpack_uint32(unsigned char const *buffer) {
+	return( (uint32_t)buffer[0] | 
+			((uint32_t)buffer[1] << 8) |
+			((uint32_t)buffer[2] << 16) | 
+			((uint32_t)buffer[3] << 24) );
+}
+
+int64_t binary_unpack_int64(unsigned char const *buffer) {
+	int i;
+	uint64_t bits = 0;
+
+	for ( i = 7; i >= 0; i-- ) {
+		bits = (bits << 8) | buffer[i];
+	}
+
+	return((int64_t)bits);
+}
+
+/*
+ * Variable-length integers store 7 bits per byte, least significant first,
+ * with the high bit set on every byte but the last. Small values, such as the
+ * difference between successive arrival times, then take one or two bytes.
+ * Signed values are zigzag-encoded first (0, -1, 1, -2, ... become 0, 1, 2,
+ * 3, ...) so that small negative numbers stay small.
+ */
+size_t binary_pack_varint(unsigned char *buffer, uint64_t value) {
+	size_t n = 0;
+
+	while ( value >= 0x80 ) {
+		buffer[n++] = (unsigned char)(value | 0x80);
+		value >>= 7;
+	}
+
+	buffer[n++] = (unsigned char)value;
+	return(n);
+}
+
+/* Returns the number of bytes consumed, or 0 if the value runs past end. */
+size_t binary_unpack_varint(unsigned char const *buffer,
+		unsigned char const *end, uint64_t *value) {
+	size_t n = 0;
+	int shift = 0;
+	uint64_t result = 0;
+
+	while ( buffer + n < end && shift < 64 ) {
+		result |= (uint64_t)(buffer[n] & 0x7F) << shift;
+
+		if ( ! (buffer[n++] & 0x80) ) {
+			*value = result;
+			return(n);
+		}
+
+		shift += 7;
+	}
+
+	return(0);
+}
+
+uint64_t binary_zigzag_encode(int64_t const value) {
+	return( ((uint64_t)value << 1) ^ (uint64_t)(value >> 63) );
+}
+
+int64_t binary_zigzag_decode(uint64_t const value) {
+	return( (int64_t)(value >> 1) ^ -(int64_t)(value & 1) );
+}
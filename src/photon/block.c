@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+
+#include "block.h"
+#include "../error.h"
+#include "../modes.h"
+
+/*
+ * For work which touches every photon but only some of its fields (counting
+ * by channel, histogramming arrival times, applying offsets, finding the 
+ * edges of a window), an array of photon_t wastes most of each cache line on
+ * fields which are never read, and every t2 photon carries the unused space
+ * of a t3 photon. Storing each field as its own array keeps these loops over
+ * dense arrays of a single type, which the compiler can vectorize.
+ *
+ * Blocks are filled from, and emptied to, the usual batches of photon_t, so
+ * the readers and writers do not need to know about them.
+ */
+photon_block_t *photon_block_alloc(int const mode, size_t const capacity) {
+	photon_block_t *block = NULL;
+
+	if ( mode != MODE_T2 && mode != MODE_T3 ) {
+		error("Invalid mode for photon block: %d\n", mode);
+		return(block);
+	}
+
+	block = (photon_block_t *)malloc(sizeof(photon_block_t));
+
+	if ( block == NULL ) {
+		return(block);
+	}
+
+	block->mode = mode;
+	block->capacity = capacity;
+	block->pulse = NULL;
+
+	block->channel = (unsigned int *)malloc(sizeof(unsigned int)*capacity);
+	block->time = (long long *)malloc(sizeof(long long)*capacity);
+
+	if ( mode == MODE_T3 ) {
+		block->pulse = (long long *)malloc(sizeof(long long)*capacity);
+	}
+
+	if ( block->channel == NULL || block->time == NULL ||
+			(mode == MODE_T3 && block->pulse == NULL) ) {
+		photon_block_free(&block);
+		return(block);
+	}
+
+	photon_block_init(block);
+
+	return(block);
+}
+
+void photon_block_init(photon_block_t *block) {
+	block->n_photons = 0;
+}
+
+void photon_block_free(photon_block_t **block) {
+	if ( *block != NULL ) {
+		free((*block)->channel);
+		free((*block)->pulse);
+		free((*block)->time);
+		free(*block);
+		*block = NULL;
+	}
+}
+
+int photon_block_from_photons(photon_block_t *block, 
+		photon_t const *photons, size_t const n) {
+	photon_block_init(block);
+	return(photon_block_append(block, photons, n));
+}
+
+int photon_block_append(photon_block_t *block, 
+		photon_t const *photons, size_t const n) {
+	size_t const offset = block->n_photons;
+	size_t i;
+
+	if ( n > block->capacity - offset ) {
+		error("Too many photons for block: %zu > %zu.\n", 
+				offset + n, block->capacity);
+		return(PC_ERROR_INDEX);
+	}
+
+	if ( block->mode == MODE_T2 ) {
+		for ( i = 0; i < n; i++ ) {
+			block->channel[offset+i] = photons[i].t2.channel;
+			block->time[offset+i] = photons[i].t2.time;
+		}
+	} else {
+		for ( i = 0; i < n; i++ ) {
+			block->channel[offset+i] = photons[i].t3.channel;
+			block->pulse[offset+i] = photons[i].t3.pulse;
+			block->time[offset+i] = photons[i].t3.time;
+		}
+	}
+
+	block->n_photons += n;
+	return(PC_SUCCESS);
+}
+
+void photon_block_to_photons(photon_block_t const *block, photon_t *photons) {
+	size_t i;
+
+	if ( block->mode == MODE_T2 ) {
+		for ( i = 0; i < block->n_photons; i++ ) {
+			photons[i].t2.channel = block->channel[i];
+			photons[i].t2.time = block->time[i];
+		}
+	} else {
+		for ( i = 0; i < block->n_photons; i++ ) {
+			photons[i].t3.channel = block->channel[i];
+			photons[i].t3.pulse = block->pulse[i];
+			photons[i].t3.time = block->time[i];
+		}
+	}
+}
+
+/* 
+ * The values used to window the photons, as for photon_window_dimension_t: 
+ * time for t2, pulse for t3.
+ */
+long long const *photon_block_window_dim(photon_block_t const *block) {
+	return( block->mode == MODE_T2 ? block->time : block->pulse );
+}
+
+/*
+ * For sorted photons, find the range [first, last) of those which fall in
+ * the window [lower, upper).
+ */
+static size_t photon_block_lower_bound(long long const *values, size_t const n,
+		long long const value) {
+	size_t lower = 0;
+	size_t upper = n;
+	size_t middle;
+
+	while ( lower < upper ) {
+		middle = lower + (upper - lower)/2;
+
+		if ( values[middle] < value ) {
+			lower = middle + 1;
+		} else {
+			upper = middle;
+		}
+	}
+
+	return(lower);
+}
+
+void photon_block_find_window(photon_block_t const *block,
+		long long const lower, long long const upper,
+		size_t *first, size_t *last) {
+	long long const *values = photon_block_window_dim(block);
+
+	*first = photon_block_lower_bound(values, block->n_photons, lower);
+	*last = *first + photon_block_lower_bound(&values[*first], 
+			block->n_photons - *first, upper);
+}
+
+void photon_block_offset(photon_block_t *block, offsets_t const *offsets) {
+	size_t i;
+
+	if ( offsets->offset_time ) {
+		for ( i = 0; i < block->n_photons; i++ ) {
+			block->time[i] += offsets->time_offsets[block->channel[i]];
+		}
+	}
+
+	if ( block->mode == MODE_T3 && offsets->offset_pulse ) {
+		for ( i = 0; i < block->n_photons; i++ ) {
+			block->pulse[i] += offsets->pulse_offsets[block->channel[i]];
+		}
+	}
+}
+
+/*
+ * Add the number of photons on each channel to counts. 
+ */
+int photon_block_count(photon_block_t const *block, 
+		unsigned long long *counts, unsigned int const channels) {
+	unsigned int max_channel = 0;
+	size_t i;
+
+	/* Check the channels first, to keep the counting loop simple. */
+	for ( i = 0; i < block->n_photons; i++ ) {
+		if ( block->channel[i] > max_channel ) {
+			max_channel = block->channel[i];
+		}
+	}
+
+	if ( block->n_photons > 0 && max_channel >= channels ) {
+		error("Invalid channel: %u\n", max_channel);
+		return(PC_ERROR_CHANNEL);
+	}
+
+	for ( i = 0; i < block->n_photons; i++ ) {
+		counts[block->channel[i]]++;
+	}
+
+	return(PC_SUCCESS);
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PHOTON_BLOCK_H_
+#define PHOTON_BLOCK_H_
+
+#include <stddef.h>
+
+#include "photon.h"
+#include "offsets.h"
+
+/* 
+ * A block of photons stored as one array per field, rather than as an array
+ * of photon_t. t2 blocks have no pulses.
+ */
+typedef struct {
+	int mode;
+	size_t capacity;
+	size_t n_photons;
+
+	unsigned int *channel;
+	long long *pulse;
+	long long *time;
+} photon_block_t;
+
+photon_block_t *photon_block_alloc(int const mode, size_t const capacity);
+void photon_block_init(photon_block_t *block);
+void photon_block_free(photon_block_t **block);
+
+int photon_block_from_photons(photon_block_t *block, 
+		photon_t const *photons, size_t const n);
+int photon_block_append(photon_block_t *block, 
+		photon_t const *photons, size_t const n);
+void photon_block_to_photons(photon_block_t const *block, photon_t *photons);
+
+long long const *photon_block_window_dim(photon_block_t const *block);
+void photon_block_find_window(photon_block_t const *block,
+		long long const lower, long long const upper,
+		size_t *first, size_t *last);
+
+void photon_block_offset(photon_block_t *block, offsets_t const *offsets);
+int photon_block_count(photon_block_t const *block, 
+		unsigned long long *counts, unsigned int const channels);
+
+#endif
@@ -0,0 +1,632 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "compressed.h"
+#include "binary.h"
+#include "../error.h"
+#include "../modes.h"
+
+/*
+ * A compact container for photons, meant for archiving large data sets. The
+ * photons are grouped into blocks, and within a block each photon is stored
+ * as varints:
+ *   t2: channel, change in time since the last photon
+ *   t3: channel, change in pulse since the last photon, time
+ * The changes are zigzag-encoded, so unsorted data are still stored 
+ * correctly, if less compactly. Since arrival times are monotonic and close
+ * together, most photons take 3-5 bytes instead of the 15-20 of text, and
+ * decoding them is much cheaper than parsing.
+ *
+ * Each block starts with a header giving its number of photons, the size of
+ * its payload and the range of times and pulses it covers. After the last 
+ * block comes an index with the offset and header of every block, so that a
+ * reader with random access can find the blocks it needs without reading 
+ * the whole file.
+ */
+
+static void compressed_block_pack(unsigned char *buffer, 
+		compressed_block_t const *block) {
+	binary_pack_uint32(&buffer[0], (uint32_t)block->n_photons);
+	binary_pack_uint32(&buffer[4], (uint32_t)block->payload_size);
+	binary_pack_int64(&buffer[8], block->first_time);
+	binary_pack_int64(&buffer[16], block->last_time);
+	binary_pack_int64(&buffer[24], block->first_pulse);
+	binary_pack_int64(&buffer[32], block->last_pulse);
+}
+
+static void compressed_block_unpack(unsigned char const *buffer,
+		compressed_block_t *block) {
+	block->n_photons = binary_unpack_uint32(&buffer[0]);
+	block->payload_size = binary_unpack_uint32(&buffer[4]);
+	block->first_time = binary_unpack_int64(&buffer[8]);
+	block->last_time = binary_unpack_int64(&buffer[16]);
+	block->first_pulse = binary_unpack_int64(&buffer[24]);
+	block->last_pulse = binary_unpack_int64(&buffer[32]);
+}
+
+static long long compressed_time(int const mode, photon_t const *photon) {
+	return( mode == MODE_T2 ? photon->t2.time : photon->t3.time );
+}
+
+static long long compressed_pulse(int const mode, photon_t const *photon) {
+	return( mode == MODE_T2 ? 0 : photon->t3.pulse );
+}
+
+compressed_t *compressed_alloc(int const mode) {
+	compressed_t *compressed = NULL;
+
+	compressed = (compressed_t *)malloc(sizeof(compressed_t));
+
+	if ( compressed == NULL ) {
+		return(compressed);
+	}
+
+	compressed->mode = mode;
+	compressed->photons = (photon_t *)malloc(
+			sizeof(photon_t)*COMPRESSED_BLOCK_PHOTONS);
+	compressed->payload = (unsigned char *)malloc(
+			sizeof(unsigned char)*COMPRESSED_PAYLOAD_SIZE);
+
+	if ( compressed->photons == NULL || compressed->payload == NULL ) {
+		compressed_free(&compressed);
+		return(compressed);
+	}
+
+	compressed_init(compressed);
+
+	return(compressed);
+}
+
+void compressed_init(compressed_t *compressed) {
+	memset(&(compressed->block), 0, sizeof(compressed_block_t));
+	compressed->n_photons = 0;
+	compressed->next = 0;
+}
+
+void compressed_free(compressed_t **compressed) {
+	if ( *compressed != NULL ) {
+		free((*compressed)->photons);
+		free((*compressed)->payload);
+		free(*compressed);
+		*compressed = NULL;
+	}
+}
+
+int compressed_header_fread(compressed_t *compressed, FILE *stream_in) {
+	unsigned char header[COMPRESSED_FILE_HEADER_SIZE];
+	uint32_t version;
+	uint32_t mode;
+
+	compressed_init(compressed);
+
+	if ( fread(header, 1, COMPRESSED_FILE_HEADER_SIZE, stream_in) != 
+			COMPRESSED_FILE_HEADER_SIZE ) {
+		error("Could not read the compressed photon header.\n");
+		return(PC_ERROR_IO);
+	}
+
+	if ( memcmp(header, COMPRESSED_MAGIC, COMPRESSED_MAGIC_SIZE) ) {
+		error("Not a compressed photon file.\n");
+		return(PC_ERROR_IO);
+	}
+
+	version = binary_unpack_uint32(&header[8]);
+	mode = binary_unpack_uint32(&header[12]);
+
+	if ( version != COMPRESSED_VERSION ) {
+		error("Unsupported compressed photon version: %u\n", version);
+		return(PC_ERROR_IO);
+	}
+
+	if ( (int)mode != compressed->mode ) {
+		error("Compressed photon file contains mode %u, but mode %d was "
+				"requested.\n", mode, compressed->mode);
+		return(PC_ERROR_MODE);
+	}
+
+	return(PC_SUCCESS);
+}
+
+/*
+ * Decode the payload of the current block into the photon buffer.
+ */
+static int compressed_decode(compressed_t *compressed, 
+		unsigned char const *payload) {
+	unsigned char const *position = payload;
+	unsigned char const *end = payload + compressed->block.payload_size;
+	long long time = compressed->block.first_time;
+	long long pulse = compressed->block.first_pulse;
+	uint64_t channel;
+	uint64_t delta;
+	uint64_t value;
+	size_t n;
+	size_t i;
+
+	for ( i = 0; i < compressed->block.n_photons; i++ ) {
+		if ( ! (n = binary_unpack_varint(position, end, &channel)) ) {
+			break;
+		}
+		position += n;
+
+		if ( ! (n = binary_unpack_varint(position, end, &delta)) ) {
+			break;
+		}
+		position += n;
+
+		if ( compressed->mode == MODE_T2 ) {
+			time += binary_zigzag_decode(delta);
+			compressed->photons[i].t2.channel = (unsigned int)channel;
+			compressed->photons[i].t2.time = time;
+		} else {
+			if ( ! (n = binary_unpack_varint(position, end, &value)) ) {
+				break;
+			}
+			position += n;
+
+			pulse += binary_zigzag_decode(delta);
+			compressed->photons[i].t3.channel = (unsigned int)channel;
+			compressed->photons[i].t3.pulse = pulse;
+			compressed->photons[i].t3.time = binary_zigzag_decode(value);
+		}
+	}
+
+	if ( i != compressed->block.n_photons || position != end ) {
+		error("Corrupt compressed photon block.\n");
+		return(PC_ERROR_IO);
+	}
+
+	compressed->n_photons = compressed->block.n_photons;
+	compressed->next = 0;
+
+	return(PC_SUCCESS);
+}
+
+static int compressed_block_valid(compressed_block_t const *block) {
+	if ( block->n_photons > COMPRESSED_BLOCK_PHOTONS ||
+			(block->n_photons > 0 && 
+				block->payload_size > COMPRESSED_PAYLOAD_SIZE) ) {
+		error("Invalid compressed photon block: %zu photons in %zu bytes.\n",
+				block->n_photons, block->payload_size);
+		return(false);
+	}
+
+	return(true);
+}
+
+/*
+ * When reading from a stream, the blocks are read one at a time and the index
+ * is skipped. Reading to the end of the stream leaves feof() set, as for the
+ * other formats.
+ */
+int compressed_fread(compressed_t *compressed, FILE *stream_in, 
+		photon_t *photon) {
+	unsigned char header[COMPRESSED_BLOCK_HEADER_SIZE];
+	size_t n_read;
+	int result;
+
+	while ( compressed->next >= compressed->n_photons ) {
+		n_read = fread(header, 1, COMPRESSED_BLOCK_HEADER_SIZE, stream_in);
+
+		if ( n_read != COMPRESSED_BLOCK_HEADER_SIZE ) {
+			return( n_read == 0 && feof(stream_in) ? EOF : PC_ERROR_IO );
+		}
+
+		compressed_block_unpack(header, &(compressed->block));
+
+		if ( ! compressed_block_valid(&(compressed->block)) ) {
+			return(PC_ERROR_IO);
+		}
+
+		if ( compressed->block.n_photons == 0 ) {
+			debug("Found the block index.\n");
+			while ( fread(compressed->payload, 1, COMPRESSED_PAYLOAD_SIZE,
+					stream_in) > 0 ) {
+			}
+
+			compressed->n_photons = 0;
+			return(EOF);
+		}
+
+		if ( fread(compressed->payload, 1, compressed->block.payload_size, 
+				stream_in) != compressed->block.payload_size ) {
+			error("Truncated compressed photon block.\n");
+			return(PC_ERROR_IO);
+		}
+
+		result = compressed_decode(compressed, compressed->payload);
+
+		if ( result != PC_SUCCESS ) {
+			return(result);
+		}
+	}
+
+	*photon = compressed->photons[compressed->next++];
+	return(PC_SUCCESS);
+}
+
+/*
+ * From a mapping, the payload is decoded in place.
+ */
+int compressed_map_read(compressed_t *compressed, mapped_t *mapped,
+		photon_t *photon) {
+	size_t remaining;
+	int result;
+
+	while ( compressed->next >= compressed->n_photons ) {
+		remaining = mapped->length - mapped->position;
+
+		if ( remaining < COMPRESSED_BLOCK_HEADER_SIZE ) {
+			mapped->position = mapped->length;
+			mapped->eof = 1;
+			return( remaining == 0 ? EOF : PC_ERROR_IO );
+		}
+
+		compressed_block_unpack(&(mapped->data[mapped->position]),
+				&(compressed->block));
+		mapped->position += COMPRESSED_BLOCK_HEADER_SIZE;
+		remaining -= COMPRESSED_BLOCK_HEADER_SIZE;
+
+		if ( ! compressed_block_valid(&(compressed->block)) ) {
+			return(PC_ERROR_IO);
+		}
+
+		if ( compressed->block.n_photons == 0 ) {
+			debug("Found the block index.\n");
+			mapped->position = mapped->length;
+			mapped->eof = 1;
+			compressed->n_photons = 0;
+			return(EOF);
+		}
+
+		if ( remaining < compressed->block.payload_size ) {
+			error("Truncated compressed photon block.\n");
+			mapped->position = mapped->length;
+			mapped->eof = 1;
+			return(PC_ERROR_IO);
+		}
+
+		result = compressed_decode(compressed, 
+				&(mapped->data[mapped->position]));
+		mapped->position += compressed->block.payload_size;
+
+		if ( result != PC_SUCCESS ) {
+			return(result);
+		}
+	}
+
+	*photon = compressed->photons[compressed->next++];
+	return(PC_SUCCESS);
+}
+
+/*
+ * Move the mapping to the first block which may contain photons at or after
+ * lower_bound (time for t2, pulse for t3), using the index at the end of the
+ * file. The photons are assumed to be sorted, as they must be for a windowed
+ * stream. Only forward moves are made, and a file without a valid index is 
+ * left alone so it can still be read from start to finish.
+ */
+int compressed_map_seek(compressed_t *compressed, mapped_t *mapped,
+		long long const lower_bound) {
+	unsigned char const *trailer;
+	unsigned char const *entries;
+	compressed_block_t index;
+	compressed_block_t block;
+	long long index_offset;
+	long long last;
+	size_t lower;
+	size_t upper;
+	size_t middle;
+	size_t n_blocks;
+
+	if ( mapped->length < COMPRESSED_FILE_HEADER_SIZE + 
+			COMPRESSED_BLOCK_HEADER_SIZE + COMPRESSED_TRAILER_SIZE ) {
+		return(PC_ERROR_IO);
+	}
+
+	trailer = &(mapped->data[mapped->length - COMPRESSED_TRAILER_SIZE]);
+	index_offset = binary_unpack_int64(&trailer[0]);
+
+	if ( memcmp(&trailer[8], COMPRESSED_INDEX_MAGIC, COMPRESSED_MAGIC_SIZE) ||
+			index_offset < COMPRESSED_FILE_HEADER_SIZE || 
+			(size_t)index_offset + COMPRESSED_BLOCK_HEADER_SIZE > 
+				mapped->length - COMPRESSED_TRAILER_SIZE ) {
+		debug("No block index found, reading the whole file.\n");
+		return(PC_ERROR_IO);
+	}
+
+	compressed_block_unpack(&(mapped->data[index_offset]), &index);
+	n_blocks = index.payload_size/COMPRESSED_INDEX_ENTRY_SIZE;
+	entries = &(mapped->data[index_offset + COMPRESSED_BLOCK_HEADER_SIZE]);
+
+	if ( index.n_photons != 0 || 
+			index.payload_size % COMPRESSED_INDEX_ENTRY_SIZE ||
+			(size_t)index_offset + COMPRESSED_BLOCK_HEADER_SIZE + 
+				index.payload_size + COMPRESSED_TRAILER_SIZE != 
+				mapped->length ) {
+		debug("Invalid block index, reading the whole file.\n");
+		return(PC_ERROR_IO);
+	}
+
+	/* Find the first block which ends at or after the bound. If there is
+	 * none, go straight to the index, which reads as the end of the file. */
+	lower = 0;
+	upper = n_blocks;
+	while ( lower < upper ) {
+		middle = lower + (upper - lower)/2;
+		compressed_block_unpack(
+				&entries[middle*COMPRESSED_INDEX_ENTRY_SIZE + 8], &block);
+		last = compressed->mode == MODE_T2 ? 
+				block.last_time : block.last_pulse;
+
+		if ( last < lower_bound ) {
+			lower = middle + 1;
+		} else {
+			upper = middle;
+		}
+	}
+
+	if ( lower < n_blocks ) {
+		block.offset = binary_unpack_int64(
+				&entries[lower*COMPRESSED_INDEX_ENTRY_SIZE]);
+	} else {
+		block.offset = index_offset;
+	}
+
+	if ( block.offset < 0 || (size_t)block.offset > (size_t)index_offset ) {
+		error("Invalid offset in compressed photon index: %lld\n", 
+				block.offset);
+		return(PC_ERROR_IO);
+	}
+
+	if ( (size_t)block.offset > mapped->position ) {
+		debug("Skipping %zu blocks to offset %lld.\n", lower, block.offset);
+		mapped->position = (size_t)block.offset;
+		compressed->n_photons = 0;
+		compressed->next = 0;
+	}
+
+	return(PC_SUCCESS);
+}
+
+compressed_writer_t *compressed_writer_alloc(int const mode) {
+	compressed_writer_t *writer = NULL;
+
+	if ( mode != MODE_T2 && mode != MODE_T3 ) {
+		error("Invalid mode for compressed photons: %d\n", mode);
+		return(writer);
+	}
+
+	writer = (compressed_writer_t *)malloc(sizeof(compressed_writer_t));
+
+	if ( writer == NULL ) {
+		return(writer);
+	}
+
+	writer->mode = mode;
+	writer->index = NULL;
+	writer->index_capacity = 0;
+	writer->photons = (photon_t *)malloc(
+			sizeof(photon_t)*COMPRESSED_BLOCK_PHOTONS);
+	writer->payload = (unsigned char *)malloc(
+			sizeof(unsigned char)*COMPRESSED_PAYLOAD_SIZE);
+
+	if ( writer->photons == NULL || writer->payload == NULL ) {
+		compressed_writer_free(&writer);
+	}
+
+	return(writer);
+}
+
+static int compressed_writer_write(compressed_writer_t *writer,
+		void const *buffer, size_t const size) {
+	if ( fwrite(buffer, 1, size, writer->stream_out) != size ) {
+		error("Could not write compressed photons.\n");
+		return(PC_ERROR_IO);
+	}
+
+	writer->offset += size;
+	return(PC_SUCCESS);
+}
+
+int compressed_writer_init(compressed_writer_t *writer, FILE *stream_out) {
+	unsigned char header[COMPRESSED_FILE_HEADER_SIZE];
+
+	writer->stream_out = stream_out;
+	writer->n_photons = 0;
+	writer->offset = 0;
+	writer->n_blocks = 0;
+
+	memcpy(header, COMPRESSED_MAGIC, COMPRESSED_MAGIC_SIZE);
+	binary_pack_uint32(&header[8], COMPRESSED_VERSION);
+	binary_pack_uint32(&header[12], (uint32_t)writer->mode);
+
+	return(compressed_writer_write(writer, header, 
+			COMPRESSED_FILE_HEADER_SIZE));
+}
+
+static int compressed_writer_index_push(compressed_writer_t *writer,
+		compressed_block_t const *block) {
+	compressed_block_t *index;
+	size_t capacity;
+
+	if ( writer->n_blocks == writer->index_capacity ) {
+		capacity = writer->index_capacity ? 2*writer->index_capacity : 1024;
+		index = (compressed_block_t *)realloc(writer->index,
+				sizeof(compressed_block_t)*capacity);
+
+		if ( index == NULL ) {
+			error("Could not allocate the block index.\n");
+			return(PC_ERROR_MEM);
+		}
+
+		writer->index = index;
+		writer->index_capacity = capacity;
+	}
+
+	writer->index[writer->n_blocks++] = *block;
+	return(PC_SUCCESS);
+}
+
+/*
+ * Encode the pending photons and write them out as a block.
+ */
+static int compressed_writer_flush(compressed_writer_t *writer) {
+	compressed_block_t block;
+	unsigned char header[COMPRESSED_BLOCK_HEADER_SIZE];
+	unsigned char *position = writer->payload;
+	photon_t const *photon;
+	long long time;
+	long long pulse;
+	size_t i;
+	int result;
+
+	if ( writer->n_photons == 0 ) {
+		return(PC_SUCCESS);
+	}
+
+	block.offset = writer->offset;
+	block.n_photons = writer->n_photons;
+	block.first_time = compressed_time(writer->mode, &writer->photons[0]);
+	block.last_time = compressed_time(writer->mode, 
+			&writer->photons[writer->n_photons-1]);
+	block.first_pulse = compressed_pulse(writer->mode, &writer->photons[0]);
+	block.last_pulse = compressed_pulse(writer->mode, 
+			&writer->photons[writer->n_photons-1]);
+
+	time = block.first_time;
+	pulse = block.first_pulse;
+
+	for ( i = 0; i < writer->n_photons; i++ ) {
+		photon = &(writer->photons[i]);
+
+		if ( writer->mode == MODE_T2 ) {
+			position += binary_pack_varint(position, photon->t2.channel);
+			position += binary_pack_varint(position, 
+					binary_zigzag_encode(photon->t2.time - time));
+			time = photon->t2.time;
+		} else {
+			position += binary_pack_varint(position, photon->t3.channel);
+			position += binary_pack_varint(position, 
+					binary_zigzag_encode(photon->t3.pulse - pulse));
+			position += binary_pack_varint(position,
+					binary_zigzag_encode(photon->t3.time));
+			pulse = photon->t3.pulse;
+		}
+	}
+
+	block.payload_size = position - writer->payload;
+	compressed_block_pack(header, &block);
+
+	result = compressed_writer_index_push(writer, &block);
+
+	if ( result == PC_SUCCESS ) {
+		result = compressed_writer_write(writer, header, 
+				COMPRESSED_BLOCK_HEADER_SIZE);
+	}
+
+	if ( result == PC_SUCCESS ) {
+		result = compressed_writer_write(writer, writer->payload, 
+				block.payload_size);
+	}
+
+	writer->n_photons = 0;
+	return(result);
+}
+
+int compressed_writer_push(compressed_writer_t *writer, 
+		photon_t const *photon) {
+	writer->photons[writer->n_photons++] = *photon;
+
+	if ( writer->n_photons == COMPRESSED_BLOCK_PHOTONS ) {
+		return(compressed_writer_flush(writer));
+	}
+
+	return(PC_SUCCESS);
+}
+
+/*
+ * Write out the last block, then the index and the trailer which points to
+ * it. The index header covers the full range of the file.
+ */
+int compressed_writer_close(compressed_writer_t *writer) {
+	compressed_block_t index;
+	unsigned char entry[COMPRESSED_INDEX_ENTRY_SIZE];
+	unsigned char trailer[COMPRESSED_TRAILER_SIZE];
+	size_t i;
+	int result = compressed_writer_flush(writer);
+
+	memset(&index, 0, sizeof(index));
+	index.offset = writer->offset;
+	index.payload_size = writer->n_blocks*COMPRESSED_INDEX_ENTRY_SIZE;
+
+	if ( writer->n_blocks > 0 ) {
+		index.first_time = writer->index[0].first_time;
+		index.last_time = writer->index[writer->n_blocks-1].last_time;
+		index.first_pulse = writer->index[0].first_pulse;
+		index.last_pulse = writer->index[writer->n_blocks-1].last_pulse;
+	}
+
+	compressed_block_pack(entry, &index);
+
+	if ( result == PC_SUCCESS ) {
+		result = compressed_writer_write(writer, entry, 
+				COMPRESSED_BLOCK_HEADER_SIZE);
+	}
+
+	for ( i = 0; result == PC_SUCCESS && i < writer->n_blocks; i++ ) {
+		binary_pack_int64(&entry[0], writer->index[i].offset);
+		compressed_block_pack(&entry[8], &(writer->index[i]));
+		result = compressed_writer_write(writer, entry, 
+				COMPRESSED_INDEX_ENTRY_SIZE);
+	}
+
+	if ( result == PC_SUCCESS ) {
+		binary_pack_int64(&trailer[0], index.offset);
+		memcpy(&trailer[8], COMPRESSED_INDEX_MAGIC, COMPRESSED_MAGIC_SIZE);
+		result = compressed_writer_write(writer, trailer, 
+				COMPRESSED_TRAILER_SIZE);
+	}
+
+	return(result);
+}
+
+void compressed_writer_free(compressed_writer_t **writer) {
+	if ( *writer != NULL ) {
+		free((*writer)->photons);
+		free((*writer)->payload);
+		free((*writer)->index);
+		free(*writer);
+		*writer = NULL;
+	}
+}
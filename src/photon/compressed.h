@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef COMPRESSED_H_
+#define COMPRESSED_H_
+
+#include <stdio.h>
+
+#include "photon.h"
+#include "mapped.h"
+
+/* 
+ * File layout:
+ *   file header: magic (8), version (uint32), mode (uint32)
+ *   blocks: block header, then the encoded photons
+ *   index: block header with no photons, then one entry per block
+ *   trailer: offset of the index (int64), index magic (8)
+ */
+#define COMPRESSED_MAGIC              "PCBLOCKS"
+#define COMPRESSED_INDEX_MAGIC        "PCINDEX"
+#define COMPRESSED_MAGIC_SIZE          8
+#define COMPRESSED_VERSION             1
+
+#define COMPRESSED_FILE_HEADER_SIZE   16
+/* photons (uint32), payload bytes (uint32), first time, last time, 
+ * first pulse, last pulse (int64) */
+#define COMPRESSED_BLOCK_HEADER_SIZE  40
+/* offset of the block (int64), then its header */
+#define COMPRESSED_INDEX_ENTRY_SIZE   (8 + COMPRESSED_BLOCK_HEADER_SIZE)
+#define COMPRESSED_TRAILER_SIZE       16
+
+/* Photons per block, and the most space they can take once encoded. */
+#define COMPRESSED_BLOCK_PHOTONS    4096
+#define COMPRESSED_PAYLOAD_SIZE     (COMPRESSED_BLOCK_PHOTONS*25)
+
+typedef struct {
+	long long offset;
+	size_t n_photons;
+	size_t payload_size;
+	long long first_time;
+	long long last_time;
+	long long first_pulse;
+	long long last_pulse;
+} compressed_block_t;
+
+typedef struct {
+	int mode;
+	compressed_block_t block;
+
+	photon_t *photons;
+	size_t n_photons;
+	size_t next;
+
+	unsigned char *payload;
+} compressed_t;
+
+compressed_t *compressed_alloc(int const mode);
+void compressed_init(compressed_t *compressed);
+void compressed_free(compressed_t **compressed);
+
+int compressed_header_fread(compressed_t *compressed, FILE *stream_in);
+int compressed_fread(compressed_t *compressed, FILE *stream_in, 
+		photon_t *photon);
+int compressed_map_read(compressed_t *compressed, mapped_t *mapped,
+		photon_t *photon);
+int compressed_map_seek(compressed_t *compressed, mapped_t *mapped,
+		long long const lower_bound);
+
+typedef struct {
+	FILE *stream_out;
+	int mode;
+
+	photon_t *photons;
+	size_t n_photons;
+	unsigned char *payload;
+	long long offset;
+
+	compressed_block_t *index;
+	size_t n_blocks;
+	size_t index_capacity;
+} compressed_writer_t;
+
+compressed_writer_t *compressed_writer_alloc(int const mode);
+int compressed_writer_init(compressed_writer_t *writer, FILE *stream_out);
+int compressed_writer_push(compressed_writer_t *writer, 
+		photon_t const *photon);
+int compressed_writer_close(compressed_writer_t *writer);
+void compressed_writer_free(compressed_writer_t **writer);
+
+#endif
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mapped.h"
+#include "../error.h"
+
+/*
+ * When the photons come from a regular file, the whole file is mapped into
+ * memory and the readers walk the mapping directly. This avoids copying each
+ * byte from the kernel into the stdio buffer, and then again into the record
+ * being parsed. Pipes and terminals cannot be mapped, so for those the stream
+ * is left alone and the FILE * readers are used as before.
+ *
+ * The eof flag follows the behavior of feof(): it is only set once a reader
+ * has tried to look past the end of the data, not when the last record has
+ * been consumed.
+ */
+void mapped_init(mapped_t *mapped) {
+	mapped->data = NULL;
+	mapped->length = 0;
+	mapped->position = 0;
+	mapped->eof = 0;
+}
+
+int mapped_open(mapped_t *mapped, FILE *stream_in) {
+	struct stat info;
+	off_t offset;
+	void *data;
+
+	mapped_init(mapped);
+
+	if ( stream_in == NULL || fstat(fileno(stream_in), &info) ) {
+		return(PC_ERROR_IO);
+	}
+
+	if ( ! S_ISREG(info.st_mode) || info.st_size == 0 ) {
+		return(PC_ERROR_IO);
+	}
+
+	/* Start wherever the stream has been left, in case something has already
+	 * been read from it. */
+	offset = ftello(stream_in);
+	if ( offset < 0 || offset > info.st_size ) {
+		return(PC_ERROR_IO);
+	}
+
+	data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE,
+			fileno(stream_in), 0);
+
+	if ( data == MAP_FAILED ) {
+		debug("Could not map the input, falling back to stdio.\n");
+		return(PC_ERROR_IO);
+	}
+
+	madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL);
+
+	debug("Mapped %lld bytes of input.\n", (long long)info.st_size);
+	mapped->data = (unsigned char const *)data;
+	mapped->length = (size_t)info.st_size;
+	mapped->position = (size_t)offset;
+
+	return(PC_SUCCESS);
+}
+
+void mapped_close(mapped_t *mapped) {
+	if ( mapped->data != NULL ) {
+		munmap((void *)mapped->data, mapped->length);
+	}
+
+	mapped_init(mapped);
+}
+
+int mapped_is_open(mapped_t const *mapped) {
+	return( mapped->data != NULL );
+}
+
+int mapped_eof(mapped_t const *mapped) {
+	return(mapped->eof);
+}
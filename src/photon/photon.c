@@ -30,3 +30,70 @@
  */
 
 #include "photon.h"
+#include "../error.h"
+#include "../modes.h"
+#include "../formats.h"
+
+/*
+ * Choose the routines used to read and write photons of a given mode, in a 
+ * given format. If the combination is not supported, NULL is returned.
+ */
+photon_next_t photon_next_select(int const mode, int const format) {
+	if ( mode == MODE_T2 ) {
+		if ( format == FORMAT_TEXT ) {
+			return(t2_fscanf);
+		} else if ( format == FORMAT_BINARY ) {
+			return(t2_fread);
+		}
+	} else if ( mode == MODE_T3 ) {
+		if ( format == FORMAT_TEXT ) {
+			return(t3_fscanf);
+		} else if ( format == FORMAT_BINARY ) {
+			return(t3_fread);
+		}
+	}
+
+	error("Unsupported mode and format for reading photons: %d, %d\n",
+			mode, format);
+	return(NULL);
+}
+
+photon_print_t photon_print_select(int const mode, int const format) {
+	if ( mode == MODE_T2 ) {
+		if ( format == FORMAT_TEXT ) {
+			return(t2_fprintf);
+		} else if ( format == FORMAT_BINARY ) {
+			return(t2_fwrite);
+		}
+	} else if ( mode == MODE_T3 ) {
+		if ( format == FORMAT_TEXT ) {
+			return(t3_fprintf);
+		} else if ( format == FORMAT_BINARY ) {
+			return(t3_fwrite);
+		}
+	}
+
+	error("Unsupported mode and format for writing photons: %d, %d\n",
+			mode, format);
+	return(NULL);
+}
+
+photon_map_next_t photon_map_next_select(int const mode, int const format) {
+	if ( mode == MODE_T2 ) {
+		if ( format == FORMAT_TEXT ) {
+			return(t2_map_scan);
+		} else if ( format == FORMAT_BINARY ) {
+			return(t2_map_read);
+		}
+	} else if ( mode == MODE_T3 ) {
+		if ( format == FORMAT_TEXT ) {
+			return(t3_map_scan);
+		} else if ( format == FORMAT_BINARY ) {
+			return(t3_map_read);
+		}
+	}
+
+	error("Unsupported mode and format for reading photons: %d, %d\n",
+			mode, format);
+	return(NULL);
+}
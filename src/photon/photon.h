@@ -50,13 +50,19 @@ typedef union {
 	t3_t t3;
 } photon_t;
 
+#include "mapped.h"
 #include "t2.h"
 #include "t3.h"
 
 typedef int (*photon_next_t)(FILE *, photon_t *);
 typedef int (*photon_print_t)(FILE *, photon_t const *);
+typedef int (*photon_map_next_t)(mapped_t *, photon_t *);
 
 typedef long long (*photon_window_dimension_t)(photon_t const *);
 typedef long long (*photon_channel_dimension_t)(photon_t const *);
 
+photon_next_t photon_next_select(int const mode, int const format);
+photon_print_t photon_print_select(int const mode, int const format);
+photon_map_next_t photon_map_next_select(int const mode, int const format);
+
 #endif
@@ -33,24 +33,43 @@
 #include "t2.h"
 #include "t3.h"
 #include "conversions.h"
+#include "compressed.h"
 #include "../modes.h"
+#include "../formats.h"
 #include "../error.h"
 
 int photons_echo(FILE *stream_in, FILE *stream_out, 
 		pc_options_t const *options) {
 	int result = PC_SUCCESS;
-	photon_stream_t *photon_stream = photon_stream_alloc(options->mode);
+	int status;
+	photon_stream_t *photon_stream = photon_stream_alloc(options->mode,
+			options->format);
+	photon_print_t print = photon_print_select(options->mode, 
+			options->format_out);
+
+	photon_t batch[PHOTON_STREAM_BATCH_SIZE];
+	size_t n_photons;
+	size_t i;
 
 	if ( photon_stream == NULL ) {
 		result = PC_ERROR_MEM;
+	} else if ( print == NULL ) {
+		result = PC_ERROR_MODE;
 	}
 
 	if ( result == PC_SUCCESS ) {
-		photon_stream_init(photon_stream, stream_in);
+		result = photon_stream_init(photon_stream, stream_in);
+	}
 
-		while ( photon_stream_next_photon(photon_stream) == PC_SUCCESS) {
-			photon_stream->photon_print(stream_out, &photon_stream->photon);
-		}
+	if ( result == PC_SUCCESS ) {
+		do {
+			status = photon_stream_next_batch(photon_stream,
+					batch, PHOTON_STREAM_BATCH_SIZE, &n_photons);
+
+			for ( i = 0; i < n_photons; i++ ) {
+				print(stream_out, &batch[i]);
+			}
+		} while ( status == PC_SUCCESS );
 	}
 
 	photon_stream_free(&photon_stream);
@@ -58,7 +77,19 @@ int photons_echo(FILE *stream_in, FILE *stream_out,
 	return(result);
 }
 
+/* Compressed photons go through a writer, which keeps the current block and
+ * the index; all other formats are printed one photon at a time. */
+static int _photon_emit(FILE *stream_out, photon_t const *photon,
+		photon_print_t print, compressed_writer_t *writer) {
+	if ( writer != NULL ) {
+		return(compressed_writer_push(writer, photon));
+	} else {
+		return(print(stream_out, photon));
+	}
+}
+
 int _copy_to_channel(FILE *stream_out, photon_t *photon, int mode,
+		photon_print_t print, compressed_writer_t *writer,
 		pc_options_t const *options) {
 	int result = PC_SUCCESS;
 
@@ -66,11 +97,11 @@ int _copy_to_channel(FILE *stream_out, photon_t *photon, int mode,
 		if ( mode == MODE_T2 || mode == MODE_AS_T2 ) {
 			photon->t2.channel = options->copy_to_this_channel;
 
-			t2_fprintf(stream_out, photon);
+			_photon_emit(stream_out, photon, print, writer);
 		} else if ( mode == MODE_T3 ) {
 			photon->t3.channel = options->copy_to_this_channel;
 
-			t3_fprintf(stream_out, photon);
+			_photon_emit(stream_out, photon, print, writer);
 		} else {
 			error("Unknown mode: %d\n", options->mode);
 			result = PC_ERROR_MODE;
@@ -84,14 +115,48 @@ int photons(FILE *stream_in, FILE *stream_out,
 		pc_options_t const *options) {
 	photon_t photon;
 	int result = PC_SUCCESS;
+	int status;
+	int mode_out;
+
+	photon_t batch[PHOTON_STREAM_BATCH_SIZE];
+	size_t n_photons;
+	size_t i;
 	photon_stream_t *photons;
+	photon_print_t print = NULL;
+	compressed_writer_t *writer = NULL;
 
-	photons = photon_stream_alloc(options->mode);
+	photons = photon_stream_alloc(options->mode, options->format);
 
 	if ( photons == NULL ) {
 		result = PC_ERROR_MEM;
 	} 
 
+	if ( result == PC_SUCCESS ) {
+		if ( options->convert == MODE_UNKNOWN ) {
+			mode_out = options->mode;
+		} else if ( options->convert == MODE_AS_T2 ) {
+			mode_out = MODE_T2;
+		} else {
+			mode_out = options->convert;
+		}
+
+		if ( options->format_out == FORMAT_COMPRESSED ) {
+			writer = compressed_writer_alloc(mode_out);
+
+			if ( writer == NULL ) {
+				result = PC_ERROR_MEM;
+			} else {
+				result = compressed_writer_init(writer, stream_out);
+			}
+		} else {
+			print = photon_print_select(mode_out, options->format_out);
+
+			if ( print == NULL ) {
+				result = PC_ERROR_MODE;
+			}
+		}
+	}
+
 	if ( result == PC_SUCCESS ) {
 		if ( (options->convert == MODE_T2 || options->convert == MODE_T3 ) &&
 				options->mode != options->convert &&
@@ -102,56 +167,60 @@ int photons(FILE *stream_in, FILE *stream_out,
 	}
 
 	if ( result == PC_SUCCESS ) {
-		photon_stream_init(photons, stream_in);
+		result = photon_stream_init(photons, stream_in);
 		photon_stream_set_unwindowed(photons);
+	}
 
+	if ( result == PC_SUCCESS ) {
 		if ( options->convert == options->mode ||
 				options->convert == MODE_UNKNOWN ) {
 			debug("Echo photons.\n");
-			while ( photon_stream_next_photon(photons) == PC_SUCCESS ) {
-				photons->photon_print(stream_out, &(photons->photon));
-
-				_copy_to_channel(stream_out, &(photons->photon), 
-						options->mode, options);
-			}
 		} else if ( options->mode == MODE_T2 && options->convert == MODE_T3 ) {
 			debug("t2 to t3\n");
-			while ( photon_stream_next_photon(photons) == PC_SUCCESS ) {
-				t2_to_t3(&photons->photon, &photon, options->repetition_rate, 
-						options->time_origin);
-				t3_fprintf(stream_out, &photon);
-
-				_copy_to_channel(stream_out, &photon, 
-						options->convert, options);
-			}
 		} else if ( options->mode == MODE_T3 && options->convert == MODE_T2 ) {
 			debug("t3 to t2\n");
-			while ( photon_stream_next_photon(photons) == PC_SUCCESS ) {
-				t3_to_t2(&photons->photon, &photon, options->repetition_rate, 
-						options->time_origin);
-				t2_fprintf(stream_out, &photon);
-
-				_copy_to_channel(stream_out, &photon, 
-						options->convert, options);
-			}
 		} else if ( options->mode == MODE_T3 && 
 				options->convert == MODE_AS_T2 ) {
 			debug("t3 as t2\n");
-			while ( photon_stream_next_photon(photons) == PC_SUCCESS ) {
-				t3_as_t2(&photons->photon, &photon);
-				t2_fprintf(stream_out, &photon);
-
-				_copy_to_channel(stream_out, &photon, 
-						options->convert, options);
-			}
 		} else {
 			error("Invalid photon conversion: %d to %d\n", 
 					options->mode, options->convert);
 			result = PC_ERROR_MODE;
 		}
 	}
+
+	if ( result == PC_SUCCESS ) {
+		do {
+			status = photon_stream_next_batch(photons, 
+					batch, PHOTON_STREAM_BATCH_SIZE, &n_photons);
+
+			for ( i = 0; i < n_photons; i++ ) {
+				if ( mode_out == options->mode ) {
+					photon = batch[i];
+				} else if ( mode_out == MODE_T3 ) {
+					t2_to_t3(&batch[i], &photon, options->repetition_rate, 
+							options->time_origin);
+				} else if ( options->convert == MODE_T2 ) {
+					t3_to_t2(&batch[i], &photon, options->repetition_rate, 
+							options->time_origin);
+				} else {
+					t3_as_t2(&batch[i], &photon);
+				}
+
+				_photon_emit(stream_out, &photon, print, writer);
+
+				_copy_to_channel(stream_out, &photon, 
+						mode_out, print, writer, options);
+			}
+		} while ( status == PC_SUCCESS );
+	}
+
+	if ( result == PC_SUCCESS && writer != NULL ) {
+		result = compressed_writer_close(writer);
+	}
 		
 	photon_stream_free(&photons);
+	compressed_writer_free(&writer);
 
 	return(result);
 }
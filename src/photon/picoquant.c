@@ -0,0 +1,633 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "picoquant.h"
+#include "binary.h"
+#include "../error.h"
+#include "../modes.h"
+
+/*
+ * Decoder for the TTTR files written by the PicoQuant instruments, so that
+ * raw data can be read directly instead of being converted to text by an 
+ * external program first. Both the unified tagged format (ptu) and the older
+ * fixed headers of the PicoHarp (pt2, pt3) and HydraHarp (ht2, ht3) are 
+ * understood. The header is read once, to find the record type, the 
+ * resolution and the sync rate; after that each 32-bit record is decoded 
+ * into a photon, while overflow records extend the time (t2) or sync (t3) 
+ * counter and markers are skipped.
+ *
+ * The photons are presented as for the other formats:
+ *   t2: channel, time (ps)
+ *   t3: channel, pulse (sync count), time (ps since the sync)
+ * For HydraHarp-style t2 data, sync events appear on channel 0 and input n
+ * on channel n+1, which matches the numbering of the PicoHarp, where the
+ * sync is the first input.
+ */
+
+#define PICOQUANT_PICOHARP_T2_WRAP      210698240LL
+#define PICOQUANT_PICOHARP_T3_WRAP          65536LL
+#define PICOQUANT_HYDRAHARP_V1_T2_WRAP   33552000LL
+#define PICOQUANT_HYDRAHARP_T2_WRAP      33554432LL
+#define PICOQUANT_HYDRAHARP_T3_WRAP          1024LL
+
+/* The PicoHarp has a fixed t2 resolution. */
+#define PICOQUANT_PICOHARP_T2_RESOLUTION        4
+
+/* Layout of the legacy headers. */
+#define PICOQUANT_IDENT_SIZE           16
+#define PICOQUANT_FORMAT_VERSION_SIZE   6
+#define PICOQUANT_TEXT_HEADER_SIZE    328
+#define PICOQUANT_PICOHARP_BOARD_SIZE 156
+
+/* Layout of the ptu tags. */
+#define PTU_MAGIC "PQTTTR"
+#define PTU_IDENT_SIZE 32
+#define PTU_TYPE_FLOAT8_ARRAY  0x2001FFFF
+#define PTU_TYPE_ANSI_STRING   0x4001FFFF
+#define PTU_TYPE_WIDE_STRING   0x4002FFFF
+#define PTU_TYPE_BINARY_BLOB   0xFFFFFFFF
+
+static int picoquant_decode_picoharp_t2(picoquant_t *picoquant,
+		uint32_t const record, photon_t *photon) {
+	uint32_t time = record & 0x0FFFFFFF;
+	uint32_t channel = record >> 28;
+
+	if ( channel == 0xF ) {
+		if ( (time & 0xF) == 0 ) {
+			picoquant->overflow += PICOQUANT_PICOHARP_T2_WRAP;
+		}
+
+		return(PC_ERROR_NO_RECORD_AVAILABLE);
+	}
+
+	photon->t2.channel = channel;
+	photon->t2.time = (picoquant->overflow + time) * picoquant->resolution;
+	return(PC_RECORD_AVAILABLE);
+}
+
+static int picoquant_decode_picoharp_t3(picoquant_t *picoquant,
+		uint32_t const record, photon_t *photon) {
+	uint32_t sync = record & 0xFFFF;
+	uint32_t dtime = (record >> 16) & 0x0FFF;
+	uint32_t channel = record >> 28;
+
+	if ( channel == 0xF ) {
+		if ( (dtime & 0xF) == 0 ) {
+			picoquant->overflow += PICOQUANT_PICOHARP_T3_WRAP;
+		}
+
+		return(PC_ERROR_NO_RECORD_AVAILABLE);
+	} else if ( channel < 1 || channel > 4 ) {
+		warn("Invalid PicoHarp channel: %u\n", channel);
+		return(PC_ERROR_NO_RECORD_AVAILABLE);
+	}
+
+	photon->t3.channel = channel - 1;
+	photon->t3.pulse = picoquant->overflow + sync;
+	photon->t3.time = dtime * picoquant->resolution;
+	return(PC_RECORD_AVAILABLE);
+}
+
+static int picoquant_decode_hydraharp_t2(picoquant_t *picoquant,
+		uint32_t const record, photon_t *photon) {
+	uint32_t time = record & 0x01FFFFFF;
+	uint32_t channel = (record >> 25) & 0x3F;
+	uint32_t special = record >> 31;
+
+	if ( special ) {
+		if ( channel == 0x3F ) {
+			if ( picoquant->record_type == PICOQUANT_HYDRAHARP_V1_T2 ) {
+				picoquant->overflow += PICOQUANT_HYDRAHARP_V1_T2_WRAP;
+			} else {
+				/* Later versions may pack several overflows into one. */
+				picoquant->overflow += PICOQUANT_HYDRAHARP_T2_WRAP * 
+						(time == 0 ? 1 : time);
+			}
+
+			return(PC_ERROR_NO_RECORD_AVAILABLE);
+		} else if ( channel != 0 ) {
+			/* Marker */
+			return(PC_ERROR_NO_RECORD_AVAILABLE);
+		}
+
+		/* Sync */
+		photon->t2.channel = 0;
+	} else {
+		photon->t2.channel = channel + 1;
+	}
+
+	photon->t2.time = (picoquant->overflow + time) * picoquant->resolution;
+	return(PC_RECORD_AVAILABLE);
+}
+
+static int picoquant_decode_hydraharp_t3(picoquant_t *picoquant,
+		uint32_t const record, photon_t *photon) {
+	uint32_t sync = record & 0x03FF;
+	uint32_t dtime = (record >> 10) & 0x7FFF;
+	uint32_t channel = (record >> 25) & 0x3F;
+	uint32_t special = record >> 31;
+
+	if ( special ) {
+		if ( channel == 0x3F ) {
+			if ( picoquant->record_type == PICOQUANT_HYDRAHARP_V1_T3 ) {
+				picoquant->overflow += PICOQUANT_HYDRAHARP_T3_WRAP;
+			} else {
+				picoquant->overflow += PICOQUANT_HYDRAHARP_T3_WRAP *
+						(sync == 0 ? 1 : sync);
+			}
+		}
+
+		return(PC_ERROR_NO_RECORD_AVAILABLE);
+	}
+
+	photon->t3.channel = channel;
+	photon->t3.pulse = picoquant->overflow + sync;
+	photon->t3.time = dtime * picoquant->resolution;
+	return(PC_RECORD_AVAILABLE);
+}
+
+picoquant_t *picoquant_alloc(void) {
+	picoquant_t *picoquant = (picoquant_t *)malloc(sizeof(picoquant_t));
+
+	if ( picoquant != NULL ) {
+		picoquant_init(picoquant);
+	}
+
+	return(picoquant);
+}
+
+void picoquant_init(picoquant_t *picoquant) {
+	picoquant->mode = MODE_UNKNOWN;
+	picoquant->record_type = 0;
+	picoquant->resolution = 0;
+	picoquant->sync_rate = 0;
+	picoquant->records = -1;
+	picoquant->overflow = 0;
+	picoquant->decode = NULL;
+}
+
+void picoquant_free(picoquant_t **picoquant) {
+	if ( *picoquant != NULL ) {
+		free(*picoquant);
+		*picoquant = NULL;
+	}
+}
+
+/* 
+ * Header parsing. The stream may be a pipe, so fields which are not needed 
+ * are read and discarded rather than seeked over.
+ */
+static int picoquant_read(FILE *stream_in, void *buffer, size_t const size) {
+	return( fread(buffer, 1, size, stream_in) == size ? 
+			PC_SUCCESS : PC_ERROR_IO );
+}
+
+static int picoquant_skip(FILE *stream_in, long long size) {
+	unsigned char buffer[1024];
+	size_t n;
+
+	while ( size > 0 ) {
+		n = size < (long long)sizeof(buffer) ? (size_t)size : sizeof(buffer);
+
+		if ( picoquant_read(stream_in, buffer, n) != PC_SUCCESS ) {
+			return(PC_ERROR_IO);
+		}
+
+		size -= n;
+	}
+
+	return(PC_SUCCESS);
+}
+
+static int picoquant_read_int32(FILE *stream_in, int32_t *value) {
+	unsigned char buffer[4];
+	int result = picoquant_read(stream_in, buffer, sizeof(buffer));
+
+	*value = (int32_t)binary_unpack_uint32(buffer);
+	return(result);
+}
+
+static int picoquant_read_int64(FILE *stream_in, int64_t *value) {
+	unsigned char buffer[8];
+	int result = picoquant_read(stream_in, buffer, sizeof(buffer));
+
+	*value = binary_unpack_int64(buffer);
+	return(result);
+}
+
+static double picoquant_float(uint32_t const bits) {
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return(value);
+}
+
+static double picoquant_double(int64_t const bits) {
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+	return(value);
+}
+
+static int picoquant_read_float(FILE *stream_in, double *value) {
+	int32_t bits;
+	int result = picoquant_read_int32(stream_in, &bits);
+
+	*value = picoquant_float((uint32_t)bits);
+	return(result);
+}
+
+static int picoquant_read_double(FILE *stream_in, double *value) {
+	int64_t bits;
+	int result = picoquant_read_int64(stream_in, &bits);
+
+	*value = picoquant_double(bits);
+	return(result);
+}
+
+static int picoquant_header_picoharp(picoquant_t *picoquant, 
+		FILE *stream_in) {
+	int32_t bits_per_record;
+	int32_t boards;
+	int32_t measurement_mode;
+	int32_t sync_rate;
+	int32_t records;
+	int32_t image_header_size;
+	double resolution;
+	int result;
+
+	/* Curves, BitsPerRecord, RoutingChannels, NumberOfBoards, ActiveCurve,
+	 * MeasurementMode, then 12 more ints, the display curves, parameters,
+	 * repeat settings and the script name. */
+	result = picoquant_skip(stream_in, 4) ||
+			picoquant_read_int32(stream_in, &bits_per_record) ||
+			picoquant_skip(stream_in, 4) ||
+			picoquant_read_int32(stream_in, &boards) ||
+			picoquant_skip(stream_in, 4) ||
+			picoquant_read_int32(stream_in, &measurement_mode) ||
+			picoquant_skip(stream_in, 12*4 + 8*8 + 3*12 + 4*4 + 20);
+
+	/* The resolution of the first board. */
+	if ( result == PC_SUCCESS && boards < 1 ) {
+		error("PicoHarp file has no boards.\n");
+		return(PC_ERROR_IO);
+	}
+
+	result = result ||
+			picoquant_skip(stream_in, 16 + 8 + 6*4) ||
+			picoquant_read_float(stream_in, &resolution) ||
+			picoquant_skip(stream_in, 
+				PICOQUANT_PICOHARP_BOARD_SIZE - (16 + 8 + 6*4 + 4) + 
+				(long long)(boards - 1)*PICOQUANT_PICOHARP_BOARD_SIZE);
+
+	/* ExtDevices, Reserved1, Reserved2, CntRate0, CntRate1, StopAfter, 
+	 * StopReason, Records, ImgHdrSize, ImgHdr */
+	result = result ||
+			picoquant_skip(stream_in, 3*4) ||
+			picoquant_read_int32(stream_in, &sync_rate) ||
+			picoquant_skip(stream_in, 3*4) ||
+			picoquant_read_int32(stream_in, &records) ||
+			picoquant_read_int32(stream_in, &image_header_size);
+
+	result = result || 
+			picoquant_skip(stream_in, 4*(long long)image_header_size);
+
+	if ( result != PC_SUCCESS ) {
+		error("Could not read the PicoHarp header.\n");
+		return(PC_ERROR_IO);
+	}
+
+	if ( bits_per_record != 32 ) {
+		error("Unsupported record size: %d bits.\n", bits_per_record);
+		return(PC_ERROR_IO);
+	}
+
+	if ( measurement_mode == MODE_T2 ) {
+		picoquant->record_type = PICOQUANT_PICOHARP_T2;
+		picoquant->resolution = PICOQUANT_PICOHARP_T2_RESOLUTION;
+	} else if ( measurement_mode == MODE_T3 ) {
+		picoquant->record_type = PICOQUANT_PICOHARP_T3;
+		/* Given in ns */
+		picoquant->resolution = llround(resolution*1e3);
+	} else {
+		error("Unsupported PicoHarp measurement mode: %d\n", 
+				measurement_mode);
+		return(PC_ERROR_MODE);
+	}
+
+	picoquant->sync_rate = sync_rate;
+	picoquant->records = records;
+
+	return(PC_SUCCESS);
+}
+
+static int picoquant_header_hydraharp(picoquant_t *picoquant, 
+		FILE *stream_in, int const version) {
+	int32_t bits_per_record;
+	int32_t measurement_mode;
+	int32_t channels;
+	int32_t sync_rate;
+	int32_t image_header_size;
+	int64_t records;
+	double resolution;
+	int result;
+
+	/* NumberOfCurves, BitsPerRecord, ActiveCurve, MeasurementMode, SubMode,
+	 * Binning, Resolution, then 10 ints, the display curves, parameters, 
+	 * repeat settings, script name, hardware information, 
+	 * BaseResolution and InputsEnabled. */
+	result = picoquant_skip(stream_in, 4) ||
+			picoquant_read_int32(stream_in, &bits_per_record) ||
+			picoquant_skip(stream_in, 4) ||
+			picoquant_read_int32(stream_in, &measurement_mode) ||
+			picoquant_skip(stream_in, 2*4) ||
+			picoquant_read_double(stream_in, &resolution) ||
+			picoquant_skip(stream_in, 10*4 + 8*8 + 3*12 + 4*4 + 20 +
+				16 + 8 + 4 + 4 + 10*8 + 8 + 8) ||
+			picoquant_read_int32(stream_in, &channels);
+
+	/* RefClockSource, ExtDevices, MarkerSettings, SyncDivider, 
+	 * SyncCFDLevel, SyncCFDZeroCross, SyncOffset, the settings of each
+	 * channel and its count rate. */
+	result = result ||
+			picoquant_skip(stream_in, 7*4 + (long long)channels*(4*4 + 4)) ||
+			picoquant_read_int32(stream_in, &sync_rate) ||
+			picoquant_skip(stream_in, 2*4) ||
+			picoquant_read_int32(stream_in, &image_header_size) ||
+			picoquant_read_int64(stream_in, &records);
+
+	result = result ||
+			picoquant_skip(stream_in, 4*(long long)image_header_size);
+
+	if ( result != PC_SUCCESS ) {
+		error("Could not read the HydraHarp header.\n");
+		return(PC_ERROR_IO);
+	}
+
+	if ( bits_per_record != 32 ) {
+		error("Unsupported record size: %d bits.\n", bits_per_record);
+		return(PC_ERROR_IO);
+	}
+
+	if ( measurement_mode == MODE_T2 ) {
+		picoquant->record_type = version == 1 ? 
+				PICOQUANT_HYDRAHARP_V1_T2 : PICOQUANT_HYDRAHARP_V2_T2;
+	} else if ( measurement_mode == MODE_T3 ) {
+		picoquant->record_type = version == 1 ? 
+				PICOQUANT_HYDRAHARP_V1_T3 : PICOQUANT_HYDRAHARP_V2_T3;
+	} else {
+		error("Unsupported HydraHarp measurement mode: %d\n", 
+				measurement_mode);
+		return(PC_ERROR_MODE);
+	}
+
+	/* Given in ps */
+	picoquant->resolution = llround(resolution);
+	picoquant->sync_rate = sync_rate;
+	picoquant->records = records;
+
+	return(PC_SUCCESS);
+}
+
+static int picoquant_header_ptu(picoquant_t *picoquant, FILE *stream_in) {
+	char ident[PTU_IDENT_SIZE+1];
+	int32_t index;
+	int32_t type;
+	int64_t value;
+	double global_resolution = 0;
+	double resolution = 0;
+
+	ident[PTU_IDENT_SIZE] = '\0';
+
+	/* The rest of the magic string and the format version. */
+	if ( picoquant_skip(stream_in, 8) != PC_SUCCESS ) {
+		return(PC_ERROR_IO);
+	}
+
+	while ( 1 ) {
+		if ( picoquant_read(stream_in, ident, PTU_IDENT_SIZE) ||
+				picoquant_read_int32(stream_in, &index) ||
+				picoquant_read_int32(stream_in, &type) ||
+				picoquant_read_int64(stream_in, &value) ) {
+			error("Could not read the ptu header.\n");
+			return(PC_ERROR_IO);
+		}
+
+		if ( ! strcmp(ident, "Header_End") ) {
+			break;
+		} else if ( ! strcmp(ident, "TTResultFormat_TTTRRecType") ) {
+			picoquant->record_type = (uint32_t)value;
+		} else if ( ! strcmp(ident, "TTResult_SyncRate") ) {
+			picoquant->sync_rate = value;
+		} else if ( ! strcmp(ident, "TTResult_NumberOfRecords") ) {
+			picoquant->records = value;
+		} else if ( ! strcmp(ident, "MeasDesc_GlobalResolution") ) {
+			global_resolution = picoquant_double(value);
+		} else if ( ! strcmp(ident, "MeasDesc_Resolution") ) {
+			resolution = picoquant_double(value);
+		} else if ( ! strcmp(ident, "TTResultFormat_BitsPerRecord") &&
+				value != 32 ) {
+			error("Unsupported record size: %lld bits.\n", (long long)value);
+			return(PC_ERROR_IO);
+		}
+
+		/* Variable-length tags are followed by their payload. */
+		if ( (uint32_t)type == PTU_TYPE_FLOAT8_ARRAY ||
+				(uint32_t)type == PTU_TYPE_ANSI_STRING ||
+				(uint32_t)type == PTU_TYPE_WIDE_STRING ||
+				(uint32_t)type == PTU_TYPE_BINARY_BLOB ) {
+			if ( picoquant_skip(stream_in, value) != PC_SUCCESS ) {
+				error("Could not read the ptu header.\n");
+				return(PC_ERROR_IO);
+			}
+		}
+	}
+
+	switch ( picoquant->record_type ) {
+		case PICOQUANT_PICOHARP_T2:
+		case PICOQUANT_HYDRAHARP_V1_T2:
+		case PICOQUANT_HYDRAHARP_V2_T2:
+		case PICOQUANT_TIMEHARP_260N_T2:
+		case PICOQUANT_TIMEHARP_260P_T2:
+		case PICOQUANT_MULTIHARP_T2:
+			/* Given in s */
+			picoquant->resolution = llround(global_resolution*1e12);
+			break;
+		default:
+			picoquant->resolution = llround(resolution*1e12);
+			break;
+	}
+
+	return(PC_SUCCESS);
+}
+
+int picoquant_header_fread(picoquant_t *picoquant, FILE *stream_in) {
+	char ident[PICOQUANT_IDENT_SIZE+1];
+	char version[PICOQUANT_FORMAT_VERSION_SIZE+1];
+	int result;
+
+	picoquant_init(picoquant);
+
+	ident[PICOQUANT_IDENT_SIZE] = '\0';
+	version[PICOQUANT_FORMAT_VERSION_SIZE] = '\0';
+
+	if ( picoquant_read(stream_in, ident, 8) != PC_SUCCESS ) {
+		error("Could not read the PicoQuant identifier.\n");
+		return(PC_ERROR_IO);
+	}
+
+	if ( ! strncmp(ident, PTU_MAGIC, strlen(PTU_MAGIC)) ) {
+		debug("Found a ptu file.\n");
+		result = picoquant_header_ptu(picoquant, stream_in);
+	} else if ( picoquant_read(stream_in, &ident[8], 
+				PICOQUANT_IDENT_SIZE - 8) ||
+			picoquant_read(stream_in, version, 
+				PICOQUANT_FORMAT_VERSION_SIZE) ||
+			picoquant_skip(stream_in, PICOQUANT_TEXT_HEADER_SIZE - 
+				PICOQUANT_IDENT_SIZE - PICOQUANT_FORMAT_VERSION_SIZE) ) {
+		error("Could not read the PicoQuant header.\n");
+		result = PC_ERROR_IO;
+	} else if ( ! strncmp(ident, "PicoHarp 300", strlen("PicoHarp 300")) ) {
+		debug("Found a PicoHarp file, version %s.\n", version);
+		result = picoquant_header_picoharp(picoquant, stream_in);
+	} else if ( ! strncmp(ident, "HydraHarp", strlen("HydraHarp")) ) {
+		debug("Found a HydraHarp file, version %s.\n", version);
+		result = picoquant_header_hydraharp(picoquant, stream_in,
+				strncmp(version, "1.0", strlen("1.0")) ? 2 : 1);
+	} else {
+		error("Unknown PicoQuant identifier: %s\n", ident);
+		result = PC_ERROR_IO;
+	}
+
+	if ( result != PC_SUCCESS ) {
+		return(result);
+	}
+
+	switch ( picoquant->record_type ) {
+		case PICOQUANT_PICOHARP_T2:
+			picoquant->mode = MODE_T2;
+			picoquant->decode = picoquant_decode_picoharp_t2;
+			break;
+		case PICOQUANT_PICOHARP_T3:
+			picoquant->mode = MODE_T3;
+			picoquant->decode = picoquant_decode_picoharp_t3;
+			break;
+		case PICOQUANT_HYDRAHARP_V1_T2:
+		case PICOQUANT_HYDRAHARP_V2_T2:
+		case PICOQUANT_TIMEHARP_260N_T2:
+		case PICOQUANT_TIMEHARP_260P_T2:
+		case PICOQUANT_MULTIHARP_T2:
+			picoquant->mode = MODE_T2;
+			picoquant->decode = picoquant_decode_hydraharp_t2;
+			break;
+		case PICOQUANT_HYDRAHARP_V1_T3:
+		case PICOQUANT_HYDRAHARP_V2_T3:
+		case PICOQUANT_TIMEHARP_260N_T3:
+		case PICOQUANT_TIMEHARP_260P_T3:
+		case PICOQUANT_MULTIHARP_T3:
+			picoquant->mode = MODE_T3;
+			picoquant->decode = picoquant_decode_hydraharp_t3;
+			break;
+		default:
+			error("Unsupported PicoQuant record type: 0x%08x\n",
+					picoquant->record_type);
+			return(PC_ERROR_MODE);
+	}
+
+	if ( picoquant->resolution <= 0 ) {
+		error("Invalid PicoQuant resolution: %lld ps\n", 
+				picoquant->resolution);
+		return(PC_ERROR_IO);
+	}
+
+	debug("PicoQuant record type 0x%08x, resolution %lld ps, "
+			"sync rate %lld Hz, %lld records.\n",
+			picoquant->record_type, picoquant->resolution,
+			picoquant->sync_rate, picoquant->records);
+
+	return(PC_SUCCESS);
+}
+
+/*
+ * Take records until one of them is a photon. A partial record at the end of
+ * the stream means the file was truncated.
+ */
+int picoquant_fread(picoquant_t *picoquant, FILE *stream_in, 
+		photon_t *photon) {
+	unsigned char record[PICOQUANT_RECORD_SIZE];
+	size_t n_read;
+
+	if ( picoquant->decode == NULL ) {
+		return(PC_ERROR_MODE);
+	}
+
+	while ( 1 ) {
+		n_read = fread(record, 1, PICOQUANT_RECORD_SIZE, stream_in);
+
+		if ( n_read != PICOQUANT_RECORD_SIZE ) {
+			return( n_read == 0 && feof(stream_in) ? EOF : PC_ERROR_IO );
+		}
+
+		if ( picoquant->decode(picoquant, binary_unpack_uint32(record),
+				photon) == PC_RECORD_AVAILABLE ) {
+			return(PC_SUCCESS);
+		}
+	}
+}
+
+int picoquant_map_read(picoquant_t *picoquant, mapped_t *mapped,
+		photon_t *photon) {
+	size_t remaining;
+
+	if ( picoquant->decode == NULL ) {
+		return(PC_ERROR_MODE);
+	}
+
+	while ( 1 ) {
+		remaining = mapped->length - mapped->position;
+
+		if ( remaining < PICOQUANT_RECORD_SIZE ) {
+			mapped->position = mapped->length;
+			mapped->eof = 1;
+			return( remaining == 0 ? EOF : PC_ERROR_IO );
+		}
+
+		mapped->position += PICOQUANT_RECORD_SIZE;
+
+		if ( picoquant->decode(picoquant, binary_unpack_uint32(
+					&(mapped->data[mapped->position - PICOQUANT_RECORD_SIZE])),
+				photon) == PC_RECORD_AVAILABLE ) {
+			return(PC_SUCCESS);
+		}
+	}
+}
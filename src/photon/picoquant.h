@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef PICOQUANT_H_
+#define PICOQUANT_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "photon.h"
+#include "mapped.h"
+
+/* Every supported TTTR record is a single little-endian 32-bit word. */
+#define PICOQUANT_RECORD_SIZE 4
+
+/* Record types, as given by TTResultFormat_TTTRRecType in ptu files. The
+ * legacy pt2/pt3/ht2/ht3 headers are translated to the same values. */
+#define PICOQUANT_PICOHARP_T2          0x00010203
+#define PICOQUANT_PICOHARP_T3          0x00010303
+#define PICOQUANT_HYDRAHARP_V1_T2      0x00010204
+#define PICOQUANT_HYDRAHARP_V1_T3      0x00010304
+#define PICOQUANT_HYDRAHARP_V2_T2      0x01010204
+#define PICOQUANT_HYDRAHARP_V2_T3      0x01010304
+#define PICOQUANT_TIMEHARP_260N_T2     0x00010205
+#define PICOQUANT_TIMEHARP_260N_T3     0x00010305
+#define PICOQUANT_TIMEHARP_260P_T2     0x00010206
+#define PICOQUANT_TIMEHARP_260P_T3     0x00010306
+#define PICOQUANT_MULTIHARP_T2         0x00010207
+#define PICOQUANT_MULTIHARP_T3         0x00010307
+
+typedef struct _picoquant_t picoquant_t;
+typedef int (*picoquant_decode_t)(picoquant_t *picoquant,
+		uint32_t const record, photon_t *photon);
+
+struct _picoquant_t {
+	int mode;
+	uint32_t record_type;
+
+	/* Picoseconds per unit of time (t2) or of arrival time (t3). */
+	long long resolution;
+	long long sync_rate;
+	long long records;
+
+	/* Accumulated wraparound of the time (t2) or sync (t3) counter. */
+	long long overflow;
+
+	picoquant_decode_t decode;
+};
+
+picoquant_t *picoquant_alloc(void);
+void picoquant_init(picoquant_t *picoquant);
+void picoquant_free(picoquant_t **picoquant);
+
+int picoquant_header_fread(picoquant_t *picoquant, FILE *stream_in);
+int picoquant_fread(picoquant_t *picoquant, FILE *stream_in, 
+		photon_t *photon);
+int picoquant_map_read(picoquant_t *picoquant, mapped_t *mapped,
+		photon_t *photon);
+
+#endif
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+
+#include "read_ahead.h"
+#include "../error.h"
+#include "../types.h"
+
+/*
+ * Reading and parsing photons is often as expensive as the calculation which
+ * consumes them. To overlap the two, a reader thread decodes photons into a 
+ * ring of batches while the consumer works through the batches already 
+ * decoded. The ring is a single-producer, single-consumer queue: the reader
+ * only advances produced and the consumer only advances consumed, so no lock
+ * is needed. A batch belongs to the reader while it is being filled, and to
+ * the consumer from the moment it is published until it is released.
+ *
+ * The reader stops after the first batch which ends with anything other than
+ * PC_SUCCESS (EOF or an error); that status is handed to the consumer once
+ * the photons before it have been read, and returned from then on.
+ */
+static void *read_ahead_run(void *arg) {
+	read_ahead_t *read_ahead = (read_ahead_t *)arg;
+	read_ahead_batch_t *batch;
+	size_t produced;
+
+	while ( ! atomic_load_explicit(&(read_ahead->stop), 
+			memory_order_relaxed) ) {
+		produced = atomic_load_explicit(&(read_ahead->produced), 
+				memory_order_relaxed);
+
+		if ( produced - atomic_load_explicit(&(read_ahead->consumed),
+				memory_order_acquire) == READ_AHEAD_BATCHES ) {
+			/* The consumer is behind, let it catch up. */
+			sched_yield();
+			continue;
+		}
+
+		batch = &(read_ahead->batches[produced % READ_AHEAD_BATCHES]);
+		batch->status = read_ahead->fill(read_ahead->source, 
+				batch->photons, read_ahead->batch_size, 
+				&(batch->n_photons));
+
+		atomic_store_explicit(&(read_ahead->produced), produced + 1,
+				memory_order_release);
+
+		if ( batch->status != PC_SUCCESS ) {
+			debug("Reader finished with status %d.\n", batch->status);
+			break;
+		}
+	}
+
+	return(NULL);
+}
+
+read_ahead_t *read_ahead_alloc(size_t const batch_size) {
+	read_ahead_t *read_ahead = NULL;
+	size_t i;
+
+	read_ahead = (read_ahead_t *)malloc(sizeof(read_ahead_t));
+
+	if ( read_ahead == NULL ) {
+		return(read_ahead);
+	}
+
+	read_ahead->batch_size = batch_size;
+	read_ahead->running = false;
+
+	for ( i = 0; i < READ_AHEAD_BATCHES; i++ ) {
+		read_ahead->batches[i].photons = NULL;
+	}
+
+	for ( i = 0; i < READ_AHEAD_BATCHES; i++ ) {
+		read_ahead->batches[i].photons = (photon_t *)malloc(
+				sizeof(photon_t)*batch_size);
+
+		if ( read_ahead->batches[i].photons == NULL ) {
+			read_ahead_free(&read_ahead);
+			return(read_ahead);
+		}
+	}
+
+	return(read_ahead);
+}
+
+/*
+ * Start reading from source. Nothing else may touch the source until the 
+ * reader has been freed.
+ */
+int read_ahead_start(read_ahead_t *read_ahead, 
+		read_ahead_fill_t fill, void *source) {
+	read_ahead->fill = fill;
+	read_ahead->source = source;
+
+	atomic_init(&(read_ahead->produced), 0);
+	atomic_init(&(read_ahead->consumed), 0);
+	atomic_init(&(read_ahead->stop), false);
+
+	read_ahead->current = NULL;
+	read_ahead->position = 0;
+	read_ahead->eof = false;
+
+	if ( pthread_create(&(read_ahead->thread), NULL, 
+			read_ahead_run, read_ahead) ) {
+		error("Could not start the reader thread.\n");
+		return(PC_ERROR_UNKNOWN);
+	}
+
+	read_ahead->running = true;
+	return(PC_SUCCESS);
+}
+
+void read_ahead_free(read_ahead_t **read_ahead) {
+	size_t i;
+
+	if ( *read_ahead != NULL ) {
+		if ( (*read_ahead)->running ) {
+			atomic_store(&((*read_ahead)->stop), true);
+			pthread_join((*read_ahead)->thread, NULL);
+		}
+
+		for ( i = 0; i < READ_AHEAD_BATCHES; i++ ) {
+			free((*read_ahead)->batches[i].photons);
+		}
+
+		free(*read_ahead);
+		*read_ahead = NULL;
+	}
+}
+
+/*
+ * Make sure the current batch has photons left to read. If it does not and 
+ * it was the last batch, return its status.
+ */
+static inline int read_ahead_current(read_ahead_t *read_ahead) {
+	size_t consumed;
+
+	while ( read_ahead->current == NULL || 
+			read_ahead->position >= read_ahead->current->n_photons ) {
+		consumed = atomic_load_explicit(&(read_ahead->consumed),
+				memory_order_relaxed);
+
+		if ( read_ahead->current != NULL ) {
+			if ( read_ahead->current->status != PC_SUCCESS ) {
+				read_ahead->eof = read_ahead->current->status == EOF;
+				return(read_ahead->current->status);
+			}
+
+			/* Hand the batch back to the reader. */
+			read_ahead->current = NULL;
+			atomic_store_explicit(&(read_ahead->consumed), ++consumed,
+					memory_order_release);
+		}
+
+		while ( atomic_load_explicit(&(read_ahead->produced), 
+				memory_order_acquire) == consumed ) {
+			sched_yield();
+		}
+
+		read_ahead->current = &(read_ahead->batches[
+				consumed % READ_AHEAD_BATCHES]);
+		read_ahead->position = 0;
+	}
+
+	return(PC_SUCCESS);
+}
+
+int read_ahead_next(read_ahead_t *read_ahead, photon_t *photon) {
+	int result = read_ahead_current(read_ahead);
+
+	if ( result == PC_SUCCESS ) {
+		*photon = read_ahead->current->photons[read_ahead->position++];
+	}
+
+	return(result);
+}
+
+int read_ahead_next_batch(read_ahead_t *read_ahead,
+		photon_t *buffer, size_t const max, size_t *n) {
+	int result = PC_SUCCESS;
+	size_t available;
+
+	*n = 0;
+
+	while ( *n < max ) {
+		result = read_ahead_current(read_ahead);
+
+		if ( result != PC_SUCCESS ) {
+			break;
+		}
+
+		available = read_ahead->current->n_photons - read_ahead->position;
+		if ( available > max - *n ) {
+			available = max - *n;
+		}
+
+		memcpy(&buffer[*n], 
+				&(read_ahead->current->photons[read_ahead->position]),
+				sizeof(photon_t)*available);
+		read_ahead->position += available;
+		*n += available;
+	}
+
+	return(result);
+}
+
+/* As for feof(), true once the consumer has been handed EOF. */
+int read_ahead_eof(read_ahead_t const *read_ahead) {
+	return(read_ahead->eof);
+}
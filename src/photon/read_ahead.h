@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2011-2015, Thomas Bischof
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without 
+ * modification, are permitted provided that the following conditions are met:
+ * 
+ * 1. Redistributions of source code must retain the above copyright notice, 
+ *    this list of conditions and the following disclaimer.
+ * 
+ * 2. Redistributions in binary form must reproduce the above copyright notice, 
+ *    this list of conditions and the following disclaimer in the documentation 
+ *    and/or other materials provided with the distribution.
+ * 
+ * 3. Neither the name of the Massachusetts Institute of Technology nor the 
+ *    names of its contributors may be used to endorse or promote products 
+ *    derived from this software without specific prior written permission.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE 
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR 
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF 
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS 
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN 
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) 
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef READ_AHEAD_H_
+#define READ_AHEAD_H_
+
+#include <stdatomic.h>
+#include <pthread.h>
+
+#include "photon.h"
+
+/* Number of batches which can be decoded ahead of the consumer. */
+#define READ_AHEAD_BATCHES 8
+
+/* Fill buffer with up to max photons, as photon_stream_next_batch does. */
+typedef int (*read_ahead_fill_t)(void *source, 
+		photon_t *buffer, size_t const max, size_t *n);
+
+typedef struct {
+	photon_t *photons;
+	size_t n_photons;
+	int status;
+} read_ahead_batch_t;
+
+typedef struct {
+	read_ahead_fill_t fill;
+	void *source;
+
+	read_ahead_batch_t batches[READ_AHEAD_BATCHES];
+	size_t batch_size;
+
+	/* Batches published by the reader and released by the consumer. Each
+	 * counter is only written by one side. */
+	atomic_size_t produced;
+	atomic_size_t consumed;
+	atomic_int stop;
+
+	read_ahead_batch_t *current;
+	size_t position;
+	int eof;
+
+	pthread_t thread;
+	int running;
+} read_ahead_t;
+
+read_ahead_t *read_ahead_alloc(size_t const batch_size);
+int read_ahead_start(read_ahead_t *read_ahead, 
+		read_ahead_fill_t fill, void *source);
+void read_ahead_free(read_ahead_t **read_ahead);
+
+int read_ahead_next(read_ahead_t *read_ahead, photon_t *photon);
+int read_ahead_next_batch(read_ahead_t *read_ahead,
+		photon_t *buffer, size_t const max, size_t *n);
+int read_ahead_eof(read_ahead_t const *read_ahead);
+
+#endif
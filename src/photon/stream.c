@@ -31,12 +31,14 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 
 #include "stream.h"
 #include "../error.h"
 #include "../types.h"
 
 #include "../modes.h"
+#include "../formats.h"
 #include "t2.h"
 #include "t3.h"
 
@@ -58,7 +60,9 @@
  * iteration routine can be used which does not include that logic. 
  * 
  * To implement the stream, we need a few things:
- * (1) An incoming, unformatted stream (FILE *)
+ * (1) An incoming, unformatted stream (FILE *) and the format of the photons
+ *     it contains (text or binary). If the stream is a regular file, it is
+ *     mapped into memory and the photons are read from the mapping instead.
  * (2) A window (lower, upper)
  * (3) The last photon seen and a flag indicating whether it has been yielded.
  *
@@ -86,7 +90,7 @@
  * while photons is not empty:
  *     yield(next(photons))
  */
-photon_stream_t *photon_stream_alloc(int const mode) {
+photon_stream_t *photon_stream_alloc(int const mode, int const format) {
 	photon_stream_t *photons = NULL;
 
 	photons = (photon_stream_t *)malloc(sizeof(photon_stream_t));
@@ -96,14 +100,17 @@ photon_stream_t *photon_stream_alloc(int const mode) {
 	}
 
 	photons->mode = mode;
+	photons->format = format;
+	photons->picoquant = NULL;
+	photons->compressed = NULL;
+	photons->read_ahead = NULL;
+	photons->stream_in = NULL;
+	mapped_init(&(photons->mapped));
+
 	if ( mode == MODE_T2 ) {
-		photons->photon_next = t2_fscanf;
-		photons->photon_print = t2_fprintf;
 		photons->window_dim = t2_window_dimension;
 		photons->channel_dim = t2_channel_dimension;
 	} else if ( mode == MODE_T3 ) {
-		photons->photon_next = t3_fscanf;
-		photons->photon_print = t3_fprintf;
 		photons->window_dim = t3_window_dimension;
 		photons->channel_dim = t3_channel_dimension;
 	} else {
@@ -112,10 +119,51 @@ photon_stream_t *photon_stream_alloc(int const mode) {
 		return(photons);
 	}
 
+	if ( format == FORMAT_PICOQUANT ) {
+		/* The decoder is configured from the header, in photon_stream_init. 
+		 * These files can only be read, so there is no printer. */
+		photons->picoquant = picoquant_alloc();
+		photons->photon_next = NULL;
+		photons->photon_print = NULL;
+		photons->photon_map_next = NULL;
+
+		if ( photons->picoquant == NULL ) {
+			photon_stream_free(&photons);
+		}
+
+		return(photons);
+	} else if ( format == FORMAT_COMPRESSED ) {
+		/* Blocks of photons are decoded as a whole. The container is 
+		 * written by compressed_writer_t rather than a printer. */
+		photons->compressed = compressed_alloc(mode);
+		photons->photon_next = NULL;
+		photons->photon_print = NULL;
+		photons->photon_map_next = NULL;
+
+		if ( photons->compressed == NULL ) {
+			photon_stream_free(&photons);
+		}
+
+		return(photons);
+	}
+
+	photons->photon_next = photon_next_select(mode, format);
+	photons->photon_print = photon_print_select(mode, format);
+	photons->photon_map_next = photon_map_next_select(mode, format);
+
+	if ( photons->photon_next == NULL || photons->photon_print == NULL ||
+			photons->photon_map_next == NULL ) {
+		photon_stream_free(&photons);
+		return(photons);
+	}
+
 	return(photons);	
 }
 
-void photon_stream_init(photon_stream_t *photons, FILE *stream_in) {
+int photon_stream_init(photon_stream_t *photons, FILE *stream_in) {
+	int result = PC_SUCCESS;
+
+	read_ahead_free(&(photons->read_ahead));
 	photon_stream_set_unwindowed(photons);
 
 	/* If the photon has been yielded, the stream is reset and ready to 
@@ -123,10 +171,37 @@ void photon_stream_init(photon_stream_t *photons, FILE *stream_in) {
 	 */
 	photons->yielded = true;
 	photons->stream_in = stream_in;
+
+	/* A failed header leaves the decoder unconfigured, so reading from
+	 * the stream produces an error rather than garbage. */
+	if ( photons->picoquant != NULL ) {
+		result = picoquant_header_fread(photons->picoquant, stream_in);
+
+		if ( result == PC_SUCCESS && 
+				photons->picoquant->mode != photons->mode ) {
+			error("PicoQuant file contains mode %d, but mode %d was "
+					"requested.\n", photons->picoquant->mode, photons->mode);
+			photons->picoquant->decode = NULL;
+			result = PC_ERROR_MODE;
+		}
+	} else if ( photons->compressed != NULL ) {
+		result = compressed_header_fread(photons->compressed, stream_in);
+	}
+
+	/* The mapping starts wherever the header left the stream. */
+	mapped_close(&(photons->mapped));
+	mapped_open(&(photons->mapped), stream_in);
+
+	return(result);
 }
 
 void photon_stream_free(photon_stream_t **photons) {
 	if ( *photons != NULL ) {
+		/* Stop the reader before its source goes away. */
+		read_ahead_free(&((*photons)->read_ahead));
+		mapped_close(&((*photons)->mapped));
+		picoquant_free(&((*photons)->picoquant));
+		compressed_free(&((*photons)->compressed));
 		free(*photons);
 		*photons = NULL;
 	}
@@ -134,6 +209,7 @@ void photon_stream_free(photon_stream_t **photons) {
 
 void photon_stream_set_unwindowed(photon_stream_t *photons) {
 	photons->photon_stream_next = photon_stream_next_unwindowed;
+	photons->photon_stream_next_batch = photon_stream_next_batch_unwindowed;
 
 	photon_window_init(&(photons->window),
 			1,
@@ -146,11 +222,148 @@ void photon_stream_set_windowed(photon_stream_t *photons,
 		int const set_lower_bound, const long long lower_bound,
 		int const set_upper_bound, const long long upper_bound) {
 	photons->photon_stream_next = photon_stream_next_windowed;
+	photons->photon_stream_next_batch = photon_stream_next_batch_windowed;
 
 	photon_window_init(&(photons->window),
 			bin_width,
 			set_lower_bound, lower_bound,
 			set_upper_bound, upper_bound);
+
+	if ( set_lower_bound ) {
+		photon_stream_seek(photons, lower_bound);
+	}
+}
+
+/*
+ * Limit an otherwise unwindowed stream to the photons in [lower, upper), as a
+ * single window. The stream ends at the upper bound rather than at the end
+ * of the file. A bound which is not set leaves that side of the window open,
+ * so without a lower bound photons at negative times are kept.
+ */
+void photon_stream_set_bounded(photon_stream_t *photons,
+		int const set_lower_bound, long long const lower_bound,
+		int const set_upper_bound, long long const upper_bound) {
+	long long const lower = set_lower_bound ? lower_bound : INT64_MIN;
+	long long const upper = set_upper_bound ? upper_bound : INT64_MAX;
+	long long width;
+
+	if ( ! set_lower_bound && ! set_upper_bound ) {
+		photon_stream_set_unwindowed(photons);
+		return;
+	}
+
+	/* The window never advances, so a width too large to represent can 
+	 * saturate without changing anything. */
+	if ( lower < 0 && upper > INT64_MAX + lower ) {
+		width = INT64_MAX;
+	} else if ( lower > 0 && upper < INT64_MIN + lower ) {
+		width = INT64_MIN;
+	} else {
+		width = upper - lower;
+	}
+
+	photon_stream_set_windowed(photons, width,
+			set_lower_bound, lower_bound,
+			set_upper_bound, upper_bound);
+
+	photons->window.lower = lower;
+	photons->window.upper = upper;
+}
+
+/*
+ * Binary photons have a fixed size, so the records can be searched directly
+ * for the first one in the window.
+ */
+static int photon_stream_seek_binary(photon_stream_t *photons,
+		long long const lower_bound) {
+	mapped_t *mapped = &(photons->mapped);
+	mapped_t probe;
+	photon_t photon;
+	size_t size = photons->mode == MODE_T2 ? T2_BINARY_SIZE : T3_BINARY_SIZE;
+	size_t lower = 0;
+	size_t upper = (mapped->length - mapped->position)/size;
+	size_t middle;
+
+	while ( lower < upper ) {
+		middle = lower + (upper - lower)/2;
+		probe = *mapped;
+		probe.position = mapped->position + middle*size;
+
+		if ( photons->photon_map_next(&probe, &photon) != PC_SUCCESS ) {
+			return(PC_ERROR_IO);
+		}
+
+		if ( photons->window_dim(&photon) < lower_bound ) {
+			lower = middle + 1;
+		} else {
+			upper = middle;
+		}
+	}
+
+	debug("Skipping %zu binary photons.\n", lower);
+	mapped->position += lower*size;
+	return(PC_SUCCESS);
+}
+
+/*
+ * Skip ahead to the first photon at or after lower_bound, in the dimension
+ * used for windowing (time for t2, pulse for t3). This only applies to inputs
+ * which can be searched without reading them, namely mapped binary and 
+ * compressed files; all other streams are left as they are, and the photons
+ * before the bound are discarded as they are read. As for the window, the
+ * photons must be sorted. A failed search leaves the stream where it was, 
+ * so it is never an error to skip the call.
+ *
+ * This is only meant to be used before any photon has been read.
+ */
+int photon_stream_seek(photon_stream_t *photons, long long const lower_bound) {
+	if ( photons->stream_in == NULL || photons->read_ahead != NULL ||
+			! mapped_is_open(&(photons->mapped)) ) {
+		return(PC_SUCCESS);
+	}
+
+	if ( photons->compressed != NULL ) {
+		return(compressed_map_seek(photons->compressed, &(photons->mapped),
+				lower_bound));
+	} else if ( photons->format == FORMAT_BINARY ) {
+		return(photon_stream_seek_binary(photons, lower_bound));
+	} else {
+		return(PC_SUCCESS);
+	}
+}
+
+static inline int photon_stream_read_source(photon_stream_t *photons, 
+		photon_t *photon) {
+	if ( photons->picoquant != NULL ) {
+		if ( mapped_is_open(&(photons->mapped)) ) {
+			return(picoquant_map_read(photons->picoquant, 
+					&(photons->mapped), photon));
+		} else {
+			return(picoquant_fread(photons->picoquant, 
+					photons->stream_in, photon));
+		}
+	} else if ( photons->compressed != NULL ) {
+		if ( mapped_is_open(&(photons->mapped)) ) {
+			return(compressed_map_read(photons->compressed,
+					&(photons->mapped), photon));
+		} else {
+			return(compressed_fread(photons->compressed,
+					photons->stream_in, photon));
+		}
+	} else if ( mapped_is_open(&(photons->mapped)) ) {
+		return(photons->photon_map_next(&(photons->mapped), photon));
+	} else {
+		return(photons->photon_next(photons->stream_in, photon));
+	}
+}
+
+static inline int photon_stream_read(photon_stream_t *photons,
+		photon_t *photon) {
+	if ( photons->read_ahead != NULL ) {
+		return(read_ahead_next(photons->read_ahead, photon));
+	} else {
+		return(photon_stream_read_source(photons, photon));
+	}
 }
 
 int photon_stream_next_windowed(photon_stream_t *photons) {
@@ -186,7 +399,7 @@ int photon_stream_next_windowed(photon_stream_t *photons) {
 				}
 			}
 		} else {
-			result = photons->photon_next(photons->stream_in, &photons->photon);
+			result = photon_stream_read(photons, &photons->photon);
 
 			if ( result == PC_SUCCESS ) {
 				/* Found one, loop back to see where it falls. */
@@ -204,7 +417,7 @@ int photon_stream_next_windowed(photon_stream_t *photons) {
 }
 
 int photon_stream_next_unwindowed(photon_stream_t *photons) {
-	return(photons->photon_next(photons->stream_in, &photons->photon));
+	return(photon_stream_read(photons, &photons->photon));
 }
 
 int photon_stream_next_window(photon_stream_t *photons) {
@@ -215,6 +428,172 @@ int photon_stream_next_photon(photon_stream_t *photon_stream) {
 	return(photon_stream->photon_stream_next(photon_stream));
 }
 
+/*
+ * Rather than yielding one photon at a time, fill a caller-owned buffer with
+ * up to max photons, and report how many were found in n. This avoids the
+ * indirection of photon_stream_next_photon for every photon, and gives the
+ * consumer a contiguous block to work on.
+ *
+ * The return value is PC_SUCCESS if the buffer was filled, and otherwise the
+ * status which stopped the batch (EOF, PC_WINDOW_NEXT, or an error), exactly
+ * as photon_stream_next_photon would have returned it. In either case the
+ * first n photons of the buffer are valid, so a typical loop is:
+ *
+ * do {
+ *     status = photon_stream_next_batch(photons, buffer, max, &n);
+ *     for i in 0..n:
+ *         process(buffer[i])
+ * } while ( status == PC_SUCCESS );
+ */
+int photon_stream_next_batch(photon_stream_t *photons,
+		photon_t *buffer, size_t const max, size_t *n) {
+	return(photons->photon_stream_next_batch(photons, buffer, max, n));
+}
+
+int photon_stream_next_batch_windowed(photon_stream_t *photons,
+		photon_t *buffer, size_t const max, size_t *n) {
+	int result = PC_SUCCESS;
+	size_t i;
+
+	/* A photon which falls outside of the window stays in the stream, so
+	 * the batch ends at the window boundary just as for single photons. */
+	for ( i = 0; i < max; i++ ) {
+		result = photon_stream_next_windowed(photons);
+
+		if ( result != PC_SUCCESS ) {
+			break;
+		}
+
+		buffer[i] = photons->photon;
+	}
+
+	*n = i;
+	return(result);
+}
+
+/*
+ * Read a batch straight from the source, without any window. This is also
+ * what the read-ahead thread uses to fill its batches.
+ */
+static int photon_stream_read_batch(void *source,
+		photon_t *buffer, size_t const max, size_t *n) {
+	photon_stream_t *photons = (photon_stream_t *)source;
+	int result = PC_SUCCESS;
+	size_t i;
+	photon_next_t next = photons->photon_next;
+	photon_map_next_t map_next = photons->photon_map_next;
+	FILE *stream_in = photons->stream_in;
+	mapped_t *mapped = &(photons->mapped);
+
+	if ( photons->picoquant != NULL || photons->compressed != NULL ) {
+		for ( i = 0; i < max; i++ ) {
+			result = photon_stream_read_source(photons, &buffer[i]);
+
+			if ( result != PC_SUCCESS ) {
+				break;
+			}
+		}
+	} else if ( mapped_is_open(mapped) ) {
+		for ( i = 0; i < max; i++ ) {
+			result = map_next(mapped, &buffer[i]);
+
+			if ( result != PC_SUCCESS ) {
+				break;
+			}
+		}
+	} else {
+		for ( i = 0; i < max; i++ ) {
+			result = next(stream_in, &buffer[i]);
+
+			if ( result != PC_SUCCESS ) {
+				break;
+			}
+		}
+	}
+
+	*n = i;
+	return(result);
+}
+
+int photon_stream_next_batch_unwindowed(photon_stream_t *photons,
+		photon_t *buffer, size_t const max, size_t *n) {
+	if ( photons->read_ahead != NULL ) {
+		return(read_ahead_next_batch(photons->read_ahead, buffer, max, n));
+	} else {
+		return(photon_stream_read_batch(photons, buffer, max, n));
+	}
+}
+
+/*
+ * Fill a block with as many photons as it holds, by way of the usual batches.
+ * The return value is as for photon_stream_next_batch.
+ */
+int photon_stream_next_block(photon_stream_t *photons, 
+		photon_block_t *block) {
+	photon_t batch[PHOTON_STREAM_BATCH_SIZE];
+	size_t max;
+	size_t n;
+	int result = PC_SUCCESS;
+
+	photon_block_init(block);
+
+	while ( result == PC_SUCCESS && block->n_photons < block->capacity ) {
+		max = block->capacity - block->n_photons;
+		if ( max > PHOTON_STREAM_BATCH_SIZE ) {
+			max = PHOTON_STREAM_BATCH_SIZE;
+		}
+
+		result = photon_stream_next_batch(photons, batch, max, &n);
+		photon_block_append(block, batch, n);
+	}
+
+	return(result);
+}
+
+/*
+ * Decode photons in a separate thread, so that reading and parsing overlap
+ * with whatever the consumer does with them. The stream behaves exactly as
+ * before, but from here on only the reader thread touches the input. Since
+ * the reader runs ahead of the consumer, this must come after any seek.
+ * Initializing the stream again stops the reader.
+ */
+int photon_stream_read_ahead(photon_stream_t *photons) {
+	int result;
+
+	if ( photons->read_ahead != NULL ) {
+		return(PC_SUCCESS);
+	}
+
+	photons->read_ahead = read_ahead_alloc(PHOTON_STREAM_BATCH_SIZE);
+
+	if ( photons->read_ahead == NULL ) {
+		return(PC_ERROR_MEM);
+	}
+
+	result = read_ahead_start(photons->read_ahead, 
+			photon_stream_read_batch, photons);
+
+	if ( result != PC_SUCCESS ) {
+		read_ahead_free(&(photons->read_ahead));
+	}
+
+	return(result);
+}
+
+/*
+ * A windowed stream ends once it has found a photon past its upper bound, 
+ * even if there are more photons to read.
+ */
 int photon_stream_eof(photon_stream_t *photons) {
-	return(feof(photons->stream_in));
+	if ( photons->window.set_upper_bound && ! photons->yielded &&
+			photons->window_dim(&(photons->photon)) >= 
+				photons->window.upper_bound ) {
+		return(true);
+	} else if ( photons->read_ahead != NULL ) {
+		return(read_ahead_eof(photons->read_ahead));
+	} else if ( mapped_is_open(&(photons->mapped)) ) {
+		return(mapped_eof(&(photons->mapped)));
+	} else {
+		return(feof(photons->stream_in));
+	}
 }
@@ -34,27 +34,43 @@
 
 #include <stdio.h>
 #include "photon.h"
+#include "mapped.h"
+#include "picoquant.h"
+#include "compressed.h"
+#include "read_ahead.h"
+#include "block.h"
 #include "window.h"
 
+/* Default number of photons handed out by photon_stream_next_batch. */
+#define PHOTON_STREAM_BATCH_SIZE 1024
+
 typedef struct _photon_stream_t {
 	FILE *stream_in;
+	mapped_t mapped;
+	picoquant_t *picoquant;
+	compressed_t *compressed;
+	read_ahead_t *read_ahead;
 
 	int mode;
+	int format;
 	photon_t photon;
 	int yielded;
 
 	photon_next_t photon_next;
 	photon_print_t photon_print;
+	photon_map_next_t photon_map_next;
 
 	photon_window_dimension_t window_dim;
 	photon_channel_dimension_t channel_dim;
 	photon_window_t window;
 
 	int (*photon_stream_next)(struct _photon_stream_t *photon_stream);
+	int (*photon_stream_next_batch)(struct _photon_stream_t *photon_stream,
+			photon_t *buffer, size_t const max, size_t *n);
 } photon_stream_t;
 
-photon_stream_t *photon_stream_alloc(int const mode);
-void photon_stream_init(photon_stream_t *photon_stream, FILE *stream_in);
+photon_stream_t *photon_stream_alloc(int const mode, int const format);
+int photon_stream_init(photon_stream_t *photon_stream, FILE *stream_in);
 void photon_stream_free(photon_stream_t **photons);
 
 void photon_stream_set_unwindowed(photon_stream_t *photons);
@@ -62,6 +78,12 @@ void photon_stream_set_windowed(photon_stream_t *photons,
 		long long const bin_width,
 		int const set_lower_bound, long long const lower_bound,
 		int const set_upper_bound, long long const upper_bound);
+void photon_stream_set_bounded(photon_stream_t *photons,
+		int const set_lower_bound, long long const lower_bound,
+		int const set_upper_bound, long long const upper_bound);
+
+int photon_stream_seek(photon_stream_t *photons, long long const lower_bound);
+int photon_stream_read_ahead(photon_stream_t *photons);
 
 int photon_stream_next_photon(photon_stream_t *photons);
 int photon_stream_next_window(photon_stream_t *photons);
@@ -69,6 +91,16 @@ int photon_stream_next_window(photon_stream_t *photons);
 int photon_stream_next_windowed(photon_stream_t *photon_stream);
 int photon_stream_next_unwindowed(photon_stream_t *photon_stream);
 
+int photon_stream_next_batch(photon_stream_t *photons,
+		photon_t *buffer, size_t const max, size_t *n);
+int photon_stream_next_batch_windowed(photon_stream_t *photons,
+		photon_t *buffer, size_t const max, size_t *n);
+int photon_stream_next_batch_unwindowed(photon_stream_t *photons,
+		photon_t *buffer, size_t const max, size_t *n);
+
+int photon_stream_next_block(photon_stream_t *photons, 
+		photon_block_t *block);
+
 int photon_stream_eof(photon_stream_t *photons);
 
 #endif
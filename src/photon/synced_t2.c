@@ -78,15 +78,24 @@ int synced_t2(FILE *stream_in, FILE *stream_out, pc_options_t const *options) {
 	int result = PC_SUCCESS;
 	synced_t2_t *synced_t2 = NULL;
 	photon_stream_t *photon_stream = NULL;
+	photon_print_t print = NULL;
 
 	synced_t2 = synced_t2_alloc(options->queue_size);
-	photon_stream = photon_stream_alloc(MODE_T2);
+	photon_stream = photon_stream_alloc(MODE_T2, options->format);
 	
 	if ( synced_t2 == NULL || photon_stream == NULL ) {
 		result = PC_ERROR_MEM;
 		error("Could not allocate memory for synced t2 run.");
 	}
 
+	if ( result == PC_SUCCESS ) {
+		print = photon_print_select(MODE_T3, options->format_out);
+
+		if ( print == NULL ) {
+			result = PC_ERROR_MODE;
+		}
+	}
+
 	if ( result == PC_SUCCESS ) {
 		photon_stream_init(photon_stream, stream_in);
 		synced_t2_init(synced_t2, options->sync_channel, options->sync_divider);
@@ -95,13 +104,13 @@ int synced_t2(FILE *stream_in, FILE *stream_out, pc_options_t const *options) {
 			synced_t2_push(synced_t2, &(photon_stream->photon));
 
 			while ( synced_t2_next(synced_t2) == PC_SUCCESS )  {
-				t3_fprintf(stream_out, &(synced_t2->photon));
+				print(stream_out, &(synced_t2->photon));
 			}
 		}
 
 		synced_t2_flush(synced_t2);
 		while ( synced_t2_next(synced_t2) == PC_SUCCESS ) { 
-			t3_fprintf(stream_out, &(synced_t2->photon));
+			print(stream_out, &(synced_t2->photon));
 		}
 	}
 
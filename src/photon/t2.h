@@ -35,9 +35,17 @@
 #include <stdio.h>
 
 #include "photon.h"
+#include "mapped.h"
+
+/* channel (uint32), time (int64) */
+#define T2_BINARY_SIZE 12
 
 int t2_fscanf(FILE *stream_in, photon_t *photon);
 int t2_fprintf(FILE *stream_out, photon_t const *photon);
+int t2_fread(FILE *stream_in, photon_t *photon);
+int t2_fwrite(FILE *stream_out, photon_t const *photon);
+int t2_map_scan(mapped_t *mapped, photon_t *photon);
+int t2_map_read(mapped_t *mapped, photon_t *photon);
 
 int t2_compare(void const *a, void const *b);
 int t2_echo(FILE *stream_in, FILE *stream_out);
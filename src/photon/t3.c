@@ -30,19 +30,22 @@
  */
 
 #include "t3.h"
+#include "binary.h"
+#include "text.h"
 #include "../error.h"
+#include "../output.h"
 
 /* 
  * Functions to implement t3 photon read/write.
  */
 int t3_fscanf(FILE *stream_in, photon_t *photon) {
-	int n_read = fscanf(stream_in,
-			"%u,%lld,%lld\n",
-			&(photon->t3.channel),
-			&(photon->t3.pulse),
-			&(photon->t3.time));
-
-	if ( n_read == 3 ) {
+	/* Equivalent to fscanf(stream_in, "%u,%lld,%lld\n", ...) */
+	if ( text_scan_unsigned(stream_in, &(photon->t3.channel)) &&
+			text_scan_literal(stream_in, ',') &&
+			text_scan_long_long(stream_in, &(photon->t3.pulse)) &&
+			text_scan_literal(stream_in, ',') &&
+			text_scan_long_long(stream_in, &(photon->t3.time)) ) {
+		text_skip_space(stream_in);
 		return(PC_SUCCESS);
 	} else {
 		if ( feof(stream_in) ) { 
@@ -54,13 +57,78 @@ int t3_fscanf(FILE *stream_in, photon_t *photon) {
 }
 
 int t3_fprintf(FILE *stream_out, photon_t const *photon) {
-	fprintf(stream_out,
-			"%u,%lld,%lld\n",
-			photon->t3.channel,
-			photon->t3.pulse,
-			photon->t3.time);
+	/* Equivalent to fprintf(stream_out, "%u,%lld,%lld\n", ...) */
+	output_t output;
+
+	output_init(&output, stream_out);
+
+	if ( output_unsigned(&output, photon->t3.channel) != PC_SUCCESS ||
+			output_char(&output, ',') != PC_SUCCESS ||
+			output_long_long(&output, photon->t3.pulse) != PC_SUCCESS ||
+			output_char(&output, ',') != PC_SUCCESS ||
+			output_long_long(&output, photon->t3.time) != PC_SUCCESS ||
+			output_char(&output, '\n') != PC_SUCCESS ) {
+		return(PC_ERROR_IO);
+	}
+
+	return(output_flush(&output));
+}
+
+int t3_fread(FILE *stream_in, photon_t *photon) {
+	unsigned char record[T3_BINARY_SIZE];
+	size_t n_read = fread(record, 1, T3_BINARY_SIZE, stream_in);
+
+	if ( n_read == T3_BINARY_SIZE ) {
+		photon->t3.channel = binary_unpack_uint32(&record[0]);
+		photon->t3.pulse = binary_unpack_int64(&record[4]);
+		photon->t3.time = binary_unpack_int64(&record[12]);
+		return(PC_SUCCESS);
+	} else {
+		/* A partial record means the file was truncated. */
+		return( n_read == 0 && feof(stream_in) ? EOF : PC_ERROR_IO );
+	}
+}
+
+int t3_fwrite(FILE *stream_out, photon_t const *photon) {
+	unsigned char record[T3_BINARY_SIZE];
 
-	return( ! ferror(stream_out) ? PC_SUCCESS : PC_ERROR_IO );
+	binary_pack_uint32(&record[0], photon->t3.channel);
+	binary_pack_int64(&record[4], photon->t3.pulse);
+	binary_pack_int64(&record[12], photon->t3.time);
+
+	return( fwrite(record, 1, T3_BINARY_SIZE, stream_out) == T3_BINARY_SIZE ?
+			PC_SUCCESS : PC_ERROR_IO );
+}
+
+int t3_map_scan(mapped_t *mapped, photon_t *photon) {
+	if ( text_map_scan_unsigned(mapped, &(photon->t3.channel)) &&
+			text_map_scan_literal(mapped, ',') &&
+			text_map_scan_long_long(mapped, &(photon->t3.pulse)) &&
+			text_map_scan_literal(mapped, ',') &&
+			text_map_scan_long_long(mapped, &(photon->t3.time)) ) {
+		text_map_skip_space(mapped);
+		return(PC_SUCCESS);
+	} else {
+		return( mapped_eof(mapped) ? EOF : PC_ERROR_IO );
+	}
+}
+
+int t3_map_read(mapped_t *mapped, photon_t *photon) {
+	unsigned char const *record = &(mapped->data[mapped->position]);
+	size_t remaining = mapped->length - mapped->position;
+
+	if ( remaining >= T3_BINARY_SIZE ) {
+		photon->t3.channel = binary_unpack_uint32(&record[0]);
+		photon->t3.pulse = binary_unpack_int64(&record[4]);
+		photon->t3.time = binary_unpack_int64(&record[12]);
+		mapped->position += T3_BINARY_SIZE;
+		return(PC_SUCCESS);
+	} else {
+		/* A partial record means the file was truncated. */
+		mapped->position = mapped->length;
+		mapped->eof = 1;
+		return( remaining == 0 ? EOF : PC_ERROR_IO );
+	}
 }
 
 int t3_compare(void const *a, void const *b) {
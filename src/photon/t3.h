@@ -35,9 +35,17 @@
 #include <stdio.h>
 
 #include "photon.h"
+#include "mapped.h"
+
+/* channel (uint32), pulse (int64), time (int64) */
+#define T3_BINARY_SIZE 20
 
 int t3_fscanf(FILE *stream_out, photon_t *photon);
 int t3_fprintf(FILE *stream_out, photon_t const *photon);
+int t3_fread(FILE *stream_in, photon_t *photon);
+int t3_fwrite(FILE *stream_out, photon_t const *photon);
+int t3_map_scan(mapped_t *mapped, photon_t *photon);
+int t3_map_read(mapped_t *mapped, photon_t *photon);
 
 int t3_compare(void const *a, void const *b);
 int t3_echo(FILE *stream_in, FILE *stream_out);
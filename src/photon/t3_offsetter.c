@@ -169,15 +169,24 @@ int t3_offsets(FILE *stream_in, FILE *stream_out, pc_options_t const *options) {
 
 	t3_offsetter_t *offsetter;
 	photon_stream_t *photons;
+	photon_print_t print = NULL;
 
 	offsetter = t3_offsetter_alloc(options->channels, options->queue_size);
-	photons = photon_stream_alloc(MODE_T3);
+	photons = photon_stream_alloc(MODE_T3, options->format);
 
 	if ( offsetter == NULL || photons == NULL ) {
 		error("Could not allocate memory for offsetter or photon stream.\n");
 		result = PC_ERROR_MEM;
 	}
 
+	if ( result == PC_SUCCESS ) {
+		print = photon_print_select(MODE_T3, options->format_out);
+
+		if ( print == NULL ) {
+			result = PC_ERROR_MODE;
+		}
+	}
+
 	photon_stream_init(photons, stream_in);
 	t3_offsetter_init(offsetter, options->offset_time, options->time_offsets,
 			options->repetition_rate);
@@ -187,14 +196,14 @@ int t3_offsets(FILE *stream_in, FILE *stream_out, pc_options_t const *options) {
 		t3_offsetter_push(offsetter, &(photons->photon));
 
 		while ( t3_offsetter_next(offsetter) == PC_SUCCESS ) {
-			t3_fprintf(stream_out, &(offsetter->photon));
+			print(stream_out, &(offsetter->photon));
 		}
 	}
 
 	if ( result == PC_SUCCESS ) {
 		t3_offsetter_flush(offsetter);
 		while ( t3_offsetter_next(offsetter) == PC_SUCCESS ) {
-			t3_fprintf(stream_out, &(offsetter->photon));
+			print(stream_out, &(offsetter->photon));
 		}
 	}
 
@@ -39,7 +39,8 @@
 #include "t3.h"
 
 photon_stream_temper_t *photon_stream_temper_alloc(int const mode,
-		unsigned int const channels, size_t const queue_length) {
+		int const format, unsigned int const channels, 
+		size_t const queue_length) {
 	photon_stream_temper_t *pst = NULL;
 
 	pst = (photon_stream_temper_t *)malloc(sizeof(photon_stream_temper_t));
@@ -50,18 +51,18 @@ photon_stream_temper_t *photon_stream_temper_alloc(int const mode,
 
 	pst->mode = mode;
 	pst->channels = channels;
+
+	pst->suppressed_channels = NULL;
+	pst->offsets = NULL;
+	pst->queue = NULL;
 	
 	if ( pst->mode == MODE_T2 ) {
 		debug("Mode t2\n");
-		pst->photon_next = t2_fscanf;
-		pst->photon_print = t2_fprintf;
 		pst->photon_offset = t2_offset;
 		pst->channel_dim = t2_channel_dimension;
 		pst->window_dim = t2_window_dimension;
 	} else if ( pst->mode == MODE_T3 ) {
 		debug("Mode t3.\n");
-		pst->photon_next = t3_fscanf;
-		pst->photon_print = t3_fprintf;
 		pst->photon_offset = t3_offset;
 		pst->channel_dim = t3_channel_dimension;
 		pst->window_dim = t3_window_dimension;
@@ -71,6 +72,13 @@ photon_stream_temper_t *photon_stream_temper_alloc(int const mode,
 		return(pst);
 	}
 
+	pst->photon_next = photon_next_select(mode, format);
+
+	if ( pst->photon_next == NULL ) {
+		photon_stream_temper_free(&pst);
+		return(pst);
+	}
+
 	pst->yielded_all_sorted = 1;
 
 	pst->suppress_channels = false;
@@ -301,12 +309,19 @@ int photon_temper(FILE *stream_in, FILE *stream_out,
 	photon_stream_temper_t *pst;
 
 	debug("Allocating offset photon stream.\n");
-	pst = photon_stream_temper_alloc(options->mode, options->channels,
-			options->queue_size);
+	pst = photon_stream_temper_alloc(options->mode, options->format,
+			options->channels, options->queue_size);
 
 	if ( pst == NULL ) {
 		result = PC_ERROR_MEM;
-	} 
+	} else {
+		pst->photon_print = photon_print_select(options->mode, 
+				options->format_out);
+
+		if ( pst->photon_print == NULL ) {
+			result = PC_ERROR_MODE;
+		}
+	}
 
 	if ( result == PC_SUCCESS ) {
 		photon_stream_temper_init(pst, stream_in,
@@ -71,8 +71,9 @@ typedef struct {
 	photon_window_dimension_t window_dim;
 } photon_stream_temper_t;
 
-photon_stream_temper_t *photon_stream_temper_t_alloc(int const mode,
-		unsigned int const channels, size_t const queue_length);
+photon_stream_temper_t *photon_stream_temper_alloc(int const mode,
+		int const format, unsigned int const channels, 
+		size_t const queue_length);
 void photon_stream_temper_init(photon_stream_temper_t *pst,
 		FILE *stream_in, 
 		int const filter_afterpulsing,
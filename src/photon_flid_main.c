@@ -80,6 +80,7 @@ int main(int argc, char *argv[]) {
 "to exhibit a peak near this value.\n",
 		{OPT_VERBOSE, OPT_HELP, OPT_VERSION, 
 			OPT_FILE_IN, OPT_FILE_OUT, 
+			OPT_FORMAT,
 			OPT_WINDOW_WIDTH, OPT_TIME, OPT_INTENSITY,
 			OPT_EOF}};
 
@@ -32,18 +32,32 @@
 #include "photon_intensity_correlate.h"
 
 #include "correlation/multi_tau.h"
+#include "correlation/multi_tau_pool.h"
+#include "correlation/fft_g2.h"
+#include "histogram/histogram_gn.h"
 #include "statistics/intensity.h"
 #include "modes.h"
 #include "photon/stream.h"
 #include "error.h"
 
+static void photon_intensity_correlate_push(multi_tau_pool_t *pool, 
+		multi_tau_g2c1_t *mt1, intensity_photon_t const *intensity) {
+	if ( mt1 != NULL ) {
+		multi_tau_g2c1_push_empty(mt1, intensity->empty);
+		multi_tau_g2c1_push(mt1, intensity->counts);
+	} else {
+		multi_tau_pool_push(pool, intensity->counts, intensity->empty);
+	}
+}
+
 int photon_intensity_correlate_g2_log(FILE *stream_in, FILE *stream_out,
 		pc_options_t const *options) {
 	int result = PC_SUCCESS;
 	long long bin_width;
 	intensity_photon_t *intensity;
 	photon_stream_t *photon_stream;
-	multi_tau_g2cn_t *mt;
+	multi_tau_pool_t *pool = NULL;
+	multi_tau_g2c1_t *mt1 = NULL;
 
 	debug("Allocating intensity, photon stream.\n");
 	bin_width = options->bin_width;
@@ -56,10 +70,98 @@ int photon_intensity_correlate_g2_log(FILE *stream_in, FILE *stream_out,
 	}
 
 	intensity = intensity_photon_alloc(options->channels, options->mode);
-	photon_stream = photon_stream_alloc(options->mode);
-	mt = multi_tau_g2cn_alloc(options->binning, options->registers,
-			options->depth, options->channels, bin_width);
+	photon_stream = photon_stream_alloc(options->mode, options->format);
+
+	/* A single channel has integer counts at the first level, which the 
+	 * dedicated correlator exploits. Otherwise, the pairs of channels are
+	 * split between the threads. */
+	if ( options->channels == 1 ) {
+		mt1 = multi_tau_g2c1_alloc(options->binning, options->registers,
+				options->depth, bin_width);
+	} else {
+		pool = multi_tau_pool_alloc(options->threads, 
+				options->binning, options->registers,
+				options->depth, options->channels, bin_width);
+	}
+
+	if ( intensity == NULL || photon_stream == NULL || 
+			(pool == NULL && mt1 == NULL) ) {
+		error("Could not allocate intensity or photon stream.\n");
+		result = PC_ERROR_MEM;
+	} 
+
+	if ( result == PC_SUCCESS && pool != NULL ) {
+		result = multi_tau_pool_start(pool);
+	}
+
+	if ( result == PC_SUCCESS ) {
+		debug("Initializing.\n");
+		intensity_photon_init(intensity,
+				false,
+				bin_width,
+				options->set_start, options->start,
+				options->set_stop, options->stop);
+		/* Runs of empty bins cost the correlator only O(depth), so there
+		 * is no need to see them one at a time. */
+		intensity_photon_skip_empty(intensity, true);
+
+		photon_stream_init(photon_stream, stream_in);
+		if ( mt1 != NULL ) {
+			multi_tau_g2c1_init(mt1);
+		} else {
+			multi_tau_pool_init(pool);
+		}
+
+		while ( photon_stream_next_photon(photon_stream) == PC_SUCCESS ) {
+			intensity_photon_push(intensity, &(photon_stream->photon));
+	
+			while ( intensity_photon_next(intensity) == PC_SUCCESS ) {
+				photon_intensity_correlate_push(pool, mt1, intensity);
+			}
+		}
+	
+		intensity_photon_flush(intensity);
+		while ( intensity_photon_next(intensity) == PC_SUCCESS ) {
+			photon_intensity_correlate_push(pool, mt1, intensity);
+		}
 
+		if ( mt1 != NULL ) {
+			multi_tau_g2c1_fprintf(stream_out, mt1);
+		} else {
+			multi_tau_pool_fprintf(stream_out, pool);
+		}
+	}
+
+	debug("Cleaning up.\n");
+	intensity_photon_free(&intensity);
+	photon_stream_free(&photon_stream);
+	multi_tau_pool_free(&pool);
+	multi_tau_g2c1_free(&mt1);
+	return(PC_SUCCESS);
+}
+
+int photon_intensity_correlate_g3_log(FILE *stream_in, FILE *stream_out,
+		pc_options_t const *options) {
+	int result = PC_SUCCESS;
+	long long bin_width;
+	intensity_photon_t *intensity;
+	photon_stream_t *photon_stream;
+	multi_tau_g3cn_t *mt;
+
+	debug("Allocating intensity, photon stream.\n");
+	bin_width = options->bin_width;
+	if ( bin_width == 0 ) {
+		if ( options->mode == MODE_T2 ) {
+			bin_width = 10000000;
+		} else {
+			bin_width = 100;
+		}
+	}
+
+	intensity = intensity_photon_alloc(options->channels, options->mode);
+	photon_stream = photon_stream_alloc(options->mode, options->format);
+	mt = multi_tau_g3cn_alloc(options->binning, options->registers,
+			options->depth, options->channels, bin_width);
 
 	if ( intensity == NULL || photon_stream == NULL || mt == NULL ) {
 		error("Could not allocate intensity or photon stream.\n");
@@ -73,38 +175,113 @@ int photon_intensity_correlate_g2_log(FILE *stream_in, FILE *stream_out,
 				bin_width,
 				options->set_start, options->start,
 				options->set_stop, options->stop);
+		intensity_photon_skip_empty(intensity, true);
 
 		photon_stream_init(photon_stream, stream_in);
-		multi_tau_g2cn_init(mt);
+		multi_tau_g3cn_init(mt);
 
 		while ( photon_stream_next_photon(photon_stream) == PC_SUCCESS ) {
 			intensity_photon_push(intensity, &(photon_stream->photon));
 	
 			while ( intensity_photon_next(intensity) == PC_SUCCESS ) {
-				multi_tau_g2cn_push(mt, intensity->counts);
+				multi_tau_g3cn_push_empty(mt, intensity->empty);
+				multi_tau_g3cn_push(mt, intensity->counts);
 			}
 		}
 	
 		intensity_photon_flush(intensity);
 		while ( intensity_photon_next(intensity) == PC_SUCCESS ) {
-			multi_tau_g2cn_push(mt, intensity->counts);
+			multi_tau_g3cn_push_empty(mt, intensity->empty);
+			multi_tau_g3cn_push(mt, intensity->counts);
 		}
 
-		multi_tau_g2cn_fprintf(stream_out, mt);
+		multi_tau_g3cn_fprintf(stream_out, mt);
 	}
 
 	debug("Cleaning up.\n");
 	intensity_photon_free(&intensity);
 	photon_stream_free(&photon_stream);
-	multi_tau_g2cn_free(&mt);
+	multi_tau_g3cn_free(&mt);
 	return(PC_SUCCESS);
 }
 	
+int photon_intensity_correlate_g2_linear(FILE *stream_in, FILE *stream_out,
+		pc_options_t const *options) {
+	int result = PC_SUCCESS;
+	intensity_photon_t *intensity;
+	photon_stream_t *photon_stream;
+	histogram_gn_t *hist;
+	fft_g2_t *g2;
+
+	if ( options->time_scale != SCALE_LINEAR ) {
+		error("Time limits are only used for a linear time scale.\n");
+		return(PC_ERROR_OPTIONS);
+	}
+
+	debug("Allocating intensity, photon stream, histogram.\n");
+	intensity = intensity_photon_alloc(options->channels, options->mode);
+	photon_stream = photon_stream_alloc(options->mode, options->format);
+	hist = histogram_gn_alloc(MODE_T2, 2, options->channels,
+			SCALE_LINEAR, &(options->time_limits),
+			SCALE_LINEAR, &(options->pulse_limits),
+			0, NULL);
+	g2 = fft_g2_alloc(options->channels, &(options->time_limits));
+
+	if ( intensity == NULL || photon_stream == NULL || hist == NULL ||
+			g2 == NULL ) {
+		error("Could not allocate intensity, photon stream or "
+				"histogram.\n");
+		result = PC_ERROR_MEM;
+	} 
+
+	if ( result == PC_SUCCESS ) {
+		debug("Initializing.\n");
+		/* The intensity bins are the bins of the histogram. */
+		intensity_photon_init(intensity,
+				false,
+				g2->bin_width,
+				options->set_start, options->start,
+				options->set_stop, options->stop);
+
+		photon_stream_init(photon_stream, stream_in);
+		histogram_gn_init(hist);
+
+		while ( photon_stream_next_photon(photon_stream) == PC_SUCCESS ) {
+			intensity_photon_push(intensity, &(photon_stream->photon));
+	
+			while ( intensity_photon_next(intensity) == PC_SUCCESS ) {
+				fft_g2_push(g2, hist, intensity->counts);
+			}
+		}
+	
+		intensity_photon_flush(intensity);
+		while ( intensity_photon_next(intensity) == PC_SUCCESS ) {
+			fft_g2_push(g2, hist, intensity->counts);
+		}
+
+		fft_g2_flush(g2, hist);
+		result = hist->print(stream_out, hist);
+	}
+
+	debug("Cleaning up.\n");
+	intensity_photon_free(&intensity);
+	photon_stream_free(&photon_stream);
+	histogram_gn_free(&hist);
+	fft_g2_free(&g2);
+	return(result);
+}
+	
 int photon_intensity_correlate_dispatch(FILE *stream_in, FILE *stream_out,
 		pc_options_t const *options) {
-	if ( options->order == 2 ) {
+	if ( options->order == 2 && options->time_string != NULL ) {
+		return(photon_intensity_correlate_g2_linear(stream_in, stream_out,
+				options));
+	} else if ( options->order == 2 ) {
 		return(photon_intensity_correlate_g2_log(stream_in, stream_out, 
 				options));
+	} else if ( options->order == 3 && options->time_string == NULL ) {
+		return(photon_intensity_correlate_g3_log(stream_in, stream_out, 
+				options));
 	} else {
 		error("Unsupported mode: order %d\n", options->order);
 		return(PC_ERROR_OPTIONS);
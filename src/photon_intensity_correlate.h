@@ -37,6 +37,10 @@
 
 int photon_intensity_correlate_g2_log(FILE *stream_in, FILE *stream_out, 
 		pc_options_t const *options);
+int photon_intensity_correlate_g3_log(FILE *stream_in, FILE *stream_out, 
+		pc_options_t const *options);
+int photon_intensity_correlate_g2_linear(FILE *stream_in, FILE *stream_out, 
+		pc_options_t const *options);
 int photon_intensity_correlate_dispatch(FILE *stream_in, FILE *stream_out, 
 		pc_options_t const *options);
 
@@ -50,14 +50,25 @@ int main(int argc, char *argv[]) {
 "rescales (the depth). This way, each time bin for the correlation is only\n"
 "sampled as often as necessary, ensuring that reasonable signal-to-noise\n"
 "can be obtained at all time scales without requiring significant duplication\n"
-"of effort.\n",
+"of effort.\n"
+"\n"
+"If time limits are given, the correlation is instead calculated at every\n"
+"lag of a linear histogram, with the bins of the histogram as the intensity\n"
+"bins, by Fourier transform. The result is the sum of products of counts\n"
+"for each lag, in the same form as the histograms of photon_gn.\n"
+"\n"
+"For order 3, each level correlates the newest bin of the first channel with\n"
+"the other two at every pair of delays held in its registers, giving a\n"
+"logarithmic grid in both delays. Each row holds the three channels, the\n"
+"limits of both delays, and the correlation.\n",
 		{OPT_VERBOSE, OPT_HELP, OPT_VERSION,
 			OPT_FILE_IN, OPT_FILE_OUT,
+			OPT_FORMAT, OPT_THREADS,
 			OPT_CHANNELS, OPT_ORDER,
 			OPT_MODE, 
 			OPT_START, OPT_STOP,
 			OPT_BIN_WIDTH,
-			OPT_TIME_SCALE,
+			OPT_TIME, OPT_TIME_SCALE,
 			OPT_BINNING, OPT_REGISTERS, OPT_DEPTH,
 			OPT_EOF}};
 
@@ -65,6 +65,7 @@ int main(int argc, char *argv[]) {
 "data to perform the accumulation.",
 		{OPT_VERBOSE, OPT_HELP, OPT_VERSION, 
 			OPT_FILE_IN, OPT_FILE_OUT, 
+			OPT_FORMAT,
 			OPT_MODE, OPT_CHANNELS, OPT_ORDER,
 			OPT_QUEUE_SIZE,
 			OPT_WINDOW_WIDTH, 
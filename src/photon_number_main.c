@@ -45,6 +45,7 @@ int main(int argc, char *argv[]) {
 "to the time span between pulses. \n",
 		{OPT_VERBOSE, OPT_HELP, OPT_VERSION,
 			OPT_FILE_IN, OPT_FILE_OUT,
+			OPT_FORMAT,
 			OPT_CHANNELS, 
 			OPT_START, OPT_STOP,
 			OPT_EOF}};
@@ -39,6 +39,7 @@ int main(int argc, char *argv[]) {
 "that many photons.\n",
 		{OPT_VERBOSE, OPT_HELP, OPT_VERSION,
 			OPT_FILE_IN, OPT_FILE_OUT,
+			OPT_FORMAT, OPT_FORMAT_OUT,
 			OPT_MODE, OPT_THRESHOLD, OPT_WINDOW_WIDTH,
 			OPT_EOF}};
 
@@ -46,6 +46,7 @@ int main(int argc, char *argv[]) {
 "mapped to 2, and the corresponding second photon is mapped to channel 3.",
 		{OPT_VERBOSE, OPT_HELP, OPT_VERSION,
 			OPT_FILE_IN, OPT_FILE_OUT,
+			OPT_FORMAT, OPT_FORMAT_OUT,
 			OPT_TIME_THRESHOLD, OPT_CORRELATE_SUCCESSIVE, OPT_QUEUE_SIZE,
 			OPT_EOF}};
 
@@ -48,6 +48,7 @@ int main(int argc, char *argv[]) {
 "full signal.\n",
 		{OPT_VERBOSE, OPT_HELP, OPT_VERSION,
 			OPT_FILE_IN, OPT_FILE_OUT,
+			OPT_FORMAT, OPT_FORMAT_OUT,
 			OPT_MODE, OPT_CONVERT, OPT_TIME_ORIGIN,
 			OPT_REPETITION_TIME, OPT_COPY_TO_CHANNEL,
 			OPT_EOF}};
@@ -385,7 +385,7 @@ int bin_intensity(FILE *stream_in, FILE *stream_out,
 	photon_stream_t *photons;
 	bin_intensity_t *bin_intensity;
 
-	photons = photon_stream_alloc(options->mode);
+	photons = photon_stream_alloc(options->mode, options->format);
 	bin_intensity = bin_intensity_alloc(options->mode, options->order,
 			options->channels,
 			&(options->time_limits), options->time_scale,
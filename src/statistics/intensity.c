@@ -38,6 +38,7 @@
 #include "../photon/t3.h"
 #include "../photon/stream.h"
 #include "../error.h"
+#include "../output.h"
 
 /*
  * Due to the need to have a system where a photon stream can be analyzed in
@@ -109,6 +110,8 @@ intensity_photon_t *intensity_photon_alloc(unsigned int const channels,
 	}
 
 	intensity->channels = channels;
+	intensity->skip_empty = false;
+	intensity->empty = 0;
 	intensity->counts = counts_alloc(intensity->channels);
 
 	if ( intensity->counts == NULL ) {
@@ -130,6 +133,7 @@ void intensity_photon_init(intensity_photon_t *intensity,
 	intensity->record_available = false;
 	intensity->last_window_seen = 0;
 	intensity->yielded = false;
+	intensity->empty = 0;
 
 	intensity_photon_counts_init(intensity);
 
@@ -160,6 +164,11 @@ void intensity_photon_counts_init(intensity_photon_t *intensity) {
 	counts_init(intensity->counts);
 }
 
+void intensity_photon_skip_empty(intensity_photon_t *intensity, 
+		int const skip_empty) {
+	intensity->skip_empty = skip_empty;
+}
+
 void intensity_photon_free(intensity_photon_t **intensity) {
 	if ( *intensity != NULL ) {
 		counts_free(&(*intensity)->counts);
@@ -234,6 +243,32 @@ int intensity_photon_increment(intensity_photon_t *intensity,
 	return(counts_increment(intensity->counts, channel));
 }
 
+static void intensity_photon_skip_windows(intensity_photon_t *intensity) {
+/* Move the window directly to the one holding the held photon, counting the
+ * empty windows passed over. Photons past the upper bound are left to the 
+ * usual handling. */
+	long long const window = intensity->window_dim(&(intensity->photon));
+	photon_window_t *bins = &(intensity->window);
+	long long skipped;
+
+	if ( (bins->set_upper_bound && bins->upper_bound <= window) ||
+			window < bins->upper ) {
+		return;
+	}
+
+	skipped = (window - bins->lower)/bins->width;
+	bins->lower += skipped*bins->width;
+	bins->upper = bins->lower + bins->width;
+
+	if ( bins->set_upper_bound && bins->upper > bins->upper_bound ) {
+		bins->upper = bins->upper_bound;
+	}
+
+	intensity->counts->lower = bins->lower;
+	intensity->counts->upper = bins->upper;
+	intensity->empty = skipped;
+}
+
 int intensity_photon_next_from_photon(intensity_photon_t *intensity) {
 	int result = PC_SUCCESS;
 
@@ -247,6 +282,11 @@ int intensity_photon_next_from_photon(intensity_photon_t *intensity) {
 
 		intensity->yielded = false;
 		intensity->record_available = false;
+		intensity->empty = 0;
+
+		if ( intensity->skip_empty && intensity->photon_held ) {
+			intensity_photon_skip_windows(intensity);
+		}
 	}
 
 	if ( intensity->record_available ) {
@@ -297,7 +337,27 @@ int intensity_photon_next_from_photon(intensity_photon_t *intensity) {
 }
 
 int intensity_photon_next_from_stream(intensity_photon_t *intensity) {
-	return(intensity_photon_fscanf(intensity->stream_in, intensity));
+	int result;
+
+	intensity->empty = 0;
+	result = intensity_photon_fscanf(intensity->stream_in, intensity);
+
+	while ( intensity->skip_empty && result == PC_SUCCESS &&
+			! counts_nonzero(intensity->counts) ) {
+		intensity->empty++;
+		result = intensity_photon_fscanf(intensity->stream_in, intensity);
+	}
+
+	if ( result == EOF && intensity->empty > 0 ) {
+		/* The stream ended with empty bins, so the last of them stands in
+		 * as the record. */
+		intensity->empty--;
+		memset(intensity->counts->counts, 0, 
+				sizeof(unsigned long long)*intensity->channels);
+		result = PC_SUCCESS;
+	}
+
+	return(result);
 }
 
 int intensity_photon_next(intensity_photon_t *intensity) {
@@ -343,41 +403,81 @@ int intensity_photon_fscanf(FILE *stream_in, intensity_photon_t *intensity) {
 int intensity_photon_fprintf(FILE *stream_out, 
 		intensity_photon_t const *intensity) {
 	int i;
+	output_t output;
 
-	fprintf(stream_out, 
-			"%lld,%lld",
-			intensity->counts->lower,
-			intensity->counts->upper);
+	output_init(&output, stream_out);
 
-	if ( ferror(stream_out) ) {
+	if ( output_long_long(&output, intensity->counts->lower) != PC_SUCCESS ||
+			output_char(&output, ',') != PC_SUCCESS ||
+			output_long_long(&output, intensity->counts->upper) 
+				!= PC_SUCCESS ) {
 		return(PC_ERROR_IO);
 	}
 
 	for ( i = 0; i < intensity->channels; i++ ) {
-		fprintf(stream_out,
-				",%llu",
-				intensity->counts->counts[i]);
-	
-		if ( ferror(stream_out) ) {
+		if ( output_char(&output, ',') != PC_SUCCESS ||
+				output_unsigned(&output, intensity->counts->counts[i]) 
+					!= PC_SUCCESS ) {
 			return(PC_ERROR_IO);
 		}
 	}
 
-	fprintf(stream_out, "\n");
+	if ( output_char(&output, '\n') != PC_SUCCESS ) {
+		return(PC_ERROR_IO);
+	}
 
-	return(PC_SUCCESS);
+	return(output_flush(&output));
 }
 	
 
+/*
+ * With --count-all there is only one window, so the photons can be counted
+ * in bulk. The window runs from the first photon to just past the last, as
+ * it does when the photons are pushed one at a time.
+ */
+static int intensity_photon_count_all(intensity_photon_t *intensity,
+		photon_stream_t *photon_stream, photon_block_t *block) {
+	int result = PC_SUCCESS;
+	int status;
+	long long const *window;
+
+	do {
+		status = photon_stream_next_block(photon_stream, block);
+
+		if ( block->n_photons == 0 ) {
+			continue;
+		}
+
+		result = photon_block_count(block, intensity->counts->counts,
+				intensity->channels);
+		window = photon_block_window_dim(block);
+
+		if ( ! intensity->first_photon_seen ) {
+			intensity->counts->lower = window[0];
+			intensity->first_photon_seen = true;
+		}
+
+		intensity->counts->upper = window[block->n_photons-1] + 1;
+	} while ( result == PC_SUCCESS && status == PC_SUCCESS );
+
+	return(result);
+}
+
 int intensity_photon(FILE *stream_in, FILE *stream_out, 
 		pc_options_t const *options) {
 	int result = PC_SUCCESS;
+	int status;
 	intensity_photon_t *intensity;
 	photon_stream_t *photon_stream;
+	photon_block_t *block = NULL;
+
+	photon_t batch[PHOTON_STREAM_BATCH_SIZE];
+	size_t n_photons;
+	size_t i;
 
 	debug("Allocating intensity, photon stream.\n");
 	intensity = intensity_photon_alloc(options->channels, options->mode);
-	photon_stream = photon_stream_alloc(options->mode);
+	photon_stream = photon_stream_alloc(options->mode, options->format);
 
 	if ( intensity == NULL || photon_stream == NULL ) {
 		error("Could not allocate intensity or photon stream.\n");
@@ -401,14 +501,39 @@ int intensity_photon(FILE *stream_in, FILE *stream_out,
 
 	photon_stream_init(photon_stream, stream_in);
 
-	if ( result == PC_SUCCESS ) {
-		while ( photon_stream_next_photon(photon_stream) == PC_SUCCESS ) {
-			intensity_photon_push(intensity, &(photon_stream->photon));
+	photon_stream_set_bounded(photon_stream,
+			options->set_start, options->start,
+			options->set_stop, options->stop);
+
+	if ( result == PC_SUCCESS && options->count_all ) {
+		block = photon_block_alloc(options->mode, PHOTON_STREAM_BATCH_SIZE*4);
+
+		if ( block == NULL ) {
+			error("Could not allocate photon block.\n");
+			result = PC_ERROR_MEM;
+		} else {
+			result = intensity_photon_count_all(intensity, 
+					photon_stream, block);
+		}
+
+		if ( result == PC_SUCCESS && counts_nonzero(intensity->counts) ) {
+			intensity_photon_fprintf(stream_out, intensity);
+		}
+
+		photon_block_free(&block);
+	} else if ( result == PC_SUCCESS ) {
+		do {
+			status = photon_stream_next_batch(photon_stream, 
+					batch, PHOTON_STREAM_BATCH_SIZE, &n_photons);
+
+			for ( i = 0; i < n_photons; i++ ) {
+				intensity_photon_push(intensity, &batch[i]);
 	
-			while ( intensity_photon_next(intensity) == PC_SUCCESS ) {
-				intensity_photon_fprintf(stream_out, intensity);
+				while ( intensity_photon_next(intensity) == PC_SUCCESS ) {
+					intensity_photon_fprintf(stream_out, intensity);
+				}
 			}
-		}
+		} while ( status == PC_SUCCESS );
 	
 		intensity_photon_flush(intensity);
 		while ( intensity_photon_next(intensity) == PC_SUCCESS ) {
@@ -46,6 +46,11 @@ typedef struct _intensity_photon_t {
 
 	int (*next)(struct _intensity_photon_t *intensity);
 
+/* When skipping empty bins, each record reports how many empty bins came
+ * directly before it, rather than yielding them one at a time. */
+	int skip_empty;
+	unsigned long long empty;
+
 /* for calculating the intensity from photons */
 	photon_window_t window;
 
@@ -77,6 +82,8 @@ void intensity_photon_counts_init(intensity_photon_t *intensity);
 void intensity_photon_flush(intensity_photon_t *intensity);
 int intensity_photon_next(intensity_photon_t *intensity);
 void intensity_photon_free(intensity_photon_t **intensity);
+void intensity_photon_skip_empty(intensity_photon_t *intensity, 
+		int const skip_empty);
 
 /* for calculating the intensity from photons */
 void intensity_photon_init(intensity_photon_t *intensity,
@@ -226,7 +226,7 @@ int photon_number(FILE *stream_in, FILE *stream_out,
 	photon_number_t *number;
 
 	number = photon_number_alloc(options->channels * 64);
-	photons = photon_stream_alloc(MODE_T3);
+	photons = photon_stream_alloc(MODE_T3, options->format);
 
 	if ( number == NULL || photons == NULL ) {
 		error("Could not allocate photon stream or numbers.\n");
@@ -175,9 +175,10 @@ int number_to_channels(FILE *stream_in, FILE *stream_out,
 	int result = PC_SUCCESS;
 	photon_stream_t *photons;
 	number_to_channels_t *number;
+	photon_print_t print = NULL;
 
 	debug("Alloc\n");
-	photons = photon_stream_alloc(MODE_T3);
+	photons = photon_stream_alloc(MODE_T3, options->format);
 	number = number_to_channels_alloc(options->queue_size);
 
 	if ( photons == NULL || number == NULL ) {
@@ -185,6 +186,14 @@ int number_to_channels(FILE *stream_in, FILE *stream_out,
 		result = PC_ERROR_MEM;
 	}
 
+	if ( result == PC_SUCCESS ) {
+		print = photon_print_select(MODE_T3, options->format_out);
+
+		if ( print == NULL ) {
+			result = PC_ERROR_MODE;
+		}
+	}
+
 	if ( result == PC_SUCCESS ) {
 		debug("Init.\n");
 		photon_stream_init(photons, stream_in);
@@ -199,7 +208,7 @@ int number_to_channels(FILE *stream_in, FILE *stream_out,
 
 			while ( number_to_channels_next(number) == PC_SUCCESS ) {
 				debug("Yielding.\n");
-				t3_fprintf(stream_out, &(number->photon));
+				print(stream_out, &(number->photon));
 			}
 		}
 
@@ -207,7 +216,7 @@ int number_to_channels(FILE *stream_in, FILE *stream_out,
 		number_to_channels_flush(number);
 		while ( number_to_channels_next(number) == PC_SUCCESS ) {
 			debug("Yielding.\n");
-			t3_fprintf(stream_out, &(number->photon));
+			print(stream_out, &(number->photon));
 		}
 	}
 
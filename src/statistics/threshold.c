@@ -274,9 +274,10 @@ int photon_threshold(FILE *stream_in, FILE *stream_out,
 	photon_stream_t *photons;
 	photon_threshold_t *pt;
 	photon_t photon;
+	photon_print_t print = NULL;
 
 	debug("Allocating memory\n");
-	photons = photon_stream_alloc(options->mode);
+	photons = photon_stream_alloc(options->mode, options->format);
 	pt = photon_threshold_alloc(options->mode, options->queue_size);
 
 	if ( photons == NULL || pt == NULL ) {
@@ -289,19 +290,27 @@ int photon_threshold(FILE *stream_in, FILE *stream_out,
 					options->set_stop, options->stop);
 	}
 
+	if ( result == PC_SUCCESS ) {
+		print = photon_print_select(options->mode, options->format_out);
+
+		if ( print == NULL ) {
+			result = PC_ERROR_MODE;
+		}
+	}
+
 	if ( result == PC_SUCCESS ) {
 		debug("Starting stream\n");
 		while ( photon_stream_next_photon(photons) == PC_SUCCESS ) {
 			photon_threshold_push(pt, &(photons->photon));
 
 			while ( photon_threshold_next(pt, &photon) == PC_SUCCESS ) {
-				photons->photon_print(stream_out, &photon);
+				print(stream_out, &photon);
 			}
 		}
 
 		photon_threshold_flush(pt);
 		while ( photon_threshold_next(pt, &photon) == PC_SUCCESS ) {
-			photons->photon_print(stream_out, &photon);
+			print(stream_out, &photon);
 		}
 	}
 
@@ -58,7 +58,8 @@ for photon in filter(lambda p: p.channel in [1, 2],
  */
 
 
-photon_time_threshold_t *photon_time_threshold_alloc(size_t const queue_size) {
+photon_time_threshold_t *photon_time_threshold_alloc(int const format,
+		size_t const queue_size) {
 	photon_time_threshold_t *ptt = NULL;
 
 	ptt = (photon_time_threshold_t *)malloc(sizeof(photon_time_threshold_t));
@@ -67,7 +68,7 @@ photon_time_threshold_t *photon_time_threshold_alloc(size_t const queue_size) {
 		return(ptt);
 	}
 
-	ptt->photons = photon_stream_alloc(MODE_T3);
+	ptt->photons = photon_stream_alloc(MODE_T3, format);
 	ptt->numbers = number_to_channels_alloc(queue_size);
 
 	if ( ptt->photons == NULL || ptt->numbers == NULL ) {
@@ -131,11 +132,14 @@ int photon_time_threshold(FILE *stream_in, FILE *stream_out,
 	int result = PC_SUCCESS;
 	photon_t photon;
 	photon_time_threshold_t *ptt;
+	photon_print_t print = photon_print_select(MODE_T3, options->format_out);
 
 	debug("Allocating memory\n");
-	ptt = photon_time_threshold_alloc(options->queue_size);
+	ptt = photon_time_threshold_alloc(options->format, options->queue_size);
 
-	if ( ptt == NULL ) {
+	if ( print == NULL ) {
+		result = PC_ERROR_MODE;
+	} else if ( ptt == NULL ) {
 		error("Could not allocate memory.\n");
 		result = PC_ERROR_MEM;
 	} else {
@@ -146,7 +150,7 @@ int photon_time_threshold(FILE *stream_in, FILE *stream_out,
 	if ( result == PC_SUCCESS ) {
 		debug("Starting stream\n");
 		while ( photon_time_threshold_next(ptt, &photon) == PC_SUCCESS ) {
-			t3_fprintf(stream_out, &photon);
+			print(stream_out, &photon);
 		}
 	}
 
@@ -48,7 +48,8 @@ typedef struct {
 	number_to_channels_t *numbers;
 } photon_time_threshold_t;
 
-photon_time_threshold_t *photon_time_threshold_alloc(size_t const queue_size);
+photon_time_threshold_t *photon_time_threshold_alloc(int const format,
+		size_t const queue_size);
 void photon_time_threshold_init(photon_time_threshold_t *ptt, FILE *stream_in,
 		unsigned long long const threshold, int const correlate_successive);
 int photon_time_threshold_next(photon_time_threshold_t *ptt, photon_t *photon);
@@ -41,6 +41,7 @@ int main(int argc, char *argv[]) {
 "associated with the many floating-point operations involved in that process.",
 		{OPT_VERBOSE, OPT_HELP, OPT_VERSION,
 			OPT_FILE_IN, OPT_FILE_OUT,
+			OPT_FORMAT, OPT_FORMAT_OUT,
 			OPT_CHANNELS,
 			OPT_TIME_OFFSETS, OPT_REPETITION_TIME,
 			OPT_EOF}};